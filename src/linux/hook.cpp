@@ -12,6 +12,11 @@
 #include "../shared/animation.h"
 #include "../shared/gsc.h"
 #include "../shared/match.h"
+#include "../shared/event_server.h"
+#include "../shared/event_log.h"
+#include "../shared/outbox.h"
+#include "../shared/log_writer.h"
+#include "../shared/netbench.h"
 #include "updater.h"
 
 
@@ -26,6 +31,7 @@ void __cdecl hook_Com_Frame() {
 
     gsc_frame();
     match_frame();
+    event_server_frame();
     iwd_frame();
 }
 
@@ -48,6 +54,11 @@ void hook_SV_Init() {
     game_init();
     animation_init();
     match_init();
+    event_server_init();
+    event_log_init();
+    outbox_init();
+    log_writer_init();
+    netbench_init();
 
     ASM_CALL(RETURN_VOID, 0x08093adc);
 }
@@ -94,6 +105,7 @@ bool hook_patch() {
     gsc_patch();
     match_patch();
     iwd_patch();
+    log_writer_patch();
 
     return true;
 }
\ No newline at end of file
@@ -34,6 +34,11 @@
 #include "../shared/cod2_dvars.h"
 #include "../shared/gsc.h"
 #include "../shared/match.h"
+#include "../shared/event_server.h"
+#include "../shared/event_log.h"
+#include "../shared/outbox.h"
+#include "../shared/log_writer.h"
+#include "../shared/netbench.h"
 
 HMODULE hModule;
 unsigned int gfx_module_addr;
@@ -99,6 +104,7 @@ void hook_Com_Frame()
     hwid_frame();
     gsc_frame();
     match_frame();
+    event_server_frame();
     registry_frame();      // called as last so other modules can handle version changes
     drawing_frame();
     iwd_frame();
@@ -214,6 +220,11 @@ void hook_SV_Init() {
     game_init();
     animation_init();
     match_init();
+    event_server_init();
+    event_log_init();
+    outbox_init();
+    log_writer_init();
+    netbench_init();
 
     if (!DLL_HOTRELOAD) {
         ASM_CALL(RETURN_VOID, 0x004596d0);
@@ -301,6 +312,7 @@ bool hook_patch() {
     animation_patch();
     gsc_patch();
     iwd_patch();
+    log_writer_patch();
 
     
     // Patch black screen / long loading on game startup
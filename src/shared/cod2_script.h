@@ -16,6 +16,54 @@ typedef struct scr_entref_s
 } scr_entref_t;
 
 
+// Type of script variable, returned by Scr_GetType
+typedef enum
+{
+	VAR_UNDEFINED = 0,
+	VAR_POINTER = 1,		// object - array, struct, entity
+	VAR_STRING = 2,
+	VAR_ISTRING = 3,		// localized string
+	VAR_VECTOR = 4,
+	VAR_FLOAT = 5,
+	VAR_INTEGER = 6,
+	VAR_CODEPOS = 7,
+	VAR_PRECODEPOS = 8,
+	VAR_FUNCTION = 9,
+	VAR_STACK = 10,
+	VAR_ANIMATION = 11,
+} scr_type_e;
+
+
+// Object types returned by Scr_GetObjectType
+#define VAR_STRUCT	0x13
+#define VAR_ENTITY	0x15
+#define VAR_ARRAY	0x16
+
+
+// Script variables, 16 bytes per variable
+// +0 id of the variable in hash slot, +4 value, +8 type (low 5 bits) and name (upper bits), +14 hash slot of next sibling
+#define scr_variableList ADDR(0x00e08f00, 0x08297500)
+
+// Type of value of the variable (scr_type_e) or type of object (VAR_ARRAY, ...)
+inline unsigned int Scr_GetObjectType(unsigned int id) {
+	return *(unsigned int*)(scr_variableList + id * 16 + 8) & 0x1f;
+}
+// Name of the variable in the object, string index for string keys, (index + 0x800000) & 0xffffff for integer keys
+inline unsigned int Scr_GetVariableName(unsigned int id) {
+	return *(unsigned int*)(scr_variableList + id * 16 + 8) >> 8;
+}
+// Raw value of the variable, string index, int, float, pointer to vector or object id depending on the type
+inline unsigned int Scr_GetVariableValue(unsigned int id) {
+	return *(unsigned int*)(scr_variableList + id * 16 + 4);
+}
+// Iterate variables of the object, called with object id to get the first one, 0 is returned after the last one
+inline unsigned int Scr_FindNextSibling(unsigned int id) {
+	unsigned short slot = *(unsigned short*)(scr_variableList + id * 16 + 14);
+	unsigned short next = *(unsigned short*)(scr_variableList + slot * 16);
+	return Scr_GetObjectType(next) < 0xf ? next : 0; // back at the object
+}
+
+
 typedef void (*xfunction_t)();
 typedef void (*xmethod_t)(scr_entref_t);
 
@@ -135,6 +183,16 @@ inline void Scr_AddVector(float* vec)
 {
 	ASM_CALL(RETURN_VOID, ADDR(0x004838b0, 0x08085306), WL(0, 1), WL(ESI, PUSH)(vec));
 }
+// Adds object of entity / hudelem / ... to the stack, classnum 0 is entity
+inline void Scr_AddEntityNum(int entnum, unsigned int classnum)
+{
+	ASM_CALL(RETURN_VOID, ADDR(0x00483720, 0x0808521a), WL(1, 2), WL(EAX, PUSH)(entnum), PUSH(classnum));
+}
+// Adds entity to the stack, used when returning values back to GSC script
+inline void Scr_AddEntity(gentity_t* ent)
+{
+	Scr_AddEntityNum(ent->s.number, 0);
+}
 // Creates array variable, must be called before Scr_AddArray
 inline void Scr_MakeArray(void)
 {
@@ -145,6 +203,12 @@ inline void Scr_AddArray(void)
 {
 	ASM_CALL(RETURN_VOID, ADDR(0x004839a0, 0x08085364), 0);
 }
+// Add value on top of the stack to the array with string key, must be called after Scr_MakeArray
+// The reference to stringValue is taken by the array, use SL_GetString to get it
+inline void Scr_AddArrayStringIndexed(unsigned int stringValue)
+{
+	ASM_CALL(RETURN_VOID, ADDR(0x00483a20, 0x080853b6), WL(0, 1), WL(ECX, PUSH)(stringValue));
+}
 
 
 // Get value of passed parameter at index, e.g. testFunc(1)
@@ -180,6 +244,20 @@ inline void Scr_GetVector(unsigned int param, vec3_t vec)
 {
 	ASM_CALL(RETURN_VOID, ADDR(0x00483160, 0x08084d40), WL(0, 2), WL(EAX, PUSH)(param), WL(EDX, PUSH)(vec));
 }
+// Get object of passed parameter at index (array, struct, entity), e.g. testFunc(array)
+inline unsigned int Scr_GetObject(unsigned int param)
+{
+	unsigned int ret;
+	ASM_CALL(RETURN(ret), ADDR(0x00483380, 0x08084f62), WL(0, 1), WL(EAX, PUSH)(param));
+	return ret;
+}
+// Get type of passed parameter at index, see scr_type_e
+inline int Scr_GetType(unsigned int param)
+{
+	int ret;
+	ASM_CALL(RETURN(ret), ADDR(0x00483400, 0x08084ff0), WL(0, 1), WL(EAX, PUSH)(param));
+	return ret;
+}
 // Get function handle of passed parameter at index, e.g. testFunc(::func)
 inline void* Scr_GetParamFunction(int param)
 {
@@ -190,6 +268,15 @@ inline void* Scr_GetParamFunction(int param)
 
 
 
+// Get index of the string in the string table, the string is created if it does not exist yet
+// Reference count of the string is increased for the user
+inline unsigned int SL_GetString(const char* str, unsigned int user)
+{
+	unsigned int ret;
+	ASM_CALL(RETURN(ret), ADDR(0x00477500, 0x0807943c), 4, PUSH(str), PUSH(user), PUSH(strlen(str) + 1), PUSH(6));
+	return ret;
+}
+
 inline char* SL_ConvertToString(int index)
 {
 	char* ret;
@@ -0,0 +1,194 @@
+#include "entity_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "shared.h"
+#include "cod2_script.h"
+#include "gsc.h"
+
+// Index of entities by classname and targetname.
+// Engine functions that change the fields are hooked - G_InitGentity (entity spawn, slot is reused), G_FreeEntity,
+// ClientSpawn in server.cpp (classname "player") and the setter of entity fields from script (targetname,
+// classname is read-only).
+// Hooks only mark the entity as pending, because the engine sets the classname after G_InitGentity returns.
+// Pending entities are moved between buckets by the next query, so the query only walks one bucket.
+
+EntityIndex entity_index[ENTITY_INDEX_FIELDS];
+int entity_index_pending[MAX_GENTITIES];		// entities changed since last query
+int entity_index_pendingCount = 0;
+bool entity_index_isPending[MAX_GENTITIES];
+bool entity_index_rebuild = true;				// all entities must be indexed, set on map change or restart
+
+
+static inline uint16_t entity_index_value(gentity_t* ent, int field) {
+	if (!ent->r.inuse) return 0;
+	return field == ENTITY_INDEX_CLASSNAME ? ent->classname : ent->targetname;
+}
+
+static inline int entity_index_bucket(const char* str) {
+	unsigned int hash = 2166136261u; // FNV-1a
+	for (; *str; str++)
+		hash = (hash ^ (unsigned char)*str) * 16777619u;
+	return (int)(hash & (ENTITY_INDEX_BUCKETS - 1));
+}
+
+static void entity_index_unlink(EntityIndex& index, int entnum) {
+	int bucket = index.bucket[entnum];
+	if (bucket == -1) return;
+	int prev = index.prev[entnum], next = index.next[entnum];
+	if (prev != -1) index.next[prev] = next;
+	else index.buckets[bucket] = next;
+	if (next != -1) index.prev[next] = prev;
+	index.bucket[entnum] = -1;
+	index.value[entnum] = 0;
+}
+
+static void entity_index_link(EntityIndex& index, int entnum, uint16_t value) {
+	int bucket = entity_index_bucket(SL_ConvertToString(value));
+	index.prev[entnum] = -1;
+	index.next[entnum] = index.buckets[bucket];
+	if (index.next[entnum] != -1) index.prev[index.next[entnum]] = entnum;
+	index.buckets[bucket] = entnum;
+	index.bucket[entnum] = bucket;
+	index.value[entnum] = value;
+}
+
+static void entity_index_syncEntity(int entnum) {
+	gentity_t* ent = &g_entities[entnum];
+	for (int f = 0; f < ENTITY_INDEX_FIELDS; f++) {
+		EntityIndex& index = entity_index[f];
+		uint16_t value = entity_index_value(ent, f);
+		if (value == index.value[entnum])
+			continue;
+		entity_index_unlink(index, entnum);
+		if (value)
+			entity_index_link(index, entnum, value);
+	}
+}
+
+
+/** Mark the entity as changed, it will be moved to the right bucket by the next query. */
+void entity_index_update(int entnum) {
+	if (entnum < 0 || entnum >= MAX_GENTITIES || entity_index_isPending[entnum])
+		return;
+	entity_index_isPending[entnum] = true;
+	entity_index_pending[entity_index_pendingCount++] = entnum;
+}
+
+/** Remove all entities from the index. Called on map change or restart, because entities and script strings are freed. */
+void entity_index_clear() {
+	for (int f = 0; f < ENTITY_INDEX_FIELDS; f++) {
+		EntityIndex& index = entity_index[f];
+		for (int i = 0; i < ENTITY_INDEX_BUCKETS; i++)
+			index.buckets[i] = -1;
+		for (int i = 0; i < MAX_GENTITIES; i++) {
+			index.next[i] = index.prev[i] = index.bucket[i] = -1;
+			index.value[i] = 0;
+		}
+	}
+	for (int i = 0; i < MAX_GENTITIES; i++)
+		entity_index_isPending[i] = false;
+	entity_index_pendingCount = 0;
+	entity_index_rebuild = true;
+}
+
+/** Update the index with entities changed since the last query. */
+void entity_index_sync() {
+	if (entity_index_rebuild) {
+		entity_index_rebuild = false;
+		for (int i = 0; i < MAX_GENTITIES; i++)
+			entity_index_syncEntity(i);
+	} else {
+		for (int i = 0; i < entity_index_pendingCount; i++)
+			entity_index_syncEntity(entity_index_pending[i]);
+	}
+
+	for (int i = 0; i < entity_index_pendingCount; i++)
+		entity_index_isPending[entity_index_pending[i]] = false;
+	entity_index_pendingCount = 0;
+}
+
+/**
+ * Find entities whose field is equal to the name, sorted by entity number.
+ * Returns number of entity numbers written to result.
+ */
+int entity_index_find(entity_index_field_e field, const char* name, int* result, int maxResults) {
+	entity_index_sync();
+
+	EntityIndex& index = entity_index[field];
+	int count = 0;
+	for (int i = index.buckets[entity_index_bucket(name)]; i != -1 && count < maxResults; i = index.next[i]) {
+		// Different names might share the same bucket
+		if (strcmp(SL_ConvertToString(index.value[i]), name) != 0)
+			continue;
+		result[count++] = i;
+	}
+
+	std::sort(result, result + count);
+	return count;
+}
+
+
+
+void G_InitGentity(gentity_t* ent) {
+	ASM_CALL(RETURN_VOID, ADDR(0x0050f860, 0x0811e85c), WL(0, 1), WL(ESI, PUSH)(ent));
+
+	// CoD2x: entity slot is used again, classname is set by the caller
+	entity_index_update(ent->s.number);
+	// CoD2x: end
+}
+
+void G_InitGentity_Win32() {
+	gentity_t* ent;
+	ASM( movr, ent, "esi" );
+	G_InitGentity(ent);
+}
+
+// Called from G_FreeEntity before the entity is cleared
+void G_FreeEntityStrings(gentity_t* ent) {
+	ASM_CALL(RETURN_VOID, ADDR(0x005111d0, 0x0811b128), 1, PUSH(ent));
+
+	// CoD2x: entity is freed, its timers must not be called on the next entity in this slot
+	entity_index_update(ent->s.number);
+	gsc_timer_clearEntity(ent->s.number);
+	// CoD2x: end
+}
+
+// Set entity field from script, e.g. ent.targetname = "name"
+void Scr_SetGenericField(byte* b, int type, int ofs) {
+	WL(
+		ASM_CALL(RETURN_VOID, 0x00510f00, 0, EAX(type), ECX(ofs), EDX(b)),
+		ASM_CALL(RETURN_VOID, 0x0811ad7e, 3, PUSH(b), PUSH(type), PUSH(ofs))
+	);
+
+	// CoD2x: targetname might be changed
+	entity_index_update(((gentity_t*)b)->s.number);
+	// CoD2x: end
+}
+
+void Scr_SetGenericField_Win32() {
+	byte* b;
+	int type;
+	int ofs;
+	ASM( movr, type, "eax" );
+	ASM( movr, ofs, "ecx" );
+	ASM( movr, b, "edx" );
+	Scr_SetGenericField(b, type, ofs);
+}
+
+
+/** Called before the entry point is called. Used to patch the memory. */
+void entity_index_patch() {
+	// G_InitGentity in ClientConnect, G_Spawn and G_SpawnPlayerClone
+	patch_call(ADDR(0x004fe323, 0x080f8f96), (unsigned int)WL(G_InitGentity_Win32, G_InitGentity));
+	patch_call(ADDR(0x0050fa1c, 0x0811ea99), (unsigned int)WL(G_InitGentity_Win32, G_InitGentity));
+	patch_call(ADDR(0x0050fa93, 0x0811eb2a), (unsigned int)WL(G_InitGentity_Win32, G_InitGentity));
+	#if COD2X_WIN32
+		patch_call(0x0050fa47, (unsigned int)G_InitGentity_Win32); // G_Spawn, reused slot from the free list
+	#endif
+
+	patch_call(ADDR(0x0050fec9, 0x0811eef5), (unsigned int)G_FreeEntityStrings); // G_FreeEntity
+
+	patch_call(ADDR(0x00510eef, 0x0811ad6d), (unsigned int)WL(Scr_SetGenericField_Win32, Scr_SetGenericField)); // Scr_SetEntityField
+}
@@ -0,0 +1,30 @@
+#ifndef ENTITY_INDEX_H
+#define ENTITY_INDEX_H
+
+#include "shared.h"
+#include "cod2_entity.h"
+
+#define ENTITY_INDEX_BUCKETS	256		// number of hash buckets per field, power of 2
+
+enum entity_index_field_e {
+	ENTITY_INDEX_CLASSNAME,
+	ENTITY_INDEX_TARGETNAME,
+	ENTITY_INDEX_FIELDS
+};
+
+// Index of entities by one string field, entities with the same value are chained in the same bucket
+struct EntityIndex {
+	int buckets[ENTITY_INDEX_BUCKETS];	// first entity in the bucket or -1
+	int next[MAX_GENTITIES];			// next entity in the same bucket or -1
+	int prev[MAX_GENTITIES];			// previous entity in the same bucket or -1
+	int bucket[MAX_GENTITIES];			// bucket of the entity or -1 if not indexed
+	uint16_t value[MAX_GENTITIES];		// script string of the field when the entity was indexed, 0 if not indexed
+};
+
+void entity_index_update(int entnum);
+void entity_index_clear();
+void entity_index_sync();
+int entity_index_find(entity_index_field_e field, const char* name, int* result, int maxResults);
+void entity_index_patch();
+
+#endif
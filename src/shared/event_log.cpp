@@ -0,0 +1,427 @@
+#include "event_log.h"
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <sys/stat.h>   // mkdir
+
+#include "shared.h"
+#if COD2X_WIN32
+    #include <windows.h>
+    #include <direct.h> // _mkdir
+#else
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "cod2_common.h"
+#include "cod2_dvars.h"
+#include "cod2_cmd.h"
+#include "cod2_script.h"
+#include "event_server.h"
+
+// Binary structured event log.
+// Lines printed by scripts via logPrint() into games_mp.log (K;, D;, J;, Q;, W;, L;, A;) are also written as typed binary records,
+// together with map start and map end events, so the stats tools don't need to parse the text log.
+// Records are copied into a memory-mapped file, so the game thread does not wait for the disk and the data survive a crash of the process.
+// When the file is full, it is truncated to the used size and new file is started.
+//
+// Files: fs_homepath/eventlog/events_<unix time ms>.cev
+// All numbers are little-endian.
+//   header (32 bytes):
+//     char[8]  magic "CoD2xEVL"
+//     uint16   format version, EVENT_LOG_VERSION
+//     uint16   header size, records start at this offset
+//     uint32   reserved
+//     int64    unix time in ms when the file was created
+//     uint64   reserved
+//   record:
+//     uint16   size of the record including this field, 0 marks the end of data
+//     uint8    type
+//     uint8    reserved
+//     int64    unix time in ms
+//     fields by type:
+//       EVENT_LOG_MAP_START    string map, string gametype
+//       EVENT_LOG_MAP_END      uint8 kind (0 = round restart, 1 = map change, 2 = shutdown), string source
+//       EVENT_LOG_KILL         player victim, player attacker, string weapon, int32 damage, string mod, string hitloc
+//       EVENT_LOG_DAMAGE       same as EVENT_LOG_KILL
+//       EVENT_LOG_JOIN         int32 guid, int32 clientNum, string name
+//       EVENT_LOG_QUIT         int32 guid, int32 clientNum, string name
+//       EVENT_LOG_WIN          string team, uint8 count, count x (int32 guid, string name)
+//       EVENT_LOG_LOSS         same as EVENT_LOG_WIN
+//       EVENT_LOG_ACTION       player, string action
+//   string:  uint8 length, bytes without NUL
+//   player:  int32 guid, int32 clientNum, string team, string name
+// Readers must skip records with unknown type by their size, new types and new fields at the end of a record can be added
+// without changing the version. The reader and converter to JSON are in tools/eventlog.
+
+#define EVENT_LOG_MAGIC             "CoD2xEVL"
+#define EVENT_LOG_VERSION           1
+#define EVENT_LOG_HEADER_SIZE       32
+#define EVENT_LOG_RECORD_HEADER     12
+#define EVENT_LOG_DIR               "eventlog"
+#define EVENT_LOG_RETRY_MS          10000   // wait before opening the file again after error
+#define EVENT_LOG_MAX_FIELDS        64
+
+enum event_log_type_e {
+    EVENT_LOG_MAP_START = 1,
+    EVENT_LOG_MAP_END = 2,
+    EVENT_LOG_KILL = 3,
+    EVENT_LOG_DAMAGE = 4,
+    EVENT_LOG_JOIN = 5,
+    EVENT_LOG_QUIT = 6,
+    EVENT_LOG_WIN = 7,
+    EVENT_LOG_LOSS = 8,
+    EVENT_LOG_ACTION = 9,
+};
+
+dvar_t* sv_eventLog;
+dvar_t* sv_eventLogSize;
+
+xfunction_t event_log_logPrint_original = NULL;
+
+static struct {
+    bool open;
+    std::string path;
+    unsigned char* data;        // mapped file
+    size_t size;                // size of the mapped file
+    size_t used;                // bytes written including the header
+    uint64_t retryTime;         // ticks when opening can be tried again after error
+    uint64_t records;
+    uint64_t skipped;           // lines that could not be parsed
+    #if COD2X_WIN32
+        HANDLE file;
+        HANDLE mapping;
+    #else
+        int fd;
+    #endif
+} evlog;
+
+
+static void event_log_putInt32(std::string& s, int32_t value) {
+    s.append((const char*)&value, 4);
+}
+
+static void event_log_putString(std::string& s, const char* str, size_t len) {
+    if (len > 255) len = 255;
+    s += (char)(unsigned char)len;
+    s.append(str, len);
+}
+
+static void event_log_putString(std::string& s, const char* str) {
+    event_log_putString(s, str, strlen(str));
+}
+
+
+// Unmap the file and truncate it to the used size
+static void event_log_close() {
+    if (!evlog.open)
+        return;
+    evlog.open = false;
+
+    #if COD2X_WIN32
+        UnmapViewOfFile(evlog.data);
+        CloseHandle(evlog.mapping);
+        LARGE_INTEGER size;
+        size.QuadPart = evlog.used;
+        SetFilePointerEx(evlog.file, size, NULL, FILE_BEGIN);
+        SetEndOfFile(evlog.file);
+        CloseHandle(evlog.file);
+    #else
+        munmap(evlog.data, evlog.size);
+        if (ftruncate(evlog.fd, evlog.used) != 0) { /* the end of data is marked by zero size anyway */ }
+        close(evlog.fd);
+    #endif
+
+    evlog.data = NULL;
+    Com_DPrintf("Event log %s closed, %u bytes\n", evlog.path.c_str(), (unsigned)evlog.used);
+}
+
+// Create new file and map it into memory
+static bool event_log_open() {
+    if (evlog.open)
+        return true;
+    if (evlog.retryTime && ticks_ms() < evlog.retryTime)
+        return false;
+
+    std::string dir = std::string(Dvar_GetString("fs_homepath")) + WL("\\", "/") + EVENT_LOG_DIR;
+    #if COD2X_WIN32
+        _mkdir(dir.c_str());
+    #else
+        mkdir(dir.c_str(), 0755);
+    #endif
+
+    uint64_t created = time_utc_ms();
+    evlog.path = dir + WL("\\", "/") + "events_" + std::to_string(created) + ".cev";
+    evlog.size = (size_t)sv_eventLogSize->value.integer * 1024 * 1024;
+
+    bool ok = false;
+    #if COD2X_WIN32
+        evlog.file = CreateFileA(evlog.path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (evlog.file != INVALID_HANDLE_VALUE) {
+            evlog.mapping = CreateFileMappingA(evlog.file, NULL, PAGE_READWRITE, 0, (DWORD)evlog.size, NULL);
+            if (evlog.mapping) {
+                evlog.data = (unsigned char*)MapViewOfFile(evlog.mapping, FILE_MAP_WRITE, 0, 0, evlog.size);
+                ok = evlog.data != NULL;
+                if (!ok) CloseHandle(evlog.mapping);
+            }
+            if (!ok) CloseHandle(evlog.file);
+        }
+    #else
+        evlog.fd = ::open(evlog.path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (evlog.fd >= 0) {
+            if (ftruncate(evlog.fd, evlog.size) == 0) {
+                void* data = mmap(NULL, evlog.size, PROT_READ | PROT_WRITE, MAP_SHARED, evlog.fd, 0);
+                ok = data != MAP_FAILED;
+                evlog.data = ok ? (unsigned char*)data : NULL;
+            }
+            if (!ok) close(evlog.fd);
+        }
+    #endif
+
+    if (!ok) {
+        Com_Printf("Error: failed to create event log %s\n", evlog.path.c_str());
+        evlog.retryTime = ticks_ms() + EVENT_LOG_RETRY_MS;
+        return false;
+    }
+
+    unsigned char* h = evlog.data;
+    uint16_t version = EVENT_LOG_VERSION, headerSize = EVENT_LOG_HEADER_SIZE;
+    memcpy(h, EVENT_LOG_MAGIC, 8);
+    memcpy(h + 8, &version, 2);
+    memcpy(h + 10, &headerSize, 2);
+    memcpy(h + 16, &created, 8);
+
+    evlog.used = EVENT_LOG_HEADER_SIZE;
+    evlog.retryTime = 0;
+    evlog.open = true;
+    Com_DPrintf("Event log %s opened\n", evlog.path.c_str());
+    return true;
+}
+
+static bool event_log_isEnabled();
+
+// Append the record to the file, new file is started when the current one is full
+static void event_log_write(event_log_type_e type, const std::string& fields) {
+    size_t size = EVENT_LOG_RECORD_HEADER + fields.size();
+    if (size > 0xFFFF || !event_log_isEnabled())
+        return; // lines are parsed also for the event server
+
+    if (evlog.open && evlog.used + size > evlog.size)
+        event_log_close();
+    if (!event_log_open())
+        return;
+    if (evlog.used + size > evlog.size)
+        return; // sv_eventLogSize is smaller than the record
+
+    unsigned char* r = evlog.data + evlog.used;
+    uint16_t recordSize = (uint16_t)size;
+    uint64_t time = time_utc_ms();
+    memcpy(r + 4, &time, 8);
+    memcpy(r + EVENT_LOG_RECORD_HEADER, fields.data(), fields.size());
+    r[2] = (unsigned char)type;
+    r[3] = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(r, &recordSize, 2); // size is written last, readers of the running file stop at zero size
+
+    evlog.used += size;
+    evlog.records++;
+}
+
+static bool event_log_isEnabled() {
+    if (sv_eventLog && sv_eventLog->value.boolean)
+        return true;
+    event_log_close();
+    return false;
+}
+
+
+struct EventLogField {
+    const char* str;
+    size_t len;
+};
+
+static int event_log_fieldInt(const EventLogField& f) {
+    char buffer[16];
+    size_t len = f.len < sizeof(buffer) - 1 ? f.len : sizeof(buffer) - 1;
+    memcpy(buffer, f.str, len);
+    buffer[len] = '\0';
+    return atoi(buffer);
+}
+
+static EventServerPlayer event_log_fieldPlayer(const EventLogField* f) {
+    return {event_log_fieldInt(f[0]), event_log_fieldInt(f[1]), std::string(f[2].str, f[2].len), std::string(f[3].str, f[3].len)};
+}
+
+// Append player fields from 4 line fields: guid;clientNum;team;name
+static void event_log_putPlayer(std::string& s, const EventLogField* f) {
+    event_log_putInt32(s, event_log_fieldInt(f[0]));
+    event_log_putInt32(s, event_log_fieldInt(f[1]));
+    event_log_putString(s, f[2].str, f[2].len);
+    event_log_putString(s, f[3].str, f[3].len);
+}
+
+/**
+ * Convert line printed via logPrint() into binary record, unknown lines are ignored.
+ * Stock scripts print:
+ *   K;victimGuid;victimNum;victimTeam;victimName;attackerGuid;attackerNum;attackerTeam;attackerName;weapon;damage;mod;hitloc
+ *   D;(same as K)
+ *   J;guid;num;name
+ *   Q;guid;num;name
+ *   W;team;guid;name[;guid;name...]
+ *   L;team;guid;name[;guid;name...]
+ *   A;guid;num;team;name;action
+ */
+static void event_log_parseLine(const char* line) {
+    EventLogField f[EVENT_LOG_MAX_FIELDS];
+    int count = 0;
+
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        len--;
+
+    const char* start = line;
+    for (size_t i = 0; i <= len && count < EVENT_LOG_MAX_FIELDS; i++) {
+        if (i == len || line[i] == ';') {
+            f[count].str = start;
+            f[count].len = (line + i) - start;
+            count++;
+            start = line + i + 1;
+        }
+    }
+    if (count < 2 || f[0].len != 1)
+        return;
+
+    std::string s;
+    event_log_type_e type;
+    switch (f[0].str[0]) {
+        case 'K':
+        case 'D':
+            if (count != 13) break;
+            type = f[0].str[0] == 'K' ? EVENT_LOG_KILL : EVENT_LOG_DAMAGE;
+            event_log_putPlayer(s, &f[1]);
+            event_log_putPlayer(s, &f[5]);
+            event_log_putString(s, f[9].str, f[9].len);
+            event_log_putInt32(s, event_log_fieldInt(f[10]));
+            event_log_putString(s, f[11].str, f[11].len);
+            event_log_putString(s, f[12].str, f[12].len);
+            event_log_write(type, s);
+            if (type == EVENT_LOG_KILL)
+                event_server_onKill(event_log_fieldPlayer(&f[1]), event_log_fieldPlayer(&f[5]), std::string(f[9].str, f[9].len),
+                    event_log_fieldInt(f[10]), std::string(f[11].str, f[11].len), std::string(f[12].str, f[12].len));
+            return;
+
+        case 'J':
+        case 'Q':
+            if (count != 4) break;
+            type = f[0].str[0] == 'J' ? EVENT_LOG_JOIN : EVENT_LOG_QUIT;
+            event_log_putInt32(s, event_log_fieldInt(f[1]));
+            event_log_putInt32(s, event_log_fieldInt(f[2]));
+            event_log_putString(s, f[3].str, f[3].len);
+            event_log_write(type, s);
+            return;
+
+        case 'W':
+        case 'L':
+            if (count < 2 || count % 2 != 0) break;
+            type = f[0].str[0] == 'W' ? EVENT_LOG_WIN : EVENT_LOG_LOSS;
+            event_log_putString(s, f[1].str, f[1].len);
+            s += (char)(unsigned char)((count - 2) / 2);
+            for (int i = 2; i + 1 < count; i += 2) {
+                event_log_putInt32(s, event_log_fieldInt(f[i]));
+                event_log_putString(s, f[i + 1].str, f[i + 1].len);
+            }
+            event_log_write(type, s);
+            return;
+
+        case 'A':
+            if (count != 6) break;
+            event_log_putPlayer(s, &f[1]);
+            event_log_putString(s, f[5].str, f[5].len);
+            event_log_write(EVENT_LOG_ACTION, s);
+            return;
+
+        default:
+            return; // not an event line
+    }
+
+    evlog.skipped++; // unexpected number of fields, probably ';' in the player name
+}
+
+// Replaces script function logPrint(text), the line is still printed into games_mp.log
+// Kill lines are also published by the event server
+static void event_log_logPrint() {
+    if ((event_log_isEnabled() || event_server_isActive()) && Scr_GetNumParam() == 1 && Scr_GetType(0) == VAR_STRING)
+        event_log_parseLine(Scr_GetString(0));
+    event_log_logPrint_original();
+}
+
+/**
+ * Wrap original script function logPrint, so printed events are written also into the binary event log.
+ * Other functions are returned unchanged.
+ */
+xfunction_t event_log_wrapFunction(const char* name, xfunction_t call) {
+    if (Q_stricmp(name, "logprint") == 0) {
+        event_log_logPrint_original = call;
+        return event_log_logPrint;
+    }
+    return call;
+}
+
+
+/** Called when the server is started via /map /devmap /map_restart /map_rotate /fast_restart or GSC map_restart(true/false) */
+void event_log_onStartGameType() {
+    if (!event_log_isEnabled())
+        return;
+
+    std::string s;
+    event_log_putString(s, Dvar_GetString("mapname"));
+    event_log_putString(s, Dvar_GetString("g_gametype"));
+    event_log_write(EVENT_LOG_MAP_START, s);
+}
+
+
+void event_log_cmd_status() {
+    if (!evlog.open) {
+        Com_Printf("Event log: %s, no file is open\n", sv_eventLog->value.boolean ? "enabled" : "disabled");
+        return;
+    }
+    Com_Printf("Event log: %s, %u / %u bytes, %llu records, %llu lines skipped\n", evlog.path.c_str(), (unsigned)evlog.used, (unsigned)evlog.size,
+        (unsigned long long)evlog.records, (unsigned long long)evlog.skipped);
+}
+
+
+/**
+ * Called before a map change, restart or shutdown that can be triggered from a script or a command.
+ * Returns true to proceed, false to cancel the operation. Return value is ignored when shutdown is true.
+ * @param fromScript true if map change was triggered from a script, false if from a command.
+ * @param bComplete true if map change or restart is complete, false if it's a round restart so persistent variables are kept.
+ * @param shutdown true if the server is shutting down, false otherwise.
+ * @param source the source of the map change or restart.
+ */
+bool event_log_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source) {
+    if (!event_log_isEnabled())
+        return true;
+
+    std::string s;
+    s += (char)(shutdown ? 2 : bComplete ? 1 : 0);
+    event_log_putString(s, sv_map_change_source_to_string(source));
+    event_log_write(EVENT_LOG_MAP_END, s);
+
+    if (shutdown)
+        event_log_close();
+
+    return true;
+}
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void event_log_init() {
+    sv_eventLog = Dvar_RegisterBool("sv_eventLog", false, (dvarFlags_e)(DVAR_CHANGEABLE_RESET));
+    sv_eventLogSize = Dvar_RegisterInt("sv_eventLogSize", 16, 1, 256, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // MB, new file is started when the file is full
+
+    Cmd_AddCommand("eventLogStatus", event_log_cmd_status);
+}
@@ -0,0 +1,12 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "server.h"
+#include "cod2_script.h"
+
+xfunction_t event_log_wrapFunction(const char* name, xfunction_t call);
+void event_log_onStartGameType();
+bool event_log_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
+void event_log_init();
+
+#endif
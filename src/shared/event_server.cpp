@@ -0,0 +1,320 @@
+#include "event_server.h"
+
+#include <string>
+#include <memory>
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_cmd.h"
+#include "cod2_dvars.h"
+#include "cod2_server.h"
+#include "server.h"
+#include "websocket_server.h"
+#include "json.h"
+#include "json_writer.h"
+#include "ordered_map.h"
+#include "match.h"
+
+#define EVENT_SERVER_PATH "/events"
+
+dvar_t* sv_eventServerPort;
+dvar_t* sv_eventServerToken;
+dvar_t* sv_eventServerQueue;
+
+WebSocketServer* event_server = nullptr;
+
+// Last known state of clients, used to detect disconnects
+clientState_t event_server_clientStates[MAX_CLIENTS] = {};
+char event_server_clientNames[MAX_CLIENTS][0x20] = {};
+int event_server_clientGuids[MAX_CLIENTS] = {};
+
+// Match progress data changed since the last frame, key -> JSON value
+// Scripts often set many values in one frame, they are published together as one event in the next frame
+ordered_map<std::string, std::string> event_server_matchGlobal;
+ordered_map<std::string, ordered_map<std::string, std::string>> event_server_matchPlayers;
+
+
+/**
+ * Returns true if there is at least one subscriber.
+ * Use it to avoid building event data when nobody is listening.
+ */
+bool event_server_isActive() {
+    return event_server && event_server->subscriberCount() > 0;
+}
+
+/**
+ * Publish an event to all subscribers.
+ * The event is serialized once and shared between all subscribers.
+ * @param type Event type, for example "player_connect"
+ * @param data JSON object with event data, for example {"name": "eyza"}, or empty string if there is no data
+ */
+void event_server_publish(const char* type, const std::string& data) {
+    if (!event_server_isActive())
+        return;
+
+    char time[32];
+    time_to_iso8601(time_utc_ms(), time, sizeof(time));
+
+    auto json = std::make_shared<std::string>();
+    json->reserve(64 + data.size());
+    *json += "{\"type\":\"";
+    *json += json_escape_string(type);
+    *json += "\",\"time\":\"";
+    *json += time;
+    *json += "\",\"data\":";
+    *json += data.empty() ? "{}" : data;
+    *json += "}";
+
+    event_server->broadcast(std::move(json));
+}
+
+
+// Build JSON object with basic info about the client
+std::string event_server_clientData(int clientNum, const char* name, int guid) {
+    std::string data;
+    data += "{\"slot\":" + std::to_string(clientNum);
+    data += ",\"name\":\"" + json_escape_string(name) + "\"";
+    data += ",\"guid\":" + std::to_string(guid);
+    data += "}";
+    return data;
+}
+
+
+/** Called when CodeCallback_PlayerConnect is called */
+void event_server_onPlayerConnect(int entnum) {
+    if (entnum < 0 || entnum >= MAX_CLIENTS)
+        return;
+
+    client_t* client = &svs_clients[entnum];
+
+    // Player connect callback is called also on map change, report only new connections
+    bool isNew = event_server_clientStates[entnum] < CS_CONNECTED;
+
+    event_server_clientStates[entnum] = client->state;
+    Q_strncpyz(event_server_clientNames[entnum], client->name, sizeof(event_server_clientNames[entnum]));
+    event_server_clientGuids[entnum] = client->guid;
+
+    if (isNew)
+        event_server_publish("player_connect", event_server_clientData(entnum, client->name, client->guid));
+}
+
+
+// Write player of the kill event, same keys as player_connect plus team
+static void event_server_writePlayer(JsonWriter& json, const EventServerPlayer& player) {
+    json.raw("{\"slot\":").raw(std::to_string(player.slot));
+    json.raw(",\"name\":").string(player.name);
+    json.raw(",\"guid\":").raw(std::to_string(player.guid));
+    json.raw(",\"team\":").string(player.team);
+    json.raw("}");
+}
+
+/** Called when the script prints kill line "K;..." via logPrint(), the line is parsed by the event log */
+void event_server_onKill(const EventServerPlayer& victim, const EventServerPlayer& attacker, const std::string& weapon, int damage, const std::string& mod, const std::string& hitloc) {
+    if (!event_server_isActive())
+        return;
+
+    JsonWriter json(256);
+    json.raw("{\"victim\":");
+    event_server_writePlayer(json, victim);
+    json.raw(",\"attacker\":");
+    event_server_writePlayer(json, attacker);
+    json.raw(",\"weapon\":").string(weapon);
+    json.raw(",\"damage\":").raw(std::to_string(damage));
+    json.raw(",\"mod\":").string(mod);
+    json.raw(",\"hitloc\":").string(hitloc);
+    json.raw("}");
+    event_server_publish("kill", json.str());
+}
+
+
+/** Called when the server is started via /map /devmap /map_restart /map_rotate /fast_restart or GSC map_restart(true/false) */
+void event_server_onStartGameType() {
+    if (!event_server_isActive())
+        return;
+
+    std::string data;
+    data += "{\"map\":\"" + json_escape_string(Dvar_GetString("mapname")) + "\"";
+    data += ",\"gametype\":\"" + json_escape_string(Dvar_GetString("g_gametype")) + "\"";
+    data += "}";
+    event_server_publish("map_start", data);
+}
+
+
+/**
+ * Called when match progress data are changed by matchSetData, matchPlayerSetData, matchIncData or matchPlayerIncData.
+ * Changes are coalesced and published as one "match_data" event in the next frame.
+ * @param playerKey key of the player or nullptr for global data
+ * @param value new value or nullptr if the key was removed
+ */
+void event_server_onMatchDataChanged(const char* playerKey, const char* key, const MatchValue* value) {
+    if (!event_server_isActive())
+        return;
+
+    JsonWriter json(32);
+    if (value)
+        match_json_value(json, *value);
+    else
+        json.raw("null");
+
+    if (playerKey)
+        event_server_matchPlayers[playerKey][key] = json.str();
+    else
+        event_server_matchGlobal[key] = json.str();
+}
+
+// Publish match progress data changed in the last frame
+void event_server_publishMatchData() {
+    if (event_server_matchGlobal.empty() && event_server_matchPlayers.empty())
+        return;
+
+    JsonWriter json(256);
+    json.raw("{\"global\":{");
+    bool first = true;
+    for (const auto& it : event_server_matchGlobal) {
+        if (!first) json.raw(",");
+        first = false;
+        json.string(it.key).raw(":").raw(it.value);
+    }
+    json.raw("},\"players\":{");
+    first = true;
+    for (const auto& player : event_server_matchPlayers) {
+        if (!first) json.raw(",");
+        first = false;
+        json.string(player.key).raw(":{");
+        bool firstValue = true;
+        for (const auto& it : player.value) {
+            if (!firstValue) json.raw(",");
+            firstValue = false;
+            json.string(it.key).raw(":").raw(it.value);
+        }
+        json.raw("}");
+    }
+    json.raw("}}");
+
+    event_server_matchGlobal.clear();
+    event_server_matchPlayers.clear();
+
+    event_server_publish("match_data", json.str());
+}
+
+
+/**
+ * Called before a map change, restart or shutdown that can be triggered from a script or a command.
+ * Returns true to proceed, false to cancel the operation. Return value is ignored when shutdown is true.
+ * @param fromScript true if map change was triggered from a script, false if from a command.
+ * @param bComplete true if map change or restart is complete, false if it's a round restart so persistent variables are kept.
+ * @param shutdown true if the server is shutting down, false otherwise.
+ * @param source the source of the map change or restart.
+ */
+bool event_server_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source) {
+
+    // Changes made in the last frame belong before the end of the map
+    event_server_publishMatchData();
+
+    if (event_server_isActive()) {
+        std::string data;
+        data += "{\"map\":\"" + json_escape_string(Dvar_GetString("mapname")) + "\"";
+        data += ",\"source\":\"" + std::string(sv_map_change_source_to_string(source)) + "\"";
+        data += ",\"from_script\":" + std::string(fromScript ? "true" : "false");
+        data += ",\"shutdown\":" + std::string(shutdown ? "true" : "false");
+        data += "}";
+        event_server_publish(bComplete ? "map_end" : "round_end", data);
+    }
+
+    if (shutdown && event_server) {
+        event_server->close();
+        event_server->poll(0); // try to send the close frames, dont wait for the subscribers
+        delete event_server;
+        event_server = nullptr;
+    }
+
+    return true;
+}
+
+
+void event_server_start() {
+    if (event_server) {
+        delete event_server;
+        event_server = nullptr;
+    }
+
+    int port = sv_eventServerPort->value.integer;
+    if (port <= 0)
+        return;
+
+    event_server = new WebSocketServer(EVENT_SERVER_PATH, sv_eventServerToken->value.string, sv_eventServerQueue->value.integer);
+
+    event_server->onSubscribe([](const WebSocketServer::Subscriber& sub) {
+        Com_DPrintf("Event server: subscriber %s connected (policy: %s, queue: %u)\n", sub.remote.c_str(), WebSocketServer::policyToString(sub.policy), (unsigned)sub.queueLimit);
+    });
+    event_server->onUnsubscribe([](const WebSocketServer::Subscriber& sub) {
+        Com_DPrintf("Event server: subscriber %s disconnected (sent: %llu, dropped: %llu)\n", sub.remote.c_str(), (unsigned long long)sub.sent, (unsigned long long)sub.dropped);
+    });
+
+    if (!event_server->listen("http://0.0.0.0:" + std::to_string(port))) {
+        Com_Printf("Event server: failed to listen on port %i\n", port);
+        delete event_server;
+        event_server = nullptr;
+        return;
+    }
+
+    Com_Printf("Event server: listening on ws://0.0.0.0:%i" EVENT_SERVER_PATH "\n", port);
+}
+
+
+void event_server_cmd_status() {
+    if (!event_server) {
+        Com_Printf("Event server is not running, set sv_eventServerPort to enable it.\n");
+        return;
+    }
+    Com_Printf("Event server is listening on port %i, subscribers: %u\n", sv_eventServerPort->value.integer, (unsigned)event_server->subscriberCount());
+    for (const auto& it : event_server->subscribers()) {
+        const WebSocketServer::Subscriber& sub = it.second;
+        Com_Printf("  %-22s policy: %-12s queued: %4u/%-4u sent: %llu dropped: %llu\n", sub.remote.c_str(), WebSocketServer::policyToString(sub.policy),
+            (unsigned)sub.queue.size(), (unsigned)sub.queueLimit, (unsigned long long)sub.sent, (unsigned long long)sub.dropped);
+    }
+}
+
+
+/** Called every frame on frame start. */
+void event_server_frame() {
+
+    // Start, restart or stop the server when cvars are changed
+    if (sv_eventServerPort->modified || sv_eventServerToken->modified || sv_eventServerQueue->modified) {
+        sv_eventServerPort->modified = false;
+        sv_eventServerToken->modified = false;
+        sv_eventServerQueue->modified = false;
+        event_server_start();
+    }
+
+    if (!event_server)
+        return;
+
+    event_server_publishMatchData();
+
+    // Detect disconnected players
+    if (sv_running && sv_running->value.boolean) {
+        for (int i = 0; i < sv_maxclients->value.integer && i < MAX_CLIENTS; i++) {
+            client_t* client = &svs_clients[i];
+            if (event_server_clientStates[i] >= CS_CONNECTED && client->state < CS_CONNECTED) {
+                event_server_publish("player_disconnect", event_server_clientData(i, event_server_clientNames[i], event_server_clientGuids[i]));
+            }
+            event_server_clientStates[i] = client->state;
+        }
+    }
+
+    event_server->poll();
+}
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void event_server_init() {
+    sv_eventServerPort = Dvar_RegisterInt("sv_eventServerPort", 0, 0, 65535, (dvarFlags_e)(DVAR_CHANGEABLE_RESET));
+    sv_eventServerToken = Dvar_RegisterString("sv_eventServerToken", "", (dvarFlags_e)(DVAR_CHANGEABLE_RESET));
+    sv_eventServerQueue = Dvar_RegisterInt("sv_eventServerQueue", 256, 1, 65536, (dvarFlags_e)(DVAR_CHANGEABLE_RESET));
+
+    // Start the server in first frame, so the value from the config is used
+    sv_eventServerPort->modified = true;
+
+    Cmd_AddCommand("eventServerStatus", event_server_cmd_status);
+}
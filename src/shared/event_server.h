@@ -0,0 +1,28 @@
+#ifndef EVENT_SERVER_H
+#define EVENT_SERVER_H
+
+#include <string>
+
+#include "server.h"
+
+struct MatchValue;
+
+// Player fields of the kill line printed by logPrint
+struct EventServerPlayer {
+    int guid;
+    int slot;
+    std::string team;
+    std::string name;
+};
+
+bool event_server_isActive();
+void event_server_publish(const char* type, const std::string& data);
+void event_server_onPlayerConnect(int entnum);
+void event_server_onStartGameType();
+void event_server_onKill(const EventServerPlayer& victim, const EventServerPlayer& attacker, const std::string& weapon, int damage, const std::string& mod, const std::string& hitloc);
+void event_server_onMatchDataChanged(const char* playerKey, const char* key, const MatchValue* value);
+bool event_server_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
+void event_server_frame();
+void event_server_init();
+
+#endif
@@ -1,6 +1,14 @@
 #include "gsc.h"
 
 #include <stdarg.h> // va_list, va_start, va_end
+#include <ctype.h>
+#include <string>
+#include <deque>
+#include <chrono>
+#include <queue>
+#include <vector>
+#include <algorithm>
+#include <climits>
 
 #include "shared.h"
 #include "gsc_test.h"
@@ -8,67 +16,120 @@
 #include "gsc_http.h"
 #include "gsc_websocket.h"
 #include "gsc_player.h"
+#include "gsc_event_server.h"
+#include "gsc_json.h"
+#include "gsc_profile.h"
+#include "gsc_map.h"
+#include "gsc_string.h"
+#include "gsc_spatial.h"
+#include "gsc_file.h"
+#include "gsc_entity.h"
 #include "cod2_common.h"
 #include "cod2_script.h"
 #include "cod2_math.h"
 #include "cod2_server.h"
+#include "cod2_dvars.h"
+#include "cod2_entity.h"
 #include "server.h"
 #include "match.h"
 #include "http_client.h"
+#include "event_server.h"
+#include "event_log.h"
+#include "entity_index.h"
+#include "ordered_map.h"
 
 
 
 int codecallback_OnStopGameType = 0;
 
+dvar_t* sv_scriptCallbackMaxTime;
+dvar_t* sv_scriptCallbackMaxCount;
 
-// Array of custom methods for entities
-scr_method_t scriptMethods[] =
-{
-	#if DEBUG
-	{"test_playerGetName", gsc_test_playerGetName, 0},
-	#endif
-
-	{"getHWID", gsc_player_playerGetHWID, 0},
-	{"getCDKeyHash", gsc_player_playerGetCDKeyHash, 0},
-	{"getAuthorizationStatus", gsc_player_playerGetAuthorizationStatus, 0},
 
-	{"matchPlayerGetData", gsc_match_playerGetData, 0},
-	{"matchPlayerSetData", gsc_match_playerSetData, 0},
-	{"matchPlayerIsAllowed", gsc_match_playerIsAllowed, 0},
-
-	{NULL, NULL, 0} // Terminator
+// Script callback waiting to be executed
+struct GscCallback {
+	void* function;
+	unsigned int generation;
+	std::function<unsigned int()> pushParams;
 };
 
-// Array of custom script functions
-scr_function_t scriptFunctions[] = {
+// Callbacks from network modules are queued and executed in gsc_frame within the time / count budget
+// Generation is increased on complete map change, callbacks from older generation are dropped because their function handles are no longer valid
+std::deque<GscCallback> gsc_callbacks;
+unsigned int gsc_callbacks_generation = 1;
 
-	#if DEBUG
-	{"test_returnUndefined", gsc_test_returnUndefined, 0},
-	{"test_returnBool", gsc_test_returnBool, 0},
-	{"test_returnInt", gsc_test_returnInt, 0},
-	{"test_returnFloat", gsc_test_returnFloat, 0},
-	{"test_returnString", gsc_test_returnString, 0},
-	{"test_returnVector", gsc_test_returnVector, 0},
-	{"test_returnArray", gsc_test_returnArray, 0},
-	{"test_getAll", gsc_test_getAll, 0},
-	{"test_allOk", gsc_test_allOk, 0},
-	#endif
 
-	{"http_fetch", gsc_http_fetch, 0},
+#define GSC_TIMER_MAX_TIMERS 	4096
+#define GSC_TIMER_MAX_ARGS 		8
+#define GSC_TIMER_MAX_MS 		(24 * 60 * 60 * 1000)	// 24 hours
+#define GSC_TIMER_MAX_STALE 	2						// heap is rebuilt when it has more cleared entries than this multiple of timers
 
-	{"websocket_connect", gsc_websocket_connect, 0},
-	{"websocket_sendText", gsc_websocket_sendText, 0},
-	{"websocket_close", gsc_websocket_close, 0},
+// Timer created by setTimeout / setInterval
+struct GscTimer {
+	void* function;
+	int entnum;						// entity the function is called on, -1 if not bound to entity
+	int interval;					// 0 for timeout
+	int due;						// svs_time when the timer fires
+	std::vector<GscValue> args;
+};
 
-	{"matchUploadData", gsc_match_uploadData, 0},
-	{"matchSetData", gsc_match_setData, 0},
-	{"matchGetData", gsc_match_getData, 0},
-	{"matchRedownloadData", gsc_match_redownloadData, 0},
-	{"matchClearData", gsc_match_clearData, 0},
-	{"matchIsActivated", gsc_match_isActivated, 0},
+// Timers by id, heap of (due, id) pairs is used to find next timer without checking all of them
+// Cleared timers stay in the heap and are skipped when they are popped, heap is rebuilt when there are too many of them
+ordered_map<int, GscTimer> gsc_timers;
+std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> gsc_timers_heap;
+int gsc_timers_nextId = 1;
+int gsc_timers_entityCount[MAX_GENTITIES] = {};	// number of timers bound to each entity, cleared when the entity is freed
+
+
+// Custom methods and functions registered by modules, keyed by lowercase name
+// Script names are case insensitive, so the key is lowercased on registration and on lookup
+static ordered_map<std::string, scr_method_t> scriptMethods;
+static ordered_map<std::string, scr_function_t> scriptFunctions;
+
+// Copy lowercase name into the buffer, returns false if the name does not fit
+static bool gsc_lowerName(const char* name, char* buffer, size_t size) {
+	size_t i = 0;
+	for (; name[i]; i++) {
+		if (i + 1 >= size) return false;
+		buffer[i] = (char)tolower((unsigned char)name[i]);
+	}
+	buffer[i] = '\0';
+	return true;
+}
 
-	{NULL, NULL, 0}
-};
+/**
+ * Register custom script function. Should be called from module's init function.
+ * Names are case insensitive, if the name is already registered, the function is not registered and a warning is printed.
+ */
+void gsc_registerFunction(const char* name, xfunction_t call, int developer) {
+	char key[64];
+	if (!gsc_lowerName(name, key, sizeof(key))) {
+		Com_Printf("Error: GSC function name '%s' is too long\n", name);
+		return;
+	}
+	if (scriptFunctions.contains(key)) {
+		Com_Printf("Warning: GSC function '%s' is already registered as '%s'\n", name, scriptFunctions.at(key).name);
+		return;
+	}
+	scriptFunctions[key] = {name, call, developer};
+}
+
+/**
+ * Register custom script method for entities. Should be called from module's init function.
+ * Names are case insensitive, if the name is already registered, the method is not registered and a warning is printed.
+ */
+void gsc_registerMethod(const char* name, xmethod_t call, int developer) {
+	char key[64];
+	if (!gsc_lowerName(name, key, sizeof(key))) {
+		Com_Printf("Error: GSC method name '%s' is too long\n", name);
+		return;
+	}
+	if (scriptMethods.contains(key)) {
+		Com_Printf("Warning: GSC method '%s' is already registered as '%s'\n", name, scriptMethods.at(key).name);
+		return;
+	}
+	scriptMethods[key] = {name, call, developer};
+}
 
 // Array of custom callbacks
 callback_t callbacks[] =
@@ -91,22 +152,23 @@ xfunction_t Scr_GetCustomFunction(const char **fname, int *fdev)
 {
 	// Try to find original function
 	xfunction_t m = Scr_GetFunction(fname, fdev);
-	if ( m )
-		return m;
+	if ( m ) {
+		m = event_log_wrapFunction(*fname, m);
+		return gsc_profile_function(*fname, m);
+	}
 
 	// Try to find new custom function
-	for ( int i = 0; scriptFunctions[i].name; i++ )
-	{
-		if ( strcasecmp(*fname, scriptFunctions[i].name) )
-			continue;
+	char key[64];
+	if ( !gsc_lowerName(*fname, key, sizeof(key)) )
+		return NULL;
 
-		scr_function_t func = scriptFunctions[i];
-		*fname = func.name;
-		*fdev = func.developer;
-		return func.call;
-	}
+	const scr_function_t* func = scriptFunctions.find(key);
+	if ( !func )
+		return NULL;
 
-	return NULL;
+	*fname = func->name;
+	*fdev = func->developer;
+	return gsc_profile_function(func->name, func->call);
 }
 
 // This function is called when scripts are being compiled and method names are being resolved.
@@ -114,41 +176,306 @@ xmethod_t Scr_GetCustomMethod(const char **fname, qboolean *fdev)
 {
 	// Try to find original method
 	xmethod_t m = Scr_GetMethod(fname, fdev);
-	if ( m )
-		return m;
+	if ( m ) {
+		m = gsc_spatial_wrapMethod(*fname, m);
+		return gsc_profile_method(*fname, m);
+	}
 
 	// Try to find new custom method
-	for ( int i = 0; scriptMethods[i].name; i++ )
-	{
-		if ( strcasecmp(*fname, scriptMethods[i].name) )
+	char key[64];
+	if ( !gsc_lowerName(*fname, key, sizeof(key)) )
+		return NULL;
+
+	const scr_method_t* func = scriptMethods.find(key);
+	if ( !func )
+		return NULL;
+
+	*fname = func->name;
+	*fdev = func->developer;
+	return gsc_profile_method(func->name, func->call);
+}
+
+/**
+ * Copy the parameter from the script stack into the value.
+ * Returns false if the type is not supported, the value is not changed in that case.
+ */
+bool gsc_value_get(unsigned int param, GscValue& value) {
+	int type = Scr_GetType(param);
+	switch (type) {
+		case VAR_UNDEFINED: 	break;
+		case VAR_STRING: 		value.stringValue = Scr_GetString(param); break;
+		case VAR_INTEGER: 		value.intValue = Scr_GetInt(param); break;
+		case VAR_FLOAT: 		value.floatValue = Scr_GetFloat(param); break;
+		case VAR_VECTOR: 		Scr_GetVector(param, value.vectorValue); break;
+		default: 				return false;
+	}
+	if (type != VAR_STRING && !value.stringValue.empty())
+		value.stringValue.clear();
+	value.type = type;
+	return true;
+}
+
+/** Push the value to the script stack. */
+void gsc_value_push(const GscValue& value) {
+	switch (value.type) {
+		case VAR_STRING: 	Scr_AddString(value.stringValue.c_str()); break;
+		case VAR_INTEGER: 	Scr_AddInt(value.intValue); break;
+		case VAR_FLOAT: 	Scr_AddFloat(value.floatValue); break;
+		case VAR_VECTOR: 	Scr_AddVector((float*)value.vectorValue); break;
+		default: 			Scr_AddUndefined(); break;
+	}
+}
+
+/**
+ * Returns current script generation, it changes on complete map change or restart.
+ * Should be saved when the script function handle is obtained and passed to gsc_callback_enqueue.
+ */
+unsigned int gsc_callback_generation() {
+	return gsc_callbacks_generation;
+}
+
+/**
+ * Queue script function to be executed at the start of the next frame instead of executing it immediately.
+ * Callback is dropped if the generation does not match, because the script function handle is not valid anymore.
+ * @param function script function handle, nothing is queued if NULL.
+ * @param generation value of gsc_callback_generation() when the function handle was obtained.
+ * @param pushParams function that adds parameters to the script stack in reverse order and returns their count.
+ */
+void gsc_callback_enqueue(void* function, unsigned int generation, std::function<unsigned int()> pushParams) {
+	if (!function || generation != gsc_callbacks_generation)
+		return;
+	gsc_callbacks.push_back(GscCallback{function, generation, std::move(pushParams)});
+}
+
+// Execute queued callbacks, limited by maximum time and count when budget is enabled
+void gsc_callback_execute(bool budget) {
+	if (gsc_callbacks.empty() || !Scr_IsSystemActive())
+		return;
+
+	int maxCount = budget ? sv_scriptCallbackMaxCount->value.integer : 0;
+	int maxTime = budget ? sv_scriptCallbackMaxTime->value.integer : 0;
+	auto start = std::chrono::steady_clock::now();
+
+	// At least one callback is executed every frame so the queue always moves
+	for (int count = 0; !gsc_callbacks.empty(); count++) {
+		if (maxCount > 0 && count >= maxCount)
+			break;
+		if (maxTime > 0 && count > 0 && std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(maxTime))
+			break;
+
+		// Remove the callback before executing, script might cause new callbacks to be queued
+		GscCallback cb = std::move(gsc_callbacks.front());
+		gsc_callbacks.pop_front();
+		if (cb.generation != gsc_callbacks_generation)
 			continue;
 
-		scr_method_t func = scriptMethods[i];
+		int64_t profileStart = gsc_profile_start();
+		unsigned int numParams = cb.pushParams ? cb.pushParams() : 0;
+		unsigned short thread_id = Scr_ExecThread((int)cb.function, numParams);
+		Scr_FreeThread(thread_id);
+		gsc_profile_callback("<queued network callback>", profileStart);
+	}
+}
+
+// Time when the timer fires, svs_time + ms must not overflow
+static int gsc_timer_due(int now, int ms) {
+	return (int)std::min<int64_t>((int64_t)now + ms, INT_MAX);
+}
+
+// Create timer from the parameters, shared by all variants of setTimeout / setInterval
+static void gsc_timer_create(const char* name, int entnum, bool repeat) {
+	unsigned int numParams = Scr_GetNumParam();
+	if (numParams < 2 || numParams > 2 + GSC_TIMER_MAX_ARGS) {
+		Scr_Error(va("%s: invalid number of parameters, expected 2 to %i, got %u\n", name, 2 + GSC_TIMER_MAX_ARGS, numParams));
+		Scr_AddUndefined();
+		return;
+	}
+	if (gsc_timers.size() >= GSC_TIMER_MAX_TIMERS) {
+		Scr_Error(va("%s: too many timers, max %i timers can exist at the same time\n", name, GSC_TIMER_MAX_TIMERS));
+		Scr_AddUndefined();
+		return;
+	}
+
+	GscTimer timer;
+	timer.function = Scr_GetParamFunction(0);
+	timer.entnum = entnum;
+	// Timer fires in the next server frame at the earliest, so timers created from timer function are not called in the same loop
+	int ms = Scr_GetInt(1);
+	if (ms < 1) ms = 1;
+	if (ms > GSC_TIMER_MAX_MS) ms = GSC_TIMER_MAX_MS;
+	timer.interval = repeat ? ms : 0;
+	timer.due = gsc_timer_due(svs_time, ms);
+
+	timer.args.resize(numParams - 2);
+	for (unsigned int i = 2; i < numParams; i++) {
+		if (!gsc_value_get(i, timer.args[i - 2])) {
+			Scr_Error(va("%s: argument at index %u has unsupported type\n", name, i));
+			Scr_AddUndefined();
+			return;
+		}
+	}
+
+	int id = gsc_timers_nextId++;
+	if (gsc_timers_nextId <= 0) gsc_timers_nextId = 1;
+	gsc_timers_heap.push({timer.due, id});
+	gsc_timers[id] = std::move(timer);
+	if (entnum >= 0) gsc_timers_entityCount[entnum]++;
+
+	Scr_AddInt(id);
+}
+
+// Build the heap again from existing timers, so entries of cleared timers do not accumulate
+static void gsc_timer_rebuildHeap() {
+	std::vector<std::pair<int, int>> entries;
+	entries.reserve(gsc_timers.size());
+	for (const auto& e : gsc_timers)
+		entries.push_back({e.value.due, e.key});
+	gsc_timers_heap = decltype(gsc_timers_heap)(std::greater<std::pair<int, int>>(), std::move(entries));
+}
 
-		*fname = func.name;
-		*fdev = func.developer;
+static void gsc_timer_remove(int id) {
+	GscTimer* timer = gsc_timers.find(id);
+	if (!timer) return;
+	if (timer->entnum >= 0) gsc_timers_entityCount[timer->entnum]--;
+	gsc_timers.erase(id);
 
-		return func.call;
+	// Few stale entries are kept, so clearing and creating timers in a loop does not rebuild the heap every time
+	if (gsc_timers_heap.size() > GSC_TIMER_MAX_STALE * gsc_timers.size() + 64)
+		gsc_timer_rebuildHeap();
+}
+
+/**
+ * Call the function once after given time in milliseconds, with optional arguments. Returns timer id for clearTimer.
+ * When called as method, the function is called on the entity and the timer is cleared when the entity is freed.
+ * Arguments can be strings, integers, floats, vectors or undefined. Timers are cleared on map change or restart.
+ * Time is limited to 24 hours.
+ * USAGE: id = setTimeout(::func, ms, [arg1, arg2, ...]);
+ *        id = self setTimeout(::func, ms, [arg1, arg2, ...]);
+ */
+void gsc_timer_setTimeout() {
+	gsc_timer_create("setTimeout", -1, false);
+}
+void gsc_timer_entSetTimeout(scr_entref_t ref) {
+	if (ref.classnum != 0 || ref.entnum >= MAX_GENTITIES) {
+		Scr_Error("setTimeout: timer can be bound only to an entity\n");
+		Scr_AddUndefined();
+		return;
 	}
+	gsc_timer_create("setTimeout", ref.entnum, false);
+}
 
-	return NULL;
+/**
+ * Call the function repeatedly with given interval in milliseconds, with optional arguments. Returns timer id for clearTimer.
+ * Function is called max once per server frame. When called as method, the function is called on the entity
+ * and the timer is cleared when the entity is freed.
+ * USAGE: id = setInterval(::func, ms, [arg1, arg2, ...]);
+ *        id = self setInterval(::func, ms, [arg1, arg2, ...]);
+ */
+void gsc_timer_setInterval() {
+	gsc_timer_create("setInterval", -1, true);
+}
+void gsc_timer_entSetInterval(scr_entref_t ref) {
+	if (ref.classnum != 0 || ref.entnum >= MAX_GENTITIES) {
+		Scr_Error("setInterval: timer can be bound only to an entity\n");
+		Scr_AddUndefined();
+		return;
+	}
+	gsc_timer_create("setInterval", ref.entnum, true);
+}
+
+/**
+ * Cancel the timer created by setTimeout or setInterval. Returns true if the timer existed.
+ * USAGE: clearTimer(id);
+ */
+void gsc_timer_clearTimer() {
+	if (Scr_GetNumParam() != 1) {
+		Scr_Error(va("clearTimer: invalid number of parameters, expected 1, got %u\n", Scr_GetNumParam()));
+		Scr_AddUndefined();
+		return;
+	}
+	int id = Scr_GetInt(0);
+	bool exists = gsc_timers.contains(id);
+	gsc_timer_remove(id);
+	Scr_AddBool(exists);
+}
+
+/** Clear all timers bound to the entity, called when the entity is freed or the player slot is used again */
+void gsc_timer_clearEntity(int entnum) {
+	if (entnum < 0 || entnum >= MAX_GENTITIES || gsc_timers_entityCount[entnum] == 0) return;
+	std::vector<int> ids;
+	for (const auto& e : gsc_timers)
+		if (e.value.entnum == entnum) ids.push_back(e.key);
+	for (int id : ids)
+		gsc_timer_remove(id);
+}
+
+// Fire due timers
+static void gsc_timer_execute() {
+	if (gsc_timers_heap.empty() || !Scr_IsSystemActive())
+		return;
+
+	int now = svs_time;
+	while (!gsc_timers_heap.empty() && gsc_timers_heap.top().first <= now) {
+		std::pair<int, int> top = gsc_timers_heap.top();
+		gsc_timers_heap.pop();
+
+		// Skip cleared timers and old heap entries of rescheduled intervals
+		GscTimer* timer = gsc_timers.find(top.second);
+		if (!timer || timer->due != top.first)
+			continue;
+
+		// Push arguments in reverse order before the timer is changed, script can create or clear timers
+		for (int i = (int)timer->args.size() - 1; i >= 0; i--)
+			gsc_value_push(timer->args[i]);
+		unsigned int numArgs = (unsigned int)timer->args.size();
+		void* function = timer->function;
+		int entnum = timer->entnum;
+
+		if (timer->interval > 0) {
+			// Next call is scheduled from now if the timer is late, so it does not fire more times in one frame
+			timer->due = gsc_timer_due((now - timer->due >= timer->interval) ? now : timer->due, timer->interval);
+			gsc_timers_heap.push({timer->due, top.second});
+		} else {
+			gsc_timer_remove(top.second);
+		}
+
+		int64_t profileStart = gsc_profile_start();
+		unsigned short thread_id = entnum >= 0 ?
+			Scr_ExecEntThreadNum(entnum, 0, (int)function, numArgs) :
+			Scr_ExecThread((int)function, numArgs);
+		Scr_FreeThread(thread_id);
+		gsc_profile_callback("<timer>", profileStart);
+	}
+}
+
+// Remove all timers
+static void gsc_timer_clearAll() {
+	gsc_timers.clear();
+	gsc_timers_heap = decltype(gsc_timers_heap)();
+	memset(gsc_timers_entityCount, 0, sizeof(gsc_timers_entityCount));
 }
 
 // Called when CodeCallback_PlayerConnect is called
 void gsc_onPlayerConnect(int entnum) {
+	gsc_timer_clearEntity(entnum); // timers of the previous player in this slot
 	gsc_test_onPlayerConnect(entnum);
 	gsc_match_onPlayerConnect(entnum);
+	event_server_onPlayerConnect(entnum);
 }
 short CodeCallback_PlayerConnect_Win32(int entnum, int classnum, int paramcount) {
 	int handle; ASM( movr, handle, "eax" );
 	gsc_onPlayerConnect(entnum);
 	short ret;
+	int64_t profileStart = gsc_profile_start();
 	ASM_CALL(RETURN(ret), 0x00482190, 3, EAX(handle), PUSH(entnum), PUSH(classnum), PUSH(paramcount));
+	gsc_profile_callback("CodeCallback_PlayerConnect", profileStart);
 	return ret;
 }
 void CodeCallback_PlayerConnect_Linux(gentity_t *ent) {
 	gsc_onPlayerConnect(ent->s.number);
+	int64_t profileStart = gsc_profile_start();
 	ASM_CALL(RETURN_VOID, 0x08118350, 1, PUSH(ent));
+	gsc_profile_callback("CodeCallback_PlayerConnect", profileStart);
 }
 
 
@@ -157,17 +484,23 @@ void gsc_onStartGameType() {
 	gsc_test_onStartGameType();
 	match_onStartGameType();
 	gsc_match_onStartGameType();
+	event_server_onStartGameType();
+	event_log_onStartGameType();
 }
 short CodeCallback_StartGameType_Win32(int paramcount) {
 	int handle; ASM( movr, handle, "eax" );
 	gsc_onStartGameType();
 	short ret;
+	int64_t profileStart = gsc_profile_start();
 	ASM_CALL(RETURN(ret), 0x00482080, 1, EAX(handle), PUSH(paramcount));
+	gsc_profile_callback("CodeCallback_StartGameType", profileStart);
 	return ret;
 }
 void CodeCallback_StartGameType_Linux() {
 	gsc_onStartGameType();
+	int64_t profileStart = gsc_profile_start();
 	ASM_CALL(RETURN_VOID, 0x08118322);
+	gsc_profile_callback("CodeCallback_StartGameType", profileStart);
 }
 
 
@@ -208,6 +541,9 @@ void Scr_ShutdownSystem_Win32(int bComplete) {
  */
 bool gsc_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source) {
 
+	// Deliver results that are already received (like websocket close) to the current level before it ends
+	gsc_callback_execute(false);
+
 	// Call the OnStopGameType callback if it exists
 	if (codecallback_OnStopGameType && Scr_IsSystemActive())
 	{
@@ -219,10 +555,30 @@ bool gsc_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown
 		Scr_AddBool(shutdown);
 		Scr_AddBool(bComplete);
 		Scr_AddBool(fromScript);
+		int64_t profileStart = gsc_profile_start();
 		unsigned short thread_id = Scr_ExecThread(codecallback_OnStopGameType, 3);
 		Scr_FreeThread(thread_id);
+		gsc_profile_callback("CodeCallback_StopGameType", profileStart);
+	}
+
+	// Function handles are not valid after complete map change, drop callbacks that would arrive later
+	if (bComplete || shutdown) {
+		if (!gsc_callbacks.empty())
+			Com_DPrintf("Dropping %u queued script callbacks\n", (unsigned)gsc_callbacks.size());
+		gsc_callbacks.clear();
+		gsc_callbacks_generation++;
+
+		// Map handles are stored in script variables that are lost
+		gsc_map_freeAll();
 	}
 
+	// String builders and timers are meant to be used within one level
+	gsc_string_freeAll();
+	gsc_timer_clearAll();
+
+	// Entities are respawned and their script strings might be reused for different values
+	entity_index_clear();
+
 	return true;
 }
 
@@ -230,12 +586,40 @@ bool gsc_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown
 void gsc_frame() {
 	gsc_http_frame();
 	gsc_websocket_frame();
+	gsc_file_frame();
+
+	gsc_callback_execute(true);
+	gsc_timer_execute();
 }
 
 /** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
 void gsc_init() {
+	sv_scriptCallbackMaxTime = Dvar_RegisterInt("sv_scriptCallbackMaxTime", 5, 0, 1000, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // ms per frame, 0 = unlimited
+	sv_scriptCallbackMaxCount = Dvar_RegisterInt("sv_scriptCallbackMaxCount", 64, 0, 65536, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // per frame, 0 = unlimited
+
+	gsc_profile_init();
+	#if DEBUG
+	gsc_test_init();
+	#endif
+	gsc_player_init();
+	gsc_match_init();
 	gsc_http_init();
 	gsc_websocket_init();
+	gsc_event_server_init();
+	gsc_json_init();
+	gsc_map_init();
+	gsc_string_init();
+	gsc_spatial_init();
+	gsc_file_init();
+	gsc_entity_init();
+
+	gsc_registerFunction("setTimeout", gsc_timer_setTimeout);
+	gsc_registerFunction("setInterval", gsc_timer_setInterval);
+	gsc_registerFunction("clearTimer", gsc_timer_clearTimer);
+	gsc_registerMethod("setTimeout", gsc_timer_entSetTimeout);
+	gsc_registerMethod("setInterval", gsc_timer_entSetInterval);
+
+	Com_DPrintf("Registered %u custom GSC functions and %u methods\n", (unsigned)scriptFunctions.size(), (unsigned)scriptMethods.size());
 }
 
 /** Called before the entry point is called. Used to patch the memory. */
@@ -254,4 +638,6 @@ void gsc_patch()
 		patch_call(0x004fe43a, (unsigned int)CodeCallback_PlayerConnect_Win32),
 		patch_call(0x080f9091, (unsigned int)CodeCallback_PlayerConnect_Linux);
 	);
+
+	entity_index_patch();
 }
\ No newline at end of file
@@ -1,9 +1,34 @@
 #ifndef GSC_H
 #define GSC_H
 
+#include <string>
+#include <functional>
+
 #include "server.h"
+#include "cod2_script.h"
+#include "cod2_math.h"
+
+// Script value copied from the script stack, so it can be kept after the builtin returns
+// Supported types are undefined, string, integer, float and vector
+struct GscValue {
+	int type = VAR_UNDEFINED;
+	int intValue = 0;
+	float floatValue = 0;
+	vec3_t vectorValue = {0, 0, 0};
+	std::string stringValue;
+};
+
+void gsc_registerFunction(const char* name, xfunction_t call, int developer = 0);
+void gsc_registerMethod(const char* name, xmethod_t call, int developer = 0);
+
+bool gsc_value_get(unsigned int param, GscValue& value);
+void gsc_value_push(const GscValue& value);
+
+unsigned int gsc_callback_generation();
+void gsc_callback_enqueue(void* function, unsigned int generation, std::function<unsigned int()> pushParams = nullptr);
 
 bool gsc_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
+void gsc_timer_clearEntity(int entnum);
 void gsc_frame();
 void gsc_init();
 void gsc_patch();
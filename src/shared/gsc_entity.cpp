@@ -0,0 +1,54 @@
+#include "gsc_entity.h"
+#include "gsc.h"
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_script.h"
+#include "entity_index.h"
+
+// Script queries of the entity index.
+
+static void gsc_entity_find(const char* function, entity_index_field_e field) {
+	if (Scr_GetNumParam() != 1) {
+		Scr_Error(va("%s: invalid number of parameters, expected 1, got %u\n", function, Scr_GetNumParam()));
+		Scr_AddUndefined();
+		return;
+	}
+
+	static int result[MAX_GENTITIES];
+	int count = entity_index_find(field, Scr_GetString(0), result, MAX_GENTITIES);
+
+	Scr_MakeArray();
+	for (int i = 0; i < count; i++) {
+		Scr_AddEntity(&g_entities[result[i]]);
+		Scr_AddArray();
+	}
+}
+
+
+/**
+ * Returns array of entities with the classname, sorted by entity number.
+ * Same as getEntArray(classname, "classname"), but without checking all entities.
+ * USAGE: ents = getEntsByClassname(classname);
+ */
+void gsc_entity_getEntsByClassname() {
+	gsc_entity_find("getEntsByClassname", ENTITY_INDEX_CLASSNAME);
+}
+
+/**
+ * Returns array of entities with the targetname, sorted by entity number.
+ * Same as getEntArray(targetname, "targetname"), but without checking all entities.
+ * USAGE: ents = getEntsByTargetname(targetname);
+ */
+void gsc_entity_getEntsByTargetname() {
+	gsc_entity_find("getEntsByTargetname", ENTITY_INDEX_TARGETNAME);
+}
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_entity_init() {
+	entity_index_clear();
+
+	gsc_registerFunction("getEntsByClassname", gsc_entity_getEntsByClassname);
+	gsc_registerFunction("getEntsByTargetname", gsc_entity_getEntsByTargetname);
+}
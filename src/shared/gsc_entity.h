@@ -0,0 +1,10 @@
+#ifndef GSC_ENTITY_H
+#define GSC_ENTITY_H
+
+#include "cod2_script.h"
+
+void gsc_entity_getEntsByClassname();
+void gsc_entity_getEntsByTargetname();
+void gsc_entity_init();
+
+#endif
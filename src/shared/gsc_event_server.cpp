@@ -0,0 +1,60 @@
+#include "gsc_event_server.h"
+#include "gsc.h"
+
+#include <string>
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_script.h"
+#include "event_server.h"
+#include "json_writer.h"
+#include "gsc_json.h"
+
+
+/**
+ * Broadcast custom event to all subscribers of the event server.
+ * Values are written into the "data" object of the event as JSON values, numbers stay numbers and arrays are encoded like json_encode.
+ * Kills are published automatically as "kill" events from the K; lines printed by logPrint.
+ * Returns true if the event was sent, false if there are no subscribers.
+ * USAGE: eventServer_broadcast(type[, key, value, ...])
+ * Example:
+ *   eventServer_broadcast("bomb_planted", "player", self.name, "site", "A", "timeLeft", 45.5);
+ */
+void gsc_event_server_broadcast() {
+	unsigned int numParams = Scr_GetNumParam();
+
+	if (numParams < 1 || numParams % 2 != 1) {
+		Scr_Error(va("eventServer_broadcast: expected type and key-value pairs, got %u parameters", numParams));
+		Scr_AddBool(false);
+		return;
+	}
+
+	if (!event_server_isActive()) {
+		Scr_AddBool(false);
+		return;
+	}
+
+	const char* type = Scr_GetString(0);
+
+	JsonWriter json(256);
+	json.raw("{");
+	for (unsigned int i = 1; i + 1 < numParams; i += 2) {
+		if (i > 1) json.raw(",");
+		json.string(Scr_GetString(i)).raw(":");
+		if (!gsc_json_writeParam(json, i + 1)) {
+			Scr_Error(va("eventServer_broadcast: value of '%s' has unsupported type", Scr_GetString(i)));
+			Scr_AddBool(false);
+			return;
+		}
+	}
+	json.raw("}");
+
+	event_server_publish(type, json.str());
+
+	Scr_AddBool(true);
+}
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_event_server_init() {
+	gsc_registerFunction("eventServer_broadcast", gsc_event_server_broadcast);
+}
@@ -0,0 +1,7 @@
+#ifndef GSC_EVENT_SERVER_H
+#define GSC_EVENT_SERVER_H
+
+void gsc_event_server_broadcast();
+void gsc_event_server_init();
+
+#endif
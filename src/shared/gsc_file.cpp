@@ -0,0 +1,399 @@
+#include "gsc_file.h"
+#include "gsc.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>   // mkdir
+
+#include "shared.h"
+#if COD2X_WIN32
+    #include <windows.h>
+    #include <direct.h> // _mkdir
+    #include <io.h>     // _get_osfhandle
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#include "cod2_common.h"
+#include "cod2_dvars.h"
+#include "cod2_script.h"
+
+// Asynchronous file access for scripts.
+// Files are read and written by one worker thread in the order the requests were made, so appends to one file keep their order.
+// Results are passed to the main thread in gsc_file_frame and script callbacks are called via the script callback queue.
+// Paths are relative to fs_homepath, absolute paths and ".." are not allowed.
+
+#define GSC_FILE_MAX_SIZE       (1024 * 1024)   // max size of file to read or data to write
+#define GSC_FILE_MAX_PENDING    256             // max number of requests waiting for the worker
+#define GSC_FILE_SHUTDOWN_MS    2000            // max time to wait for pending writes on shutdown
+
+struct GscFileJob {
+    enum Type { READ, WRITE, APPEND };
+
+    Type type;
+    std::string path;           // full path
+    size_t baseLen;             // length of fs_homepath in the path, directories after it are created if needed
+    std::string data;           // data to write, or data that was read
+    std::string error;          // empty if ok
+    void* onDone;
+    void* onError;
+    unsigned int generation;
+};
+
+static struct {
+    std::deque<GscFileJob> pending;     // waiting for the worker
+    std::deque<GscFileJob> finished;    // waiting for the main thread
+    bool running;
+    bool busy;                          // worker is processing a job
+    bool initialized;
+    #if COD2X_WIN32
+        CRITICAL_SECTION cs;
+    #else
+        pthread_mutex_t cs;
+    #endif
+} gsc_file;
+
+
+static void gsc_file_lock() {
+    #if COD2X_WIN32
+        EnterCriticalSection(&gsc_file.cs);
+    #else
+        pthread_mutex_lock(&gsc_file.cs);
+    #endif
+}
+
+static void gsc_file_unlock() {
+    #if COD2X_WIN32
+        LeaveCriticalSection(&gsc_file.cs);
+    #else
+        pthread_mutex_unlock(&gsc_file.cs);
+    #endif
+}
+
+static void gsc_file_sleep(int ms) {
+    #if COD2X_WIN32
+        Sleep(ms);
+    #else
+        usleep(ms * 1000);
+    #endif
+}
+
+
+// Check that the path is relative and stays inside the base directory, converts the separators
+static bool gsc_file_checkPath(const char* path, std::string& result) {
+    size_t len = strlen(path);
+    if (len == 0 || len > 256)
+        return false;
+    if (path[0] == '/' || path[0] == '\\' || strchr(path, ':') != NULL)
+        return false;
+
+    result.clear();
+    const char* part = path;
+    for (const char* c = path; ; c++) {
+        if (*c == '/' || *c == '\\' || *c == '\0') {
+            size_t partLen = c - part;
+            // Empty parts, "." and ".." are not allowed
+            if (partLen == 0 || (partLen == 1 && part[0] == '.') || (partLen == 2 && part[0] == '.' && part[1] == '.'))
+                return false;
+            if (!result.empty()) result += WL('\\', '/');
+            result.append(part, partLen);
+            if (*c == '\0') break;
+            part = c + 1;
+        } else if ((unsigned char)*c < 32) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Create directories of the file path, base directory must exist
+static void gsc_file_createDirectories(const std::string& path, size_t baseLen) {
+    for (size_t i = baseLen + 1; i < path.size(); i++) {
+        if (path[i] != '/' && path[i] != '\\') continue;
+        std::string dir = path.substr(0, i);
+        #if COD2X_WIN32
+            _mkdir(dir.c_str());
+        #else
+            mkdir(dir.c_str(), 0755);
+        #endif
+    }
+}
+
+static void gsc_file_read(GscFileJob& job) {
+    FILE* f = fopen(job.path.c_str(), "rb");
+    if (!f) {
+        job.error = "file not found";
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0 || size > GSC_FILE_MAX_SIZE) {
+        fclose(f);
+        job.error = "file is too big";
+        return;
+    }
+    job.data.resize(size);
+    if (size > 0 && fread(&job.data[0], 1, size, f) != (size_t)size)
+        job.error = "read failed";
+    fclose(f);
+
+    // Script strings are null terminated
+    if (job.error.empty() && memchr(job.data.data(), '\0', job.data.size()) != NULL)
+        job.error = "file contains binary data";
+}
+
+// Write to temporary file and replace the original, so the file is never left half written
+static void gsc_file_write(GscFileJob& job) {
+    gsc_file_createDirectories(job.path, job.baseLen);
+
+    std::string tmp = job.path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        job.error = "cannot open file for writing";
+        return;
+    }
+    bool ok = fwrite(job.data.data(), 1, job.data.size(), f) == job.data.size();
+    ok = fflush(f) == 0 && ok;
+    #if COD2X_WIN32
+        ok = FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(f))) && ok;
+    #else
+        ok = fsync(fileno(f)) == 0 && ok;
+    #endif
+    ok = fclose(f) == 0 && ok;
+
+    #if COD2X_WIN32
+        ok = ok && MoveFileExA(tmp.c_str(), job.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    #else
+        ok = ok && rename(tmp.c_str(), job.path.c_str()) == 0;
+    #endif
+    if (!ok) {
+        remove(tmp.c_str());
+        job.error = "write failed";
+    }
+}
+
+static void gsc_file_append(GscFileJob& job) {
+    gsc_file_createDirectories(job.path, job.baseLen);
+
+    FILE* f = fopen(job.path.c_str(), "ab");
+    if (!f) {
+        job.error = "cannot open file for writing";
+        return;
+    }
+    bool ok = fwrite(job.data.data(), 1, job.data.size(), f) == job.data.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+        job.error = "write failed";
+}
+
+
+static void gsc_file_worker() {
+    gsc_file_lock();
+    while (!gsc_file.pending.empty()) {
+        GscFileJob job = std::move(gsc_file.pending.front());
+        gsc_file.pending.pop_front();
+        gsc_file.busy = true;
+        gsc_file_unlock();
+
+        switch (job.type) {
+            case GscFileJob::READ:      gsc_file_read(job); break;
+            case GscFileJob::WRITE:     gsc_file_write(job); job.data.clear(); break;
+            case GscFileJob::APPEND:    gsc_file_append(job); job.data.clear(); break;
+        }
+
+        gsc_file_lock();
+        gsc_file.busy = false;
+        gsc_file.finished.push_back(std::move(job));
+    }
+    gsc_file.running = false;
+    gsc_file_unlock();
+}
+
+#if COD2X_WIN32
+static DWORD WINAPI gsc_file_workerThread(LPVOID) {
+    gsc_file_worker();
+    return 0;
+}
+#else
+static void* gsc_file_workerThread(void*) {
+    gsc_file_worker();
+    return NULL;
+}
+#endif
+
+// Start the worker thread if not running. Must be called with the lock held.
+static void gsc_file_startWorker() {
+    if (gsc_file.running)
+        return;
+    gsc_file.running = true;
+
+    #if COD2X_WIN32
+        HANDLE thread = CreateThread(NULL, 0, gsc_file_workerThread, NULL, 0, NULL);
+        if (thread) CloseHandle(thread);
+        else gsc_file.running = false;
+    #else
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, gsc_file_workerThread, NULL) == 0) pthread_detach(thread);
+        else gsc_file.running = false;
+    #endif
+}
+
+
+// Add request from script parameters, shared by all file functions
+static void gsc_file_request(const char* name, GscFileJob::Type type) {
+    unsigned int expected = type == GscFileJob::READ ? 3 : 4;
+    unsigned int numParams = Scr_GetNumParam();
+    if (numParams < expected - 2 || numParams > expected) {
+        Scr_Error(va("%s: invalid number of parameters, expected %u to %u, got %u\n", name, expected - 2, expected, numParams));
+        Scr_AddUndefined();
+        return;
+    }
+
+    const char* path = Scr_GetString(0);
+    GscFileJob job;
+    if (!gsc_file_checkPath(path, job.path)) {
+        Scr_Error(va("%s: invalid path '%s', only relative paths inside fs_homepath are allowed\n", name, path));
+        Scr_AddUndefined();
+        return;
+    }
+    std::string base = Dvar_GetString("fs_homepath");
+    job.baseLen = base.size();
+    job.path = base + WL("\\", "/") + job.path;
+    job.type = type;
+
+    unsigned int callbacks = 1;
+    if (type != GscFileJob::READ) {
+        job.data = Scr_GetString(1);
+        callbacks = 2;
+        if (job.data.size() > GSC_FILE_MAX_SIZE) {
+            Scr_Error(va("%s: data is too big, max size is %i bytes\n", name, GSC_FILE_MAX_SIZE));
+            Scr_AddUndefined();
+            return;
+        }
+    }
+    job.onDone = numParams > callbacks ? Scr_GetParamFunction(callbacks) : NULL;
+    job.onError = numParams > callbacks + 1 ? Scr_GetParamFunction(callbacks + 1) : NULL;
+    job.generation = gsc_callback_generation();
+
+    gsc_file_lock();
+    if (gsc_file.pending.size() >= GSC_FILE_MAX_PENDING) {
+        gsc_file_unlock();
+        Scr_Error(va("%s: too many pending file requests, max is %i\n", name, GSC_FILE_MAX_PENDING));
+        Scr_AddUndefined();
+        return;
+    }
+    gsc_file.pending.push_back(std::move(job));
+    gsc_file_startWorker();
+    gsc_file_unlock();
+
+    Scr_AddBool(true);
+}
+
+/**
+ * Read the file in background thread. Path is relative to fs_homepath.
+ *   onDone is called with (data)
+ *   onError is called with (error)
+ * USAGE: file_readAsync(path, [onDone], [onError]);
+ * Example:
+ *   file_readAsync("stats/" + guid + ".txt", ::onStatsLoaded, ::onStatsError);
+ */
+void gsc_file_readAsync() {
+    gsc_file_request("file_readAsync", GscFileJob::READ);
+}
+
+/**
+ * Write the data to the file in background thread, the file is replaced.
+ * Data is written to temporary file first and then renamed, so the file contains either the old or the new data.
+ * Missing directories are created.
+ *   onDone is called without parameters
+ *   onError is called with (error)
+ * USAGE: file_writeAsync(path, data, [onDone], [onError]);
+ */
+void gsc_file_writeAsync() {
+    gsc_file_request("file_writeAsync", GscFileJob::WRITE);
+}
+
+/**
+ * Append the data to the end of the file in background thread, the file is created if it does not exist.
+ * Requests are processed in order, so appends keep the order in which they were called.
+ * USAGE: file_appendAsync(path, data, [onDone], [onError]);
+ */
+void gsc_file_appendAsync() {
+    gsc_file_request("file_appendAsync", GscFileJob::APPEND);
+}
+
+
+/**
+ * Called before a map change, restart or shutdown that can be triggered from a script or a command.
+ * Returns true to proceed, false to cancel the operation. Return value is ignored when shutdown is true.
+ * @param fromScript true if map change was triggered from a script, false if from a command.
+ * @param bComplete true if map change or restart is complete, false if it's a round restart so persistent variables are kept.
+ * @param shutdown true if the server is shutting down, false otherwise.
+ * @param source the source of the map change or restart.
+ */
+bool gsc_file_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source) {
+
+    // Requests continue in the background on map change, their callbacks are dropped by the callback queue
+    // On shutdown, wait a moment for pending writes so the data is not lost
+    if (shutdown && gsc_file.initialized) {
+        for (int waited = 0; waited < GSC_FILE_SHUTDOWN_MS; waited += 10) {
+            gsc_file_lock();
+            bool idle = gsc_file.pending.empty() && !gsc_file.busy;
+            gsc_file_unlock();
+            if (idle) break;
+            gsc_file_sleep(10);
+        }
+    }
+
+    return true;
+}
+
+/** Called every frame on frame start. */
+void gsc_file_frame() {
+    if (!gsc_file.initialized)
+        return;
+
+    std::deque<GscFileJob> finished;
+    gsc_file_lock();
+    finished.swap(gsc_file.finished);
+    gsc_file_unlock();
+
+    for (GscFileJob& job : finished) {
+        if (!job.error.empty()) {
+            if (job.onError) {
+                gsc_callback_enqueue(job.onError, job.generation, [error = std::move(job.error)]() {
+                    Scr_AddString(error.c_str());
+                    return 1u;
+                });
+            } else {
+                Com_Printf("File error %s: %s\n", job.path.c_str(), job.error.c_str());
+            }
+        } else if (job.type == GscFileJob::READ) {
+            gsc_callback_enqueue(job.onDone, job.generation, [data = std::move(job.data)]() {
+                Scr_AddString(data.c_str());
+                return 1u;
+            });
+        } else {
+            gsc_callback_enqueue(job.onDone, job.generation);
+        }
+    }
+}
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_file_init() {
+    #if COD2X_WIN32
+        InitializeCriticalSection(&gsc_file.cs);
+    #else
+        pthread_mutex_init(&gsc_file.cs, NULL);
+    #endif
+    gsc_file.initialized = true;
+
+    gsc_registerFunction("file_readAsync", gsc_file_readAsync);
+    gsc_registerFunction("file_writeAsync", gsc_file_writeAsync);
+    gsc_registerFunction("file_appendAsync", gsc_file_appendAsync);
+}
@@ -0,0 +1,13 @@
+#ifndef GSC_FILE_H
+#define GSC_FILE_H
+
+#include "server.h"
+
+void gsc_file_readAsync();
+void gsc_file_writeAsync();
+void gsc_file_appendAsync();
+bool gsc_file_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
+void gsc_file_frame();
+void gsc_file_init();
+
+#endif
@@ -1,14 +1,36 @@
 #include "gsc_http.h"
+#include "gsc.h"
 
 #include "shared.h"
 #include "cod2_common.h"
 #include "cod2_script.h"
+#include "cod2_dvars.h"
+#include "cod2_cmd.h"
 #include "http_client.h"
+#include "http_cache.h"
 #include "server.h"
+#include "outbox.h"
 
+#include <map>
+
+
+// Pending request, kept so it can be moved to the outbox on shutdown
+struct GscHttpRequest {
+    std::string method;
+    std::string url;
+    std::string data;
+    std::string headers;
+};
 
 HttpClient* gsc_http_client = nullptr;
-int gsc_http_pending_requests = 0;
+std::map<int, GscHttpRequest> gsc_http_pending_requests;
+int gsc_http_request_id = 0;
+
+HttpCache* gsc_http_cache = nullptr;
+
+dvar_t* sv_httpCacheSize;
+dvar_t* sv_httpCacheTTL;
+dvar_t* sv_httpCacheDisk;
 
 
 /**
@@ -18,6 +40,9 @@ int gsc_http_pending_requests = 0;
  *   onDoneCallback is called with (status, body, headers[])
  *   onErrorCallback is called with (error)
  * Headers needs to be separated by \r\n, e.g. "Content-Type: application/json\r\nAccept: application/json"
+ * If sv_httpCacheSize is set, GET responses are cached according to Cache-Control / ETag / Last-Modified headers.
+ * Fresh cached response completes the request immediately without network access, but the onDoneCallback is queued
+ * like other network callbacks and called at the start of next frame, because scripts cannot be re-entered from a builtin.
  * Example:
  * http_fetch("https://url.com/post", "POST", "{data: true}", "Header:Value\r\nHeader2:Value2", 5000, ::onDoneCallback, ::onErrorCallback)
  */
@@ -36,22 +61,13 @@ void gsc_http_fetch() {
 	int timeout = Scr_GetInt(4);
 	void* onDoneCallback = Scr_GetParamFunction(5);
 	void* onErrorCallback = Scr_GetParamFunction(6);
+	unsigned int generation = gsc_callback_generation();
 
-	if (!gsc_http_client) {
-		gsc_http_client = new HttpClient();
-	}
-
-    // Increase pending requests count
-    gsc_http_pending_requests++;
-
-	gsc_http_client->request(method, url, data, headers,
-		[onDoneCallback](const HttpClient::Response& res) {
-            gsc_http_pending_requests--;
-
-			// Handle successful response
-			if (onDoneCallback /*&& Scr_IsSystemActive()*/)
-			{
+	gsc_http_request(method, url, data, headers, timeout,
+		[onDoneCallback, generation](const HttpClient::Response& res) {
 
+			// Handle successful response in the next frame
+			gsc_callback_enqueue(onDoneCallback, generation, [res]() {
 				// Add headers to the script engine
 				Scr_MakeArray();
 				for (const auto& header : res.headers) {
@@ -62,30 +78,49 @@ void gsc_http_fetch() {
 				}
 				Scr_AddString(res.body.c_str());
 				Scr_AddInt(res.status);
+				return 3u;
+			});
+
+		}, [onErrorCallback, url = std::string(url), generation](const std::string& error) {
 
-				// Run function that print test was OK
-				short thread_id = Scr_ExecThread((int)onDoneCallback, 3);
-				Scr_FreeThread(thread_id);
+			if (onErrorCallback) {
+				gsc_callback_enqueue(onErrorCallback, generation, [error]() {
+					Scr_AddString(error.c_str());
+					return 1u;
+				});
+			} else {
+				Com_Printf("HTTP error while fetching %s: %s\n", url.c_str(), error.c_str());
 			}
+		}
+	);
+}
 
-		}, [onErrorCallback, url](const std::string& error) {
-            gsc_http_pending_requests--;
 
-			if (onErrorCallback && Scr_IsSystemActive())
-			{
-				Scr_AddString(error.c_str());
+/**
+ * Send the request by the client shared by http_fetch, with the response cache and the outbox fallback on shutdown.
+ * Callbacks are called from gsc_http_frame, or immediately if a fresh response is cached.
+ */
+void gsc_http_request(const char* method, const char* url, const char* data, const char* headers, int timeout, HttpClient::Callback onDone, HttpClient::ErrorCallback onError) {
 
-				// Run function that print test was OK
-				short thread_id = Scr_ExecThread((int)onErrorCallback, 1);
-				Scr_FreeThread(thread_id);
-			} else {
-				Com_Printf("HTTP error while fetching %s: %s\n", url, error.c_str());
-			}
+	if (!gsc_http_client) {
+		gsc_http_client = new HttpClient();
+	}
+	gsc_http_client->cache = gsc_http_cache;
+
+    int requestId = ++gsc_http_request_id;
+    gsc_http_pending_requests[requestId] = GscHttpRequest{method, url, data, headers};
+
+	gsc_http_client->request(method, url, data, headers,
+		[onDone = std::move(onDone), requestId](const HttpClient::Response& res) {
+            gsc_http_pending_requests.erase(requestId);
+			if (onDone) onDone(res);
+		},
+		[onError = std::move(onError), requestId](const std::string& error) {
+            gsc_http_pending_requests.erase(requestId);
+			if (onError) onError(error);
 		},
 		timeout
 	);
-
-
 }
 
 
@@ -101,23 +136,69 @@ bool gsc_http_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shu
 
     if (shutdown && gsc_http_client) {
 
-        if (gsc_http_pending_requests > 0) {
-            // Since server is shutting down, Com_Frame is not called, so we need to poll here to process the pending requests (max 1 sec)
-            for(int i = 0; i < 10 && gsc_http_pending_requests > 0; i++) {
-                gsc_http_client->poll(100);
+        // Since server is shutting down, Com_Frame is not called and pending requests would be lost
+        // Dont wait for them, requests that send data are saved to the outbox and sent in the background or after restart
+        for (const auto& it : gsc_http_pending_requests) {
+            const GscHttpRequest& req = it.second;
+            if (Q_stricmp(req.method.c_str(), "GET") != 0 && Q_stricmp(req.method.c_str(), "HEAD") != 0) {
+                outbox_add(req.method.c_str(), req.url.c_str(), req.headers, req.data);
             }
         }
+        gsc_http_pending_requests.clear();
 
         delete gsc_http_client;
         gsc_http_client = nullptr;
     }
 
+    if (shutdown && gsc_http_cache) {
+        delete gsc_http_cache;
+        gsc_http_cache = nullptr;
+    }
+
 
 	return true;
 }
 
+void gsc_http_cache_update() {
+    if (sv_httpCacheSize->value.integer <= 0) {
+        delete gsc_http_cache;
+        gsc_http_cache = nullptr;
+        if (gsc_http_client) gsc_http_client->cache = nullptr;
+        return;
+    }
+
+    std::string dir;
+    if (sv_httpCacheDisk->value.boolean) {
+        dir = std::string(Dvar_GetString("fs_homepath")) + WL("\\", "/") + "httpcache";
+    }
+
+    if (!gsc_http_cache)
+        gsc_http_cache = new HttpCache();
+    gsc_http_cache->setMaxBytes((size_t)sv_httpCacheSize->value.integer * 1024);
+    gsc_http_cache->setDefaultTtl(sv_httpCacheTTL->value.integer);
+    gsc_http_cache->setDirectory(dir);
+}
+
+void gsc_http_cmd_cacheStatus() {
+    if (!gsc_http_cache) {
+        Com_Printf("HTTP cache is disabled, set sv_httpCacheSize to enable it.\n");
+        return;
+    }
+    Com_Printf("HTTP cache: %u responses, %u / %u KB, hits: %llu, disk hits: %llu, misses: %llu, revalidated: %llu\n",
+        (unsigned)gsc_http_cache->count(), (unsigned)(gsc_http_cache->bytes() / 1024), (unsigned)(gsc_http_cache->maxBytes() / 1024),
+        (unsigned long long)gsc_http_cache->hits(), (unsigned long long)gsc_http_cache->diskHits(),
+        (unsigned long long)gsc_http_cache->misses(), (unsigned long long)gsc_http_cache->revalidatedCount());
+}
+
 /** Called every frame on frame start. */
 void gsc_http_frame() {
+    if (sv_httpCacheSize->modified || sv_httpCacheTTL->modified || sv_httpCacheDisk->modified) {
+        sv_httpCacheSize->modified = false;
+        sv_httpCacheTTL->modified = false;
+        sv_httpCacheDisk->modified = false;
+        gsc_http_cache_update();
+    }
+
     if (gsc_http_client) {
         gsc_http_client->poll();
     }
@@ -125,4 +206,11 @@ void gsc_http_frame() {
 
 /** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
 void gsc_http_init() {
+    gsc_registerFunction("http_fetch", gsc_http_fetch);
+
+    sv_httpCacheSize = Dvar_RegisterInt("sv_httpCacheSize", 0, 0, 65536, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // in KB, 0 = disabled
+    sv_httpCacheTTL = Dvar_RegisterInt("sv_httpCacheTTL", 0, 0, 86400, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // seconds, used if server does not send max-age
+    sv_httpCacheDisk = Dvar_RegisterBool("sv_httpCacheDisk", false, (dvarFlags_e)(DVAR_CHANGEABLE_RESET));
+
+    Cmd_AddCommand("httpCacheStatus", gsc_http_cmd_cacheStatus);
 }
@@ -2,9 +2,11 @@
 #define GSC_HTTP_H
 
 #include "server.h"
+#include "http_client.h"
 
 bool gsc_http_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
 void gsc_http_fetch();
+void gsc_http_request(const char* method, const char* url, const char* data, const char* headers, int timeout, HttpClient::Callback onDone, HttpClient::ErrorCallback onError);
 void gsc_http_frame();
 void gsc_http_init();
 
@@ -0,0 +1,322 @@
+#include "gsc_json.h"
+#include "gsc.h"
+
+#include <cmath>
+#include <climits>
+#include <string>
+#include <vector>
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_script.h"
+#include "json_writer.h"
+
+#define GSC_JSON_MAX_SIZE       (256 * 1024)    // max length of JSON string to decode
+#define GSC_JSON_MAX_DEPTH      16              // max nesting of arrays and objects, each level uses one slot of the script stack
+#define GSC_JSON_MAX_NODES      8192            // max number of values, each value uses one script variable
+
+
+// Count values and check nesting of the parsed document. Returns false if the limits are exceeded.
+static bool gsc_json_checkLimits(const cJSON* item, int depth, int* nodes) {
+	if (depth > GSC_JSON_MAX_DEPTH || ++(*nodes) > GSC_JSON_MAX_NODES)
+		return false;
+	for (const cJSON* child = item->child; child != NULL; child = child->next) {
+		if (!gsc_json_checkLimits(child, depth + 1, nodes))
+			return false;
+	}
+	return true;
+}
+
+// Push the value to the script stack
+static void gsc_json_push(const cJSON* item) {
+	if (cJSON_IsString(item)) {
+		Scr_AddString(item->valuestring);
+
+	} else if (cJSON_IsNumber(item)) {
+		double num = item->valuedouble;
+		if (num == std::floor(num) && num >= INT_MIN && num <= INT_MAX)
+			Scr_AddInt((int)num);
+		else
+			Scr_AddFloat((float)num);
+
+	} else if (cJSON_IsBool(item)) {
+		Scr_AddBool(cJSON_IsTrue(item));
+
+	} else if (cJSON_IsArray(item)) {
+		Scr_MakeArray();
+		for (const cJSON* child = item->child; child != NULL; child = child->next) {
+			gsc_json_push(child);
+			Scr_AddArray();
+		}
+
+	} else if (cJSON_IsObject(item)) {
+		Scr_MakeArray();
+		for (const cJSON* child = item->child; child != NULL; child = child->next) {
+			// Null values are not stored in arrays
+			if (cJSON_IsNull(child) || child->string == NULL)
+				continue;
+			// Duplicate keys cannot be added to the array, first one is used
+			if (cJSON_GetObjectItemCaseSensitive(item, child->string) != child)
+				continue;
+			gsc_json_push(child);
+			Scr_AddArrayStringIndexed(SL_GetString(child->string, 0));
+		}
+
+	} else {
+		Scr_AddUndefined(); // null
+	}
+}
+
+/**
+ * Decode JSON string into script value.
+ * Objects are returned as arrays with string keys, arrays as arrays with integer keys.
+ * Numbers are returned as int if they have no decimal part, otherwise as float. Booleans are returned as 1 / 0.
+ * Returns undefined if the string is not valid JSON.
+ * USAGE: data = json_decode(str)
+ * Example:
+ *   data = json_decode("{\"name\": \"eyza\", \"kills\": [1, 2, 3]}");
+ *   println(data["name"] + " " + data["kills"].size);
+ */
+void gsc_json_decode() {
+	if (Scr_GetNumParam() != 1) {
+		Scr_Error(va("json_decode: invalid number of parameters, expected 1, got %d\n", Scr_GetNumParam()));
+		Scr_AddUndefined();
+		return;
+	}
+
+	const char* str = Scr_GetString(0);
+
+	if (strlen(str) > GSC_JSON_MAX_SIZE) {
+		Scr_Error(va("json_decode: string is too long (max %d bytes)\n", GSC_JSON_MAX_SIZE));
+		Scr_AddUndefined();
+		return;
+	}
+
+	cJSON* root = cJSON_Parse(str);
+	if (root == NULL) {
+		Scr_AddUndefined();
+		return;
+	}
+
+	int nodes = 0;
+	if (!gsc_json_checkLimits(root, 1, &nodes)) {
+		cJSON_Delete(root);
+		Scr_Error(va("json_decode: document is too large (max depth %d, max %d values)\n", GSC_JSON_MAX_DEPTH, GSC_JSON_MAX_NODES));
+		Scr_AddUndefined();
+		return;
+	}
+
+	gsc_json_push(root);
+	cJSON_Delete(root);
+}
+
+
+static void gsc_json_writeInt(JsonWriter& json, int value) {
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%i", value);
+	json.raw(buf);
+}
+
+static void gsc_json_writeFloat(JsonWriter& json, float value) {
+	char buf[32];
+	if (std::isfinite(value)) snprintf(buf, sizeof(buf), "%.7g", value);
+	else                      snprintf(buf, sizeof(buf), "null");
+	json.raw(buf);
+}
+
+static void gsc_json_writeVector(JsonWriter& json, const float* vec) {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "[%.7g,%.7g,%.7g]", vec[0], vec[1], vec[2]);
+	json.raw(buf);
+}
+
+static bool gsc_json_writeArray(JsonWriter& json, unsigned int id, int depth);
+
+// Write value of the variable stored in array. Returns false if the type is not supported.
+static bool gsc_json_writeVariable(JsonWriter& json, unsigned int id, int depth) {
+	unsigned int value = Scr_GetVariableValue(id);
+	switch (Scr_GetObjectType(id)) {
+		case VAR_UNDEFINED: json.raw("null"); return true;
+		case VAR_STRING:
+		case VAR_ISTRING:   json.string(SL_ConvertToString(value)); return true;
+		case VAR_INTEGER:   gsc_json_writeInt(json, (int)value); return true;
+		case VAR_FLOAT:     gsc_json_writeFloat(json, *(float*)&value); return true;
+		case VAR_VECTOR:    gsc_json_writeVector(json, (const float*)value); return true;
+		case VAR_POINTER:   return gsc_json_writeArray(json, value, depth + 1);
+		default:            return false;
+	}
+}
+
+// Write array as JSON array if the keys are 0..size-1, otherwise as JSON object. Structs and entities are not supported.
+static bool gsc_json_writeArray(JsonWriter& json, unsigned int id, int depth) {
+	if (depth > GSC_JSON_MAX_DEPTH || Scr_GetObjectType(id) != VAR_ARRAY)
+		return false;
+
+	std::vector<unsigned int> children;
+	bool isList = true;
+	for (unsigned int child = Scr_FindNextSibling(id); child != 0; child = Scr_FindNextSibling(child)) {
+		unsigned int name = Scr_GetVariableName(child);
+		if (name >= 0x10000 && name < 0x20000)
+			return false; // key is an object
+		children.push_back(child);
+		if (name < 0x10000)
+			isList = false;
+	}
+
+	// Integer keys might be in any order, they must cover 0..size-1 exactly to be written as JSON array
+	std::vector<unsigned int> list(children.size(), 0);
+	for (size_t i = 0; isList && i < children.size(); i++) {
+		int index = (int)Scr_GetVariableName(children[i]) - 0x800000;
+		if (index < 0 || index >= (int)list.size() || list[index] != 0)
+			isList = false;
+		else
+			list[index] = children[i];
+	}
+
+	if (isList) {
+		json.raw("[");
+		for (size_t i = 0; i < list.size(); i++) {
+			if (i > 0) json.raw(",");
+			if (!gsc_json_writeVariable(json, list[i], depth))
+				return false;
+		}
+		json.raw("]");
+		return true;
+	}
+
+	json.raw("{");
+	for (size_t i = 0; i < children.size(); i++) {
+		if (i > 0) json.raw(",");
+		unsigned int name = Scr_GetVariableName(children[i]);
+		if (name < 0x10000)
+			json.string(SL_ConvertToString(name));
+		else
+			json.string(std::to_string((int)name - 0x800000));
+		json.raw(":");
+		if (!gsc_json_writeVariable(json, children[i], depth))
+			return false;
+	}
+	json.raw("}");
+	return true;
+}
+
+/** Write script parameter at index as JSON value. Returns false if the type is not supported. */
+bool gsc_json_writeParam(JsonWriter& json, unsigned int param) {
+	switch (Scr_GetType(param)) {
+		case VAR_UNDEFINED:
+			json.raw("null");
+			return true;
+		case VAR_STRING:
+			json.string(Scr_GetString(param));
+			return true;
+		case VAR_ISTRING:
+			json.string(Scr_GetLocalizedString(param));
+			return true;
+		case VAR_INTEGER:
+			gsc_json_writeInt(json, Scr_GetInt(param));
+			return true;
+		case VAR_FLOAT:
+			gsc_json_writeFloat(json, Scr_GetFloat(param));
+			return true;
+		case VAR_VECTOR: {
+			vec3_t vec;
+			Scr_GetVector(param, vec);
+			gsc_json_writeVector(json, vec);
+			return true;
+		}
+		case VAR_POINTER:
+			return gsc_json_writeArray(json, Scr_GetObject(param), 1);
+		default:
+			return false;
+	}
+}
+
+static JsonWriter gsc_json_writer;
+
+/**
+ * Encode script value into JSON string.
+ * Arrays with keys 0..size-1 are encoded as JSON arrays, other arrays as objects. Nested arrays are encoded recursively.
+ * Values can be strings, numbers, vectors, arrays or undefined (null). Structs and entities are not supported.
+ * With more parameters, key-value pairs are encoded into JSON object.
+ * USAGE: str = json_encode(value)
+ *        str = json_encode(key, value[, key, value, ...])
+ * Example:
+ *   data = [];
+ *   data["name"] = self.name;
+ *   data["kills"] = [];
+ *   data["kills"][0] = 5;
+ *   str = json_encode(data);
+ *   // {"name":"eyza","kills":[5]}
+ *   str = json_encode("name", self.name, "origin", self.origin);
+ *   // {"name":"eyza","origin":[100,200,0]}
+ */
+void gsc_json_encode() {
+	unsigned int numParams = Scr_GetNumParam();
+
+	if (numParams == 0 || (numParams > 1 && numParams % 2 != 0)) {
+		Scr_Error(va("json_encode: expected value or key-value pairs, got %u parameters\n", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+
+	JsonWriter& json = gsc_json_writer;
+	json.clear();
+
+	if (numParams == 1) {
+		if (!gsc_json_writeParam(json, 0)) {
+			Scr_Error(va("json_encode: value has unsupported type or is nested more than %d levels\n", GSC_JSON_MAX_DEPTH));
+			Scr_AddUndefined();
+			return;
+		}
+		Scr_AddString(json.c_str());
+		return;
+	}
+
+	json.raw("{");
+	for (unsigned int i = 0; i < numParams; i += 2) {
+		if (i > 0) json.raw(",");
+		json.string(Scr_GetString(i)).raw(":");
+		if (!gsc_json_writeParam(json, i + 1)) {
+			Scr_Error(va("json_encode: value of '%s' has unsupported type or is nested more than %d levels\n", Scr_GetString(i), GSC_JSON_MAX_DEPTH));
+			Scr_AddUndefined();
+			return;
+		}
+	}
+	json.raw("}");
+
+	Scr_AddString(json.c_str());
+}
+
+/**
+ * Encode values into JSON array string.
+ * Values can be strings, numbers, vectors, arrays or undefined (null).
+ * USAGE: str = json_encodeArray(value[, value, ...])
+ * Example:
+ *   str = json_encodeArray(1, "two", 3.5);
+ *   // [1,"two",3.5]
+ */
+void gsc_json_encodeArray() {
+	unsigned int numParams = Scr_GetNumParam();
+
+	JsonWriter& json = gsc_json_writer;
+	json.clear();
+	json.raw("[");
+	for (unsigned int i = 0; i < numParams; i++) {
+		if (i > 0) json.raw(",");
+		if (!gsc_json_writeParam(json, i)) {
+			Scr_Error(va("json_encodeArray: value at index %u has unsupported type or is nested more than %d levels\n", i, GSC_JSON_MAX_DEPTH));
+			Scr_AddUndefined();
+			return;
+		}
+	}
+	json.raw("]");
+
+	Scr_AddString(json.c_str());
+}
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_json_init() {
+	gsc_registerFunction("json_decode", gsc_json_decode);
+	gsc_registerFunction("json_encode", gsc_json_encode);
+	gsc_registerFunction("json_encodeArray", gsc_json_encodeArray);
+}
@@ -0,0 +1,13 @@
+#ifndef GSC_JSON_H
+#define GSC_JSON_H
+
+#include "json_writer.h"
+
+bool gsc_json_writeParam(JsonWriter& json, unsigned int param);
+
+void gsc_json_decode();
+void gsc_json_encode();
+void gsc_json_encodeArray();
+void gsc_json_init();
+
+#endif
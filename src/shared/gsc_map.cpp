@@ -0,0 +1,230 @@
+#include "gsc_map.h"
+#include "gsc.h"
+
+#include <string>
+#include <vector>
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_script.h"
+#include "ordered_map.h"
+
+#define GSC_MAP_MAX_MAPS	1024	// max number of maps existing at the same time
+
+typedef ordered_map<std::string, GscValue> GscMap;
+
+// Maps referenced from scripts by handle, handle is index + 1
+// Slots of destroyed maps are reused, all maps are freed on complete map change
+std::vector<GscMap*> gsc_maps;
+std::vector<int> gsc_maps_free;
+int gsc_maps_count = 0;
+
+
+// Returns the map for handle in the first parameter, or NULL with script error
+static GscMap* gsc_map_get(const char* function) {
+	int handle = Scr_GetInt(0);
+	if (handle <= 0 || handle > (int)gsc_maps.size() || gsc_maps[handle - 1] == NULL) {
+		Scr_Error(va("%s: invalid map handle %i\n", function, handle));
+		return NULL;
+	}
+	return gsc_maps[handle - 1];
+}
+
+// Returns the key in the second parameter, integer keys are converted to string
+static const char* gsc_map_getKey(const char* function, char* buffer, size_t size) {
+	int type = Scr_GetType(1);
+	if (type == VAR_STRING) {
+		return Scr_GetString(1);
+	} else if (type == VAR_INTEGER) {
+		snprintf(buffer, size, "%i", Scr_GetInt(1));
+		return buffer;
+	}
+	Scr_Error(va("%s: key must be a string or an integer\n", function));
+	return NULL;
+}
+
+// Check number of parameters, returns false with script error if it does not match
+static bool gsc_map_checkParams(const char* function, unsigned int count) {
+	if (Scr_GetNumParam() != count) {
+		Scr_Error(va("%s: invalid number of parameters, expected %u, got %u\n", function, count, Scr_GetNumParam()));
+		return false;
+	}
+	return true;
+}
+
+
+/**
+ * Create new empty map and return its handle.
+ * Map keeps keys in insertion order. Maps are freed automatically on map change, or can be destroyed by map_destroy.
+ * USAGE: handle = map_create();
+ */
+void gsc_map_create() {
+	if (gsc_maps_count >= GSC_MAP_MAX_MAPS) {
+		Scr_Error(va("map_create: too many maps, max %i maps can exist at the same time\n", GSC_MAP_MAX_MAPS));
+		Scr_AddUndefined();
+		return;
+	}
+
+	int index;
+	if (!gsc_maps_free.empty()) {
+		index = gsc_maps_free.back();
+		gsc_maps_free.pop_back();
+	} else {
+		index = (int)gsc_maps.size();
+		gsc_maps.push_back(NULL);
+	}
+	gsc_maps[index] = new GscMap();
+	gsc_maps_count++;
+
+	Scr_AddInt(index + 1);
+}
+
+/**
+ * Destroy the map, the handle is not valid anymore.
+ * USAGE: map_destroy(handle);
+ */
+void gsc_map_destroy() {
+	if (!gsc_map_checkParams("map_destroy", 1)) { Scr_AddUndefined(); return; }
+	GscMap* map = gsc_map_get("map_destroy");
+	if (!map) { Scr_AddUndefined(); return; }
+
+	int index = Scr_GetInt(0) - 1;
+	delete map;
+	gsc_maps[index] = NULL;
+	gsc_maps_free.push_back(index);
+	gsc_maps_count--;
+
+	Scr_AddBool(true);
+}
+
+/**
+ * Set value for the key. Value can be string, integer, float or vector. Undefined value removes the key.
+ * Integer keys are converted to string, so map_set(h, 5, x) and map_set(h, "5", x) use the same key.
+ * USAGE: map_set(handle, key, value);
+ */
+void gsc_map_set() {
+	if (!gsc_map_checkParams("map_set", 3)) { Scr_AddUndefined(); return; }
+	GscMap* map = gsc_map_get("map_set");
+	if (!map) { Scr_AddUndefined(); return; }
+	char buffer[16];
+	const char* key = gsc_map_getKey("map_set", buffer, sizeof(buffer));
+	if (!key) { Scr_AddUndefined(); return; }
+
+	if (Scr_GetType(2) == VAR_UNDEFINED) {
+		map->erase(key);
+		Scr_AddBool(true);
+		return;
+	}
+
+	GscValue value;
+	if (!gsc_value_get(2, value)) {
+		Scr_Error(va("map_set: value for key '%s' has unsupported type\n", key));
+		Scr_AddUndefined();
+		return;
+	}
+	(*map)[key] = std::move(value);
+
+	Scr_AddBool(true);
+}
+
+/**
+ * Get value for the key, or undefined if the key does not exist.
+ * USAGE: value = map_get(handle, key);
+ */
+void gsc_map_getValue() {
+	if (!gsc_map_checkParams("map_get", 2)) { Scr_AddUndefined(); return; }
+	GscMap* map = gsc_map_get("map_get");
+	if (!map) { Scr_AddUndefined(); return; }
+	char buffer[16];
+	const char* key = gsc_map_getKey("map_get", buffer, sizeof(buffer));
+	if (!key) { Scr_AddUndefined(); return; }
+
+	const GscValue* value = map->find(key);
+	if (!value) {
+		Scr_AddUndefined();
+		return;
+	}
+	gsc_value_push(*value);
+}
+
+/**
+ * Returns true if the key exists.
+ * USAGE: exists = map_has(handle, key);
+ */
+void gsc_map_has() {
+	if (!gsc_map_checkParams("map_has", 2)) { Scr_AddUndefined(); return; }
+	GscMap* map = gsc_map_get("map_has");
+	if (!map) { Scr_AddUndefined(); return; }
+	char buffer[16];
+	const char* key = gsc_map_getKey("map_has", buffer, sizeof(buffer));
+	if (!key) { Scr_AddUndefined(); return; }
+
+	Scr_AddBool(map->contains(key));
+}
+
+/**
+ * Remove the key, returns true if the key existed.
+ * USAGE: removed = map_delete(handle, key);
+ */
+void gsc_map_delete() {
+	if (!gsc_map_checkParams("map_delete", 2)) { Scr_AddUndefined(); return; }
+	GscMap* map = gsc_map_get("map_delete");
+	if (!map) { Scr_AddUndefined(); return; }
+	char buffer[16];
+	const char* key = gsc_map_getKey("map_delete", buffer, sizeof(buffer));
+	if (!key) { Scr_AddUndefined(); return; }
+
+	Scr_AddBool(map->erase(key));
+}
+
+/**
+ * Returns array of keys in insertion order.
+ * USAGE: keys = map_keys(handle);
+ */
+void gsc_map_keys() {
+	if (!gsc_map_checkParams("map_keys", 1)) { Scr_AddUndefined(); return; }
+	GscMap* map = gsc_map_get("map_keys");
+	if (!map) { Scr_AddUndefined(); return; }
+
+	Scr_MakeArray();
+	for (const auto& e : *map) {
+		Scr_AddString(e.key.c_str());
+		Scr_AddArray();
+	}
+}
+
+/**
+ * Returns number of keys in the map.
+ * USAGE: size = map_size(handle);
+ */
+void gsc_map_size() {
+	if (!gsc_map_checkParams("map_size", 1)) { Scr_AddUndefined(); return; }
+	GscMap* map = gsc_map_get("map_size");
+	if (!map) { Scr_AddUndefined(); return; }
+
+	Scr_AddInt((int)map->size());
+}
+
+
+/** Free all maps. Called on complete map change or shutdown, because the handles stored in scripts are lost. */
+void gsc_map_freeAll() {
+	if (gsc_maps_count > 0)
+		Com_DPrintf("Freeing %i script maps\n", gsc_maps_count);
+	for (GscMap* map : gsc_maps)
+		delete map;
+	gsc_maps.clear();
+	gsc_maps_free.clear();
+	gsc_maps_count = 0;
+}
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_map_init() {
+	gsc_registerFunction("map_create", gsc_map_create);
+	gsc_registerFunction("map_destroy", gsc_map_destroy);
+	gsc_registerFunction("map_set", gsc_map_set);
+	gsc_registerFunction("map_get", gsc_map_getValue);
+	gsc_registerFunction("map_has", gsc_map_has);
+	gsc_registerFunction("map_delete", gsc_map_delete);
+	gsc_registerFunction("map_keys", gsc_map_keys);
+	gsc_registerFunction("map_size", gsc_map_size);
+}
@@ -0,0 +1,15 @@
+#ifndef GSC_MAP_H
+#define GSC_MAP_H
+
+void gsc_map_create();
+void gsc_map_destroy();
+void gsc_map_set();
+void gsc_map_getValue();
+void gsc_map_has();
+void gsc_map_delete();
+void gsc_map_keys();
+void gsc_map_size();
+void gsc_map_freeAll();
+void gsc_map_init();
+
+#endif
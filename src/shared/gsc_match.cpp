@@ -1,16 +1,101 @@
 #include "gsc_match.h"
+#include "gsc.h"
 
 #include "shared.h"
 #include "cod2_common.h"
 #include "cod2_script.h"
 #include "server.h"
 #include "match.h"
+#include "match_journal.h"
+#include "event_server.h"
 
 int codecallback_test_match_onStartGameType;
 int codecallback_test_match_onPlayerConnect;
 int codecallback_test_match_onStopGameType;
 
 
+// Record the change of match progress value in the journal and report it to event server subscribers
+// playerKey is nullptr for global data, value is nullptr if the key was removed
+static void gsc_match_changed(const char* playerKey, const char* key, const MatchValue* value) {
+	if (value)
+		match_journal_set(playerKey, key, *value);
+	else
+		match_journal_erase(playerKey, key);
+	event_server_onMatchDataChanged(playerKey, key, value);
+}
+
+// Save string to match progress data, the change is recorded in the journal
+// playerKey is nullptr for global data
+static void gsc_match_setString(ordered_map<std::string, MatchValue>& data, const char* playerKey, const char* key, const char* value) {
+	MatchValue* slot = data.find(key);
+	if (slot && slot->type == MatchValue::STRING && slot->stringValue == value)
+		return; // not changed, dont write to the journal
+	if (!slot)
+		slot = &data[key];
+	*slot = value;
+	gsc_match_changed(playerKey, key, slot);
+}
+
+// Save script parameter as match progress value, numbers are kept as numbers
+static void gsc_match_setValue(ordered_map<std::string, MatchValue>& data, const char* playerKey, const char* key, unsigned int param) {
+	MatchValue value;
+	switch (Scr_GetType(param)) {
+		case VAR_INTEGER: value = Scr_GetInt(param); break;
+		case VAR_FLOAT:   value = Scr_GetFloat(param); break;
+		default:          value = Scr_GetString(param); break;
+	}
+	MatchValue* slot = data.find(key);
+	if (slot && *slot == value)
+		return; // not changed, dont write to the journal
+	if (!slot)
+		slot = &data[key];
+	*slot = std::move(value);
+	gsc_match_changed(playerKey, key, slot);
+}
+
+// Return match progress value to script as string
+static void gsc_match_returnValueAsString(const MatchValue& value) {
+	char buf[32];
+	Scr_AddString(value.c_str(buf, sizeof(buf)));
+}
+
+// Add script parameter to the match progress value and return the new value to script
+// String value is converted to number first, empty or non-numeric string is used as 0
+static void gsc_match_incValue(ordered_map<std::string, MatchValue>& data, const char* playerKey, const char* key, unsigned int param, const char* funcName) {
+	int deltaType = Scr_GetType(param);
+	if (deltaType != VAR_INTEGER && deltaType != VAR_FLOAT) {
+		Scr_Error(va("%s: delta must be a number", funcName));
+		Scr_AddUndefined();
+		return;
+	}
+
+	MatchValue& value = data[key];
+	if (value.type == MatchValue::STRING) {
+		const char* str = value.stringValue.c_str();
+		char* end;
+		long num = strtol(str, &end, 10);
+		if (*end == '\0') {
+			value = (int)num;
+		} else {
+			float f = strtof(str, &end);
+			if (*end == '\0') value = f;
+			else               value = 0;
+		}
+	}
+
+	if (value.type == MatchValue::INT && deltaType == VAR_INTEGER) {
+		value = value.intValue + Scr_GetInt(param);
+		Scr_AddInt(value.intValue);
+	} else {
+		float current = (value.type == MatchValue::INT) ? (float)value.intValue : value.floatValue;
+		value = current + Scr_GetFloat(param);
+		Scr_AddFloat(value.floatValue);
+	}
+	gsc_match_changed(playerKey, key, &value);
+}
+
+
+
 void gsc_match_playerGetSetData(int action, scr_entref_t ref) {
 	int id = ref.entnum;
 
@@ -34,37 +119,30 @@ void gsc_match_playerGetSetData(int action, scr_entref_t ref) {
 		return;
 	}
 
-	// Find player by UUID
-	const char* player_uuid = Info_ValueForKey(client->userinfo, "match_login");
-	MatchPlayer* player = match_find_player_by_uuid(player_uuid);
-
-	// Create player array KEY
-	// If UUID is set and is valid, use UUID
-	// If UUID is empty or not within team, user player's guid as identification, if guid is empty, use name as fallback
-	const char* array_key = va("UUID_%s", player_uuid);
-	if (array_key == nullptr || player == nullptr) {
-		if (client->guid != 0)
-			array_key = va("GUID_%i", client->guid);
-		else
-			array_key = va("NAME_%s", client->name);
-	}
+	// Find player by UUID, resolved only when userinfo or match data changes
+	MatchClientIdentity* identity = match_get_client_identity(id);
+	MatchPlayer* player = identity->player;
+	const char* player_uuid = identity->uuid;
+	const char* array_key = identity->key;
 
 	// Update player data
-	match.progressData.playerData[array_key]["key"] = array_key;
-	match.progressData.playerData[array_key]["uuid"] = player_uuid ? player_uuid : "";
 	// If this is first time we save player data, save also additional data about player
-	if (!match.progressData.playerData.contains(array_key)) {
+	bool isNewPlayer = !match.progressData.playerData.contains(array_key);
+	auto& playerData = match.progressData.playerData[array_key];
+	gsc_match_setString(playerData, array_key, "key", array_key);
+	gsc_match_setString(playerData, array_key, "uuid", player_uuid ? player_uuid : "");
+	if (isNewPlayer) {
 		char buf[32];
 		time_to_iso8601(time_utc_ms(), buf, sizeof(buf));
-		match.progressData.playerData[array_key]["first_time"] = buf;
+		gsc_match_setString(playerData, array_key, "first_time", buf);
 	}
-	match.progressData.playerData[array_key]["name"] = (player == nullptr) ? client->name : player->name;
-	match.progressData.playerData[array_key]["team"] = (player == nullptr) ? "" : va("team%i", player->teamNumber);
-	match.progressData.playerData[array_key]["team_name"] = (player == nullptr) ? "" : player->teamName;
+	gsc_match_setString(playerData, array_key, "name", (player == nullptr) ? client->name : player->name);
+	gsc_match_setString(playerData, array_key, "team", (player == nullptr) ? "" : va("team%i", player->teamNumber));
+	gsc_match_setString(playerData, array_key, "team_name", (player == nullptr) ? "" : player->teamName);
 	if (player == nullptr) {
-		match.progressData.playerData[array_key]["debug"] = (player_uuid && player_uuid[0]) ? "Player's UUID is not part of any team" : "Player did not login with /match login <uuid>";
-	} else {
-		match.progressData.playerData[array_key].erase("debug");
+		gsc_match_setString(playerData, array_key, "debug", (player_uuid && player_uuid[0]) ? "Player's UUID is not part of any team" : "Player did not login with /match login <uuid>");
+	} else if (playerData.erase("debug")) {
+		gsc_match_changed(array_key, "debug", nullptr);
 	}
 
 
@@ -74,15 +152,19 @@ void gsc_match_playerGetSetData(int action, scr_entref_t ref) {
 	{
 		const char* key = Scr_GetString(0);
 
-		if (!match.progressData.playerData.contains(array_key) || !match.progressData.playerData[array_key].contains(key)) {
+		const MatchValue* value = playerData.find(key);
+		if (value == nullptr) {
 			Scr_AddString("");
 			return;
 		}
 
-		const std::string& value = match.progressData.playerData[array_key][key];
-		Scr_AddString(value.c_str());
+		gsc_match_returnValueAsString(*value);
+
+	// Increment
+	} else if (action == 2) {
+		const char* key = Scr_GetString(0);
 
-		//Com_DPrintf("gsc_match_playerGetData(%s) for %d => %s\n", key, id, value.c_str());
+		gsc_match_incValue(playerData, array_key, key, 1, "matchPlayerIncData");
 
 	// Set
 	} else {
@@ -91,12 +173,9 @@ void gsc_match_playerGetSetData(int action, scr_entref_t ref) {
 		unsigned int numParams = Scr_GetNumParam();
 		for (unsigned int i = 0; i + 1 < numParams; i += 2) {
 			const char* key = Scr_GetString(i);
-			const char* value = Scr_GetString(i + 1);
 
 			// Save player data
-			match.progressData.playerData[array_key][key] = value;
-
-			//Com_DPrintf("gsc_match_playerSetData(%s, %s) for %d\n", key, value, id);
+			gsc_match_setValue(playerData, array_key, key, i + 1);
 		}
 
 		Scr_AddBool(true);
@@ -108,6 +187,7 @@ void gsc_match_playerGetSetData(int action, scr_entref_t ref) {
 
 /**
  * Set player data for the match
+ * Numbers are kept as numbers and uploaded as JSON numbers, other values are saved as strings.
  * <player> matchSetData(<key>, <value>[, <key>, <value>, ...]);
  */
 void gsc_match_playerSetData(scr_entref_t ref) {
@@ -143,6 +223,26 @@ void gsc_match_playerGetData(scr_entref_t ref) {
 	gsc_match_playerGetSetData(0, ref);
 }
 
+/**
+ * Add number to player data and return the new value as number.
+ * If the value does not exist or is not a number, it starts from 0.
+ * <player> matchPlayerIncData(<key>, <delta>);
+ * Example:
+ *   self matchPlayerIncData("kills", 1);
+ */
+void gsc_match_playerIncData(scr_entref_t ref) {
+	unsigned int numParams = Scr_GetNumParam();
+
+	if (numParams != 2) {
+		Scr_Error(va("matchPlayerIncData: expected 2 parameters, got %u", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+
+	// Increment player data
+	gsc_match_playerGetSetData(2, ref);
+}
+
 
 
 /**
@@ -162,41 +262,14 @@ void gsc_match_playerIsAllowed(scr_entref_t ref) {
 		return;
 	}
 
-	client_t *client = &svs_clients[id];
-
 	if (!match.activated) {
 		Scr_AddBool(false);
 		return;
 	}
 
-	const char* login_uuid = Info_ValueForKey(client->userinfo, "match_login");
-	if (!login_uuid || login_uuid[0] == '\0') {
-		Scr_AddBool(false);
-		return;
-	}
-
 	// Check if the id matches any of the allowed players
-	bool found = false;
-	for (int j = 0; j < match.data.team1.num_players; j++) {
-		if (strcmp(match.data.team1.players[j].id, login_uuid) == 0) {
-			found = true;
-			break;
-		}
-	}
-	if (!found) {
-		for (int j = 0; j < match.data.team2.num_players; j++) {
-			if (strcmp(match.data.team2.players[j].id, login_uuid) == 0) {
-				found = true;
-				break;
-			}
-		}
-	}
-	if (!found) {
-		Scr_AddBool(false);
-		return;
-	}
-
-	Scr_AddBool(true);
+	MatchClientIdentity* identity = match_get_client_identity(id);
+	Scr_AddBool(identity->player != nullptr);
 }
 
 
@@ -224,21 +297,18 @@ void gsc_match_uploadData() {
 
 	void* callbackDone = (numParams >= 1) ? Scr_GetParamFunction(0) : nullptr;
 	void* callbackError = (numParams >= 2) ? Scr_GetParamFunction(1) : nullptr;
+	unsigned int generation = gsc_callback_generation();
 
 	// Upload match data
 	match_upload_match_data(
-		[callbackDone]() {
-			if (callbackDone && Scr_IsSystemActive()) {
-				short thread_id = Scr_ExecThread((int)callbackDone, 0);
-				Scr_FreeThread(thread_id);
-			}
+		[callbackDone, generation]() {
+			gsc_callback_enqueue(callbackDone, generation);
 		}, 
-		[callbackError](const std::string& error) {
-			if (callbackError && Scr_IsSystemActive()) {
+		[callbackError, generation](const std::string& error) {
+			gsc_callback_enqueue(callbackError, generation, [error]() {
 				Scr_AddString(error.c_str());
-				unsigned short thread_id = Scr_ExecThread((int)callbackError, 1);
-				Scr_FreeThread(thread_id);
-			}
+				return 1u;
+			});
 		}
 	);
 
@@ -253,20 +323,22 @@ void gsc_match_getSetData(int action) {
 	}
 
 	// Update predefined data
-	match.progressData.globalData["match_id"] = match.data.match_id;
-	match.progressData.globalData["team1_id"] = match.data.team1.id;
-	match.progressData.globalData["team2_id"] = match.data.team2.id;
-	match.progressData.globalData["team1_name"] = match.data.team1.name;
-	match.progressData.globalData["team2_name"] = match.data.team2.name;
-	match.progressData.globalData["team1_tag"] = match.data.team1.tag;
-	match.progressData.globalData["team2_tag"] = match.data.team2.tag;
+	auto& globalData = match.progressData.globalData;
+	gsc_match_setString(globalData, nullptr, "match_id", match.data.match_id);
+	gsc_match_setString(globalData, nullptr, "team1_id", match.data.team1.id);
+	gsc_match_setString(globalData, nullptr, "team2_id", match.data.team2.id);
+	gsc_match_setString(globalData, nullptr, "team1_name", match.data.team1.name);
+	gsc_match_setString(globalData, nullptr, "team2_name", match.data.team2.name);
+	gsc_match_setString(globalData, nullptr, "team1_tag", match.data.team1.tag);
+	gsc_match_setString(globalData, nullptr, "team2_tag", match.data.team2.tag);
 
 	// Get
 	if (action == 0) {
 
 		const char* key = Scr_GetString(0);
 
-		if (!match.progressData.globalData.contains(key)) {
+		const MatchValue* value = globalData.find(key);
+		if (value == nullptr) {
 
 			if (strcmp(key, "team1_player_uuids") == 0) {
 				Scr_MakeArray();
@@ -309,10 +381,13 @@ void gsc_match_getSetData(int action) {
 		}
 
 		// Get the value for the key
-		auto value = match.progressData.globalData.at(key);
-		Scr_AddString(value.c_str());
+		gsc_match_returnValueAsString(*value);
+
+	// Increment
+	} else if (action == 2) {
+		const char* key = Scr_GetString(0);
 
-		//Com_DPrintf("gsc_match_getData(%s) => %s\n", key, value.c_str());
+		gsc_match_incValue(globalData, nullptr, key, 1, "matchIncData");
 
 	// Set
 	} else {
@@ -321,12 +396,9 @@ void gsc_match_getSetData(int action) {
 		unsigned int numParams = Scr_GetNumParam();
 		for (unsigned int i = 0; i + 1 < numParams; i += 2) {
 			const char* key = Scr_GetString(i);
-			const char* value = Scr_GetString(i + 1);
 
 			// Save global data
-			match.progressData.globalData[key] = value;
-
-			//Com_DPrintf("gsc_match_setData(%s, %s)\n", key, value);
+			gsc_match_setValue(globalData, nullptr, key, i + 1);
 		}
 
 		Scr_AddBool(true);
@@ -336,6 +408,7 @@ void gsc_match_getSetData(int action) {
 
 /**
  * Set match data
+ * Numbers are kept as numbers and uploaded as JSON numbers, other values are saved as strings.
  * <player> matchSetData(<key>, <value>[, <key>, <value>, ...]);
  */
 void gsc_match_setData() {
@@ -373,6 +446,26 @@ void gsc_match_getData() {
 	gsc_match_getSetData(0);
 }
 
+/**
+ * Add number to match data and return the new value as number.
+ * If the value does not exist or is not a number, it starts from 0.
+ * level matchIncData(<key>, <delta>);
+ * Example:
+ *   matchIncData("team1_score", 1);
+ */
+void gsc_match_incData() {
+	unsigned int numParams = Scr_GetNumParam();
+
+	if (numParams != 2) {
+		Scr_Error(va("matchIncData: expected 2 parameters, got %u", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+
+	// Increment data
+	gsc_match_getSetData(2);
+}
+
 /**
  * Update match data by downloading it from the server again
  * level matchRedownloadData();
@@ -395,6 +488,7 @@ void gsc_match_clearData() {
 
 	match.progressData.globalData.clear();
 	match.progressData.playerData.clear();
+	match_journal_clear();
 	Scr_AddBool(true);
 }
 
@@ -463,3 +557,18 @@ void gsc_match_onStartGameType() {
 	#endif
 }
 
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_match_init() {
+	gsc_registerMethod("matchPlayerGetData", gsc_match_playerGetData);
+	gsc_registerMethod("matchPlayerSetData", gsc_match_playerSetData);
+	gsc_registerMethod("matchPlayerIncData", gsc_match_playerIncData);
+	gsc_registerMethod("matchPlayerIsAllowed", gsc_match_playerIsAllowed);
+
+	gsc_registerFunction("matchUploadData", gsc_match_uploadData);
+	gsc_registerFunction("matchSetData", gsc_match_setData);
+	gsc_registerFunction("matchGetData", gsc_match_getData);
+	gsc_registerFunction("matchIncData", gsc_match_incData);
+	gsc_registerFunction("matchRedownloadData", gsc_match_redownloadData);
+	gsc_registerFunction("matchClearData", gsc_match_clearData);
+	gsc_registerFunction("matchIsActivated", gsc_match_isActivated);
+}
@@ -10,10 +10,12 @@ extern int codecallback_test_match_onStopGameType;
 
 void gsc_match_playerSetData(scr_entref_t ref);
 void gsc_match_playerGetData(scr_entref_t ref);
+void gsc_match_playerIncData(scr_entref_t ref);
 void gsc_match_playerIsAllowed(scr_entref_t ref);
 void gsc_match_uploadData();
 void gsc_match_setData();
 void gsc_match_getData();
+void gsc_match_incData();
 void gsc_match_redownloadData();
 void gsc_match_clearData();
 void gsc_match_isActivated();
@@ -21,5 +23,6 @@ void gsc_match_isActivated();
 bool gsc_match_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
 void gsc_match_onPlayerConnect(int entnum);
 void gsc_match_onStartGameType();
+void gsc_match_init();
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "gsc_player.h"
+#include "gsc.h"
 
 #include "shared.h"
 #include "cod2_common.h"
@@ -81,4 +82,11 @@ void gsc_player_playerGetAuthorizationStatus(scr_entref_t ref) {
 
 	// In CoD2x, we store the authorization status in PBguid field of the challenge structure
 	Scr_AddString(client->PBguid);
-}
\ No newline at end of file
+}
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_player_init() {
+	gsc_registerMethod("getHWID", gsc_player_playerGetHWID);
+	gsc_registerMethod("getCDKeyHash", gsc_player_playerGetCDKeyHash);
+	gsc_registerMethod("getAuthorizationStatus", gsc_player_playerGetAuthorizationStatus);
+}
@@ -0,0 +1,226 @@
+#include "gsc_profile.h"
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_cmd.h"
+#include "cod2_dvars.h"
+#include "ordered_map.h"
+
+// Profiler of script builtins and callbacks.
+// When sv_scriptProfile is enabled while scripts are being compiled, every resolved builtin (engine or custom)
+// is replaced by a thunk that measures the call and then calls the original function.
+// Thunks are generated from template, each one has its own slot, because builtins are called without any context.
+// Changing sv_scriptProfile to 1 takes effect after the next map load, when scripts are compiled again.
+
+#define GSC_PROFILE_MAX_FUNCTIONS 	512
+#define GSC_PROFILE_MAX_METHODS 	512
+
+struct GscProfileStats {
+	const char* name;
+	const char* type;
+	uint64_t calls;
+	int64_t totalNs;
+	int64_t maxNs;
+};
+
+struct GscProfileFunction {
+	GscProfileStats stats;
+	xfunction_t call;
+};
+
+struct GscProfileMethod {
+	GscProfileStats stats;
+	xmethod_t call;
+};
+
+dvar_t* sv_scriptProfile;
+
+GscProfileFunction gsc_profile_functions[GSC_PROFILE_MAX_FUNCTIONS];
+GscProfileMethod gsc_profile_methods[GSC_PROFILE_MAX_METHODS];
+int gsc_profile_functionsCount = 0;
+int gsc_profile_methodsCount = 0;
+
+// Original function address -> slot, so the same builtin gets the same thunk on every compilation
+ordered_map<uintptr_t, int> gsc_profile_functionSlots;
+ordered_map<uintptr_t, int> gsc_profile_methodSlots;
+
+// Callbacks executed by name
+ordered_map<std::string, GscProfileStats> gsc_profile_callbacks;
+
+
+static int64_t gsc_profile_now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void gsc_profile_record(GscProfileStats& stats, int64_t elapsed) {
+	stats.calls++;
+	stats.totalNs += elapsed;
+	if (elapsed > stats.maxNs) stats.maxNs = elapsed;
+}
+
+template <int N>
+static void gsc_profile_functionThunk() {
+	GscProfileFunction& f = gsc_profile_functions[N];
+	if (!sv_scriptProfile->value.boolean) {
+		f.call();
+		return;
+	}
+	int64_t start = gsc_profile_now();
+	f.call();
+	gsc_profile_record(f.stats, gsc_profile_now() - start);
+}
+
+template <int N>
+static void gsc_profile_methodThunk(scr_entref_t ref) {
+	GscProfileMethod& m = gsc_profile_methods[N];
+	if (!sv_scriptProfile->value.boolean) {
+		m.call(ref);
+		return;
+	}
+	int64_t start = gsc_profile_now();
+	m.call(ref);
+	gsc_profile_record(m.stats, gsc_profile_now() - start);
+}
+
+template <int... I>
+static constexpr std::array<xfunction_t, sizeof...(I)> gsc_profile_makeFunctionThunks(std::integer_sequence<int, I...>) {
+	return {{ gsc_profile_functionThunk<I>... }};
+}
+
+template <int... I>
+static constexpr std::array<xmethod_t, sizeof...(I)> gsc_profile_makeMethodThunks(std::integer_sequence<int, I...>) {
+	return {{ gsc_profile_methodThunk<I>... }};
+}
+
+static const std::array<xfunction_t, GSC_PROFILE_MAX_FUNCTIONS> gsc_profile_functionThunks =
+	gsc_profile_makeFunctionThunks(std::make_integer_sequence<int, GSC_PROFILE_MAX_FUNCTIONS>());
+static const std::array<xmethod_t, GSC_PROFILE_MAX_METHODS> gsc_profile_methodThunks =
+	gsc_profile_makeMethodThunks(std::make_integer_sequence<int, GSC_PROFILE_MAX_METHODS>());
+
+
+/**
+ * Called when script function is resolved while compiling scripts.
+ * Returns profiling thunk for the function if profiling is enabled, otherwise the original function.
+ */
+xfunction_t gsc_profile_function(const char* name, xfunction_t call) {
+	if (!call || !sv_scriptProfile->value.boolean)
+		return call;
+
+	const int* slot = gsc_profile_functionSlots.find((uintptr_t)call);
+	if (slot)
+		return gsc_profile_functionThunks[*slot];
+
+	if (gsc_profile_functionsCount >= GSC_PROFILE_MAX_FUNCTIONS)
+		return call;
+
+	int i = gsc_profile_functionsCount++;
+	gsc_profile_functions[i].stats = GscProfileStats{name, "function", 0, 0, 0};
+	gsc_profile_functions[i].call = call;
+	gsc_profile_functionSlots[(uintptr_t)call] = i;
+	return gsc_profile_functionThunks[i];
+}
+
+/**
+ * Called when script method is resolved while compiling scripts.
+ * Returns profiling thunk for the method if profiling is enabled, otherwise the original method.
+ */
+xmethod_t gsc_profile_method(const char* name, xmethod_t call) {
+	if (!call || !sv_scriptProfile->value.boolean)
+		return call;
+
+	const int* slot = gsc_profile_methodSlots.find((uintptr_t)call);
+	if (slot)
+		return gsc_profile_methodThunks[*slot];
+
+	if (gsc_profile_methodsCount >= GSC_PROFILE_MAX_METHODS)
+		return call;
+
+	int i = gsc_profile_methodsCount++;
+	gsc_profile_methods[i].stats = GscProfileStats{name, "method", 0, 0, 0};
+	gsc_profile_methods[i].call = call;
+	gsc_profile_methodSlots[(uintptr_t)call] = i;
+	return gsc_profile_methodThunks[i];
+}
+
+/** Returns start time for gsc_profile_callback, or 0 if profiling is disabled. */
+int64_t gsc_profile_start() {
+	return sv_scriptProfile->value.boolean ? gsc_profile_now() : 0;
+}
+
+/** Record execution of script callback that started at time returned by gsc_profile_start. Name must be static string. */
+void gsc_profile_callback(const char* name, int64_t start) {
+	if (start == 0)
+		return;
+	int64_t elapsed = gsc_profile_now() - start;
+	GscProfileStats& stats = gsc_profile_callbacks[name];
+	if (stats.name == nullptr)
+		stats = GscProfileStats{name, "callback", 0, 0, 0};
+	gsc_profile_record(stats, elapsed);
+}
+
+
+/**
+ * Print builtins and callbacks with the highest total time.
+ * USAGE: scriptProfile [count]
+ */
+void gsc_profile_cmd() {
+	int count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 20;
+	if (count <= 0) count = 20;
+
+	std::vector<const GscProfileStats*> list;
+	for (int i = 0; i < gsc_profile_functionsCount; i++)
+		if (gsc_profile_functions[i].stats.calls) list.push_back(&gsc_profile_functions[i].stats);
+	for (int i = 0; i < gsc_profile_methodsCount; i++)
+		if (gsc_profile_methods[i].stats.calls) list.push_back(&gsc_profile_methods[i].stats);
+	for (const auto& e : gsc_profile_callbacks)
+		if (e.value.calls) list.push_back(&e.value);
+
+	if (list.empty()) {
+		if (!sv_scriptProfile->value.boolean)
+			Com_Printf("Script profiling is disabled, set sv_scriptProfile 1 and load a map.\n");
+		else
+			Com_Printf("No script builtins or callbacks were called yet.\n");
+		return;
+	}
+
+	std::sort(list.begin(), list.end(), [](const GscProfileStats* a, const GscProfileStats* b) {
+		return a->totalNs > b->totalNs;
+	});
+
+	Com_Printf("%-32s %-8s %10s %12s %10s %10s\n", "name", "type", "calls", "total ms", "avg us", "max us");
+	for (int i = 0; i < count && i < (int)list.size(); i++) {
+		const GscProfileStats* s = list[i];
+		Com_Printf("%-32s %-8s %10llu %12.2f %10.2f %10.1f\n", s->name, s->type, (unsigned long long)s->calls,
+			s->totalNs / 1000000.0, s->totalNs / 1000.0 / s->calls, s->maxNs / 1000.0);
+	}
+	Com_Printf("%u of %u profiled entries shown\n", (unsigned)std::min((size_t)count, list.size()), (unsigned)list.size());
+}
+
+/** Reset collected times, profiled builtins stay profiled. */
+void gsc_profile_cmd_reset() {
+	for (int i = 0; i < gsc_profile_functionsCount; i++) {
+		GscProfileStats& s = gsc_profile_functions[i].stats;
+		s.calls = 0; s.totalNs = 0; s.maxNs = 0;
+	}
+	for (int i = 0; i < gsc_profile_methodsCount; i++) {
+		GscProfileStats& s = gsc_profile_methods[i].stats;
+		s.calls = 0; s.totalNs = 0; s.maxNs = 0;
+	}
+	gsc_profile_callbacks.clear();
+	Com_Printf("Script profile was reset\n");
+}
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_profile_init() {
+	sv_scriptProfile = Dvar_RegisterBool("sv_scriptProfile", false, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // builtins are wrapped when scripts are compiled
+
+	Cmd_AddCommand("scriptProfile", gsc_profile_cmd);
+	Cmd_AddCommand("scriptProfileReset", gsc_profile_cmd_reset);
+}
@@ -0,0 +1,14 @@
+#ifndef GSC_PROFILE_H
+#define GSC_PROFILE_H
+
+#include <cstdint>
+
+#include "cod2_script.h"
+
+xfunction_t gsc_profile_function(const char* name, xfunction_t call);
+xmethod_t gsc_profile_method(const char* name, xmethod_t call);
+int64_t gsc_profile_start();
+void gsc_profile_callback(const char* name, int64_t start);
+void gsc_profile_init();
+
+#endif
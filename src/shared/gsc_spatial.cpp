@@ -0,0 +1,94 @@
+#include "gsc_spatial.h"
+#include "gsc.h"
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_script.h"
+#include "spatial.h"
+
+// Script queries of the player spatial index.
+
+xmethod_t gsc_spatial_setOrigin_original = NULL;
+
+
+// Player teleported by script must be found at the new position in the same frame
+static void gsc_spatial_setOrigin(scr_entref_t ref) {
+	gsc_spatial_setOrigin_original(ref);
+	if (ref.classnum == 0 && ref.entnum < MAX_CLIENTS)
+		spatial_invalidate();
+}
+
+/**
+ * Wrap original script method setOrigin, so the spatial index is rebuilt before the next query.
+ * Other methods are returned unchanged.
+ */
+xmethod_t gsc_spatial_wrapMethod(const char* name, xmethod_t call) {
+	if (Q_stricmp(name, "setorigin") == 0) {
+		gsc_spatial_setOrigin_original = call;
+		return gsc_spatial_setOrigin;
+	}
+	return call;
+}
+
+
+/**
+ * Returns array of alive players within the radius, sorted from the nearest.
+ * Optional ignoreEntNum excludes one player, usually the one who is asking.
+ * USAGE: players = getPlayersInRadius(origin, radius, [ignoreEntNum]);
+ * Example:
+ *   players = getPlayersInRadius(self.origin, 512, self getEntityNumber());
+ */
+void gsc_spatial_getPlayersInRadius() {
+	unsigned int numParams = Scr_GetNumParam();
+	if (numParams < 2 || numParams > 3) {
+		Scr_Error(va("getPlayersInRadius: invalid number of parameters, expected 2 or 3, got %u\n", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+
+	vec3_t origin;
+	Scr_GetVector(0, origin);
+	float radius = Scr_GetFloat(1);
+	int ignoreEntnum = numParams >= 3 ? Scr_GetInt(2) : -1;
+
+	int result[MAX_CLIENTS];
+	int count = radius > 0 ? spatial_players_in_radius(origin, radius, ignoreEntnum, result, MAX_CLIENTS) : 0;
+
+	Scr_MakeArray();
+	for (int i = 0; i < count; i++) {
+		Scr_AddEntity(&g_entities[result[i]]);
+		Scr_AddArray();
+	}
+}
+
+/**
+ * Returns the nearest alive player, or undefined if there is none.
+ * If maxRadius is set and bigger than 0, only players within the radius are checked.
+ * USAGE: player = getNearestPlayer(origin, [maxRadius], [ignoreEntNum]);
+ */
+void gsc_spatial_getNearestPlayer() {
+	unsigned int numParams = Scr_GetNumParam();
+	if (numParams < 1 || numParams > 3) {
+		Scr_Error(va("getNearestPlayer: invalid number of parameters, expected 1 to 3, got %u\n", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+
+	vec3_t origin;
+	Scr_GetVector(0, origin);
+	float maxRadius = numParams >= 2 ? Scr_GetFloat(1) : 0;
+	int ignoreEntnum = numParams >= 3 ? Scr_GetInt(2) : -1;
+
+	int entnum = spatial_nearest_player(origin, maxRadius, ignoreEntnum);
+	if (entnum < 0)
+		Scr_AddUndefined();
+	else
+		Scr_AddEntity(&g_entities[entnum]);
+}
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_spatial_init() {
+	gsc_registerFunction("getPlayersInRadius", gsc_spatial_getPlayersInRadius);
+	gsc_registerFunction("getNearestPlayer", gsc_spatial_getNearestPlayer);
+}
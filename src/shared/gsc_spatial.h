@@ -0,0 +1,11 @@
+#ifndef GSC_SPATIAL_H
+#define GSC_SPATIAL_H
+
+#include "cod2_script.h"
+
+void gsc_spatial_getPlayersInRadius();
+void gsc_spatial_getNearestPlayer();
+xmethod_t gsc_spatial_wrapMethod(const char* name, xmethod_t call);
+void gsc_spatial_init();
+
+#endif
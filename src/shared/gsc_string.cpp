@@ -0,0 +1,312 @@
+#include "gsc_string.h"
+#include "gsc.h"
+
+#include <string>
+#include <vector>
+
+#include "shared.h"
+#include "cod2_common.h"
+#include "cod2_script.h"
+
+#define GSC_STRING_MAX_BUILDERS		64				// max number of string builders existing at the same time
+#define GSC_STRING_MAX_LENGTH		(256 * 1024)	// max length of string created by builder, join or replace
+#define GSC_STRING_MAX_PARTS		4096			// max number of parts returned by strSplit, each part uses one script variable
+
+// String builders referenced from scripts by handle, handle is index + 1
+// Builder is freed by sb_build, remaining builders are freed on level end
+struct GscStringBuilder {
+	bool used;
+	std::string buffer;
+};
+
+std::vector<GscStringBuilder> gsc_string_builders;
+int gsc_string_builders_count = 0;
+
+
+// Append parameter converted to string, returns false if the type is not supported
+static bool gsc_string_appendParam(std::string& out, unsigned int param) {
+	char buffer[128];
+	switch (Scr_GetType(param)) {
+		case VAR_STRING:
+			out += Scr_GetString(param);
+			return true;
+		case VAR_ISTRING:
+			out += Scr_GetLocalizedString(param);
+			return true;
+		case VAR_INTEGER:
+			snprintf(buffer, sizeof(buffer), "%i", Scr_GetInt(param));
+			out += buffer;
+			return true;
+		case VAR_FLOAT:
+			snprintf(buffer, sizeof(buffer), "%g", Scr_GetFloat(param));
+			out += buffer;
+			return true;
+		case VAR_VECTOR: {
+			vec3_t vec;
+			Scr_GetVector(param, vec);
+			snprintf(buffer, sizeof(buffer), "(%g, %g, %g)", vec[0], vec[1], vec[2]);
+			out += buffer;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns the builder for handle in the first parameter, or NULL with script error
+static GscStringBuilder* gsc_string_getBuilder(const char* function) {
+	int handle = Scr_GetInt(0);
+	if (handle <= 0 || handle > (int)gsc_string_builders.size() || !gsc_string_builders[handle - 1].used) {
+		Scr_Error(va("%s: invalid string builder handle %i\n", function, handle));
+		return NULL;
+	}
+	return &gsc_string_builders[handle - 1];
+}
+
+
+/**
+ * Create new string builder and return its handle.
+ * The string is built by sb_append and returned by sb_build, which also frees the builder.
+ * Builders that are not built are freed on level end.
+ * USAGE: sb = sb_create();
+ */
+void gsc_string_sbCreate() {
+	if (gsc_string_builders_count >= GSC_STRING_MAX_BUILDERS) {
+		Scr_Error(va("sb_create: too many string builders, max %i builders can exist at the same time\n", GSC_STRING_MAX_BUILDERS));
+		Scr_AddUndefined();
+		return;
+	}
+
+	size_t index = 0;
+	while (index < gsc_string_builders.size() && gsc_string_builders[index].used)
+		index++;
+	if (index == gsc_string_builders.size())
+		gsc_string_builders.emplace_back();
+
+	gsc_string_builders[index].used = true;
+	gsc_string_builders[index].buffer.clear();
+	gsc_string_builders_count++;
+
+	Scr_AddInt((int)index + 1);
+}
+
+/**
+ * Append values to the string builder. Values can be strings, localized strings, integers, floats or vectors.
+ * USAGE: sb_append(sb, value1, value2, ...);
+ */
+void gsc_string_sbAppend() {
+	unsigned int numParams = Scr_GetNumParam();
+	if (numParams < 2) {
+		Scr_Error(va("sb_append: invalid number of parameters, expected at least 2, got %u\n", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+	GscStringBuilder* sb = gsc_string_getBuilder("sb_append");
+	if (!sb) { Scr_AddUndefined(); return; }
+
+	size_t length = sb->buffer.size();
+	for (unsigned int i = 1; i < numParams; i++) {
+		if (!gsc_string_appendParam(sb->buffer, i)) {
+			sb->buffer.resize(length);
+			Scr_Error(va("sb_append: value at index %u has unsupported type\n", i));
+			Scr_AddUndefined();
+			return;
+		}
+	}
+	if (sb->buffer.size() > GSC_STRING_MAX_LENGTH) {
+		sb->buffer.resize(length);
+		Scr_Error(va("sb_append: string is too long, max length is %i\n", GSC_STRING_MAX_LENGTH));
+		Scr_AddUndefined();
+		return;
+	}
+
+	Scr_AddBool(true);
+}
+
+/**
+ * Return the built string and free the builder, the handle is not valid anymore.
+ * USAGE: str = sb_build(sb);
+ */
+void gsc_string_sbBuild() {
+	if (Scr_GetNumParam() != 1) {
+		Scr_Error(va("sb_build: invalid number of parameters, expected 1, got %u\n", Scr_GetNumParam()));
+		Scr_AddUndefined();
+		return;
+	}
+	GscStringBuilder* sb = gsc_string_getBuilder("sb_build");
+	if (!sb) { Scr_AddUndefined(); return; }
+
+	Scr_AddString(sb->buffer.c_str());
+
+	// Keep the capacity of small buffers for next builder
+	sb->used = false;
+	sb->buffer.clear();
+	if (sb->buffer.capacity() > 4096)
+		sb->buffer.shrink_to_fit();
+	gsc_string_builders_count--;
+}
+
+
+/**
+ * Split the string by delimiter and return array of parts.
+ * If limit is set, max limit parts are returned and the last part contains the rest of the string.
+ * USAGE: parts = strSplit(str, delimiter, [limit]);
+ * Example: strSplit("a,b,,c", ",") returns ["a", "b", "", "c"]
+ */
+void gsc_string_split() {
+	unsigned int numParams = Scr_GetNumParam();
+	if (numParams < 2 || numParams > 3) {
+		Scr_Error(va("strSplit: invalid number of parameters, expected 2 or 3, got %u\n", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+	const char* str = Scr_GetString(0);
+	const char* delimiter = Scr_GetString(1);
+	int limit = numParams >= 3 ? Scr_GetInt(2) : GSC_STRING_MAX_PARTS;
+	size_t delimiterLen = strlen(delimiter);
+
+	if (delimiterLen == 0) {
+		Scr_Error("strSplit: delimiter is empty\n");
+		Scr_AddUndefined();
+		return;
+	}
+	if (limit <= 0 || limit > GSC_STRING_MAX_PARTS)
+		limit = GSC_STRING_MAX_PARTS;
+
+	// Each part is copied into one reused buffer, because script strings must be null terminated
+	std::string part;
+	Scr_MakeArray();
+	for (int count = 1; ; count++) {
+		const char* found = count < limit ? strstr(str, delimiter) : NULL;
+		if (!found) {
+			Scr_AddString(str);
+			Scr_AddArray();
+			break;
+		}
+		part.assign(str, found - str);
+		Scr_AddString(part.c_str());
+		Scr_AddArray();
+		str = found + delimiterLen;
+	}
+}
+
+/**
+ * Join values into one string with separator between them.
+ * Values can be strings, localized strings, integers, floats or vectors.
+ * USAGE: str = strJoin(separator, value1, value2, ...);
+ * Example: strJoin(", ", "a", 1, 2.5) returns "a, 1, 2.5"
+ */
+void gsc_string_join() {
+	unsigned int numParams = Scr_GetNumParam();
+	if (numParams < 1) {
+		Scr_Error("strJoin: invalid number of parameters, expected at least 1\n");
+		Scr_AddUndefined();
+		return;
+	}
+	const char* separator = Scr_GetString(0);
+
+	std::string result;
+	for (unsigned int i = 1; i < numParams; i++) {
+		if (i > 1) result += separator;
+		if (!gsc_string_appendParam(result, i)) {
+			Scr_Error(va("strJoin: value at index %u has unsupported type\n", i));
+			Scr_AddUndefined();
+			return;
+		}
+		if (result.size() > GSC_STRING_MAX_LENGTH) {
+			Scr_Error(va("strJoin: string is too long, max length is %i\n", GSC_STRING_MAX_LENGTH));
+			Scr_AddUndefined();
+			return;
+		}
+	}
+
+	Scr_AddString(result.c_str());
+}
+
+/**
+ * Replace all occurrences of search in the string.
+ * USAGE: str = strReplace(str, search, replace);
+ */
+void gsc_string_replace() {
+	if (Scr_GetNumParam() != 3) {
+		Scr_Error(va("strReplace: invalid number of parameters, expected 3, got %u\n", Scr_GetNumParam()));
+		Scr_AddUndefined();
+		return;
+	}
+	const char* str = Scr_GetString(0);
+	const char* search = Scr_GetString(1);
+	const char* replace = Scr_GetString(2);
+	size_t searchLen = strlen(search);
+
+	// Nothing to replace, return the original string
+	const char* found = searchLen > 0 ? strstr(str, search) : NULL;
+	if (!found) {
+		Scr_AddString(str);
+		return;
+	}
+
+	std::string result;
+	result.reserve(strlen(str));
+	while (found) {
+		result.append(str, found - str);
+		result += replace;
+		str = found + searchLen;
+		if (result.size() > GSC_STRING_MAX_LENGTH) {
+			Scr_Error(va("strReplace: string is too long, max length is %i\n", GSC_STRING_MAX_LENGTH));
+			Scr_AddUndefined();
+			return;
+		}
+		found = strstr(str, search);
+	}
+	result += str;
+
+	Scr_AddString(result.c_str());
+}
+
+/**
+ * Return index of the first occurrence of search in the string, or -1 if not found.
+ * Search starts at index start if set.
+ * USAGE: index = strFind(str, search, [start]);
+ */
+void gsc_string_find() {
+	unsigned int numParams = Scr_GetNumParam();
+	if (numParams < 2 || numParams > 3) {
+		Scr_Error(va("strFind: invalid number of parameters, expected 2 or 3, got %u\n", numParams));
+		Scr_AddUndefined();
+		return;
+	}
+	const char* str = Scr_GetString(0);
+	const char* search = Scr_GetString(1);
+	int start = numParams >= 3 ? Scr_GetInt(2) : 0;
+
+	int length = (int)strlen(str);
+	if (start < 0) start = 0;
+	if (start > length) {
+		Scr_AddInt(-1);
+		return;
+	}
+
+	const char* found = strstr(str + start, search);
+	Scr_AddInt(found ? (int)(found - str) : -1);
+}
+
+
+/** Free all string builders. Called on level end, because the handles stored in scripts are lost. */
+void gsc_string_freeAll() {
+	if (gsc_string_builders_count > 0)
+		Com_DPrintf("Freeing %i string builders\n", gsc_string_builders_count);
+	gsc_string_builders.clear();
+	gsc_string_builders.shrink_to_fit();
+	gsc_string_builders_count = 0;
+}
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void gsc_string_init() {
+	gsc_registerFunction("sb_create", gsc_string_sbCreate);
+	gsc_registerFunction("sb_append", gsc_string_sbAppend);
+	gsc_registerFunction("sb_build", gsc_string_sbBuild);
+
+	gsc_registerFunction("strSplit", gsc_string_split);
+	gsc_registerFunction("strJoin", gsc_string_join);
+	gsc_registerFunction("strReplace", gsc_string_replace);
+	gsc_registerFunction("strFind", gsc_string_find);
+}
@@ -0,0 +1,14 @@
+#ifndef GSC_STRING_H
+#define GSC_STRING_H
+
+void gsc_string_sbCreate();
+void gsc_string_sbAppend();
+void gsc_string_sbBuild();
+void gsc_string_split();
+void gsc_string_join();
+void gsc_string_replace();
+void gsc_string_find();
+void gsc_string_freeAll();
+void gsc_string_init();
+
+#endif
@@ -1,4 +1,5 @@
 #include "gsc_test.h"
+#include "gsc.h"
 
 #include <stdarg.h> // va_list, va_start, va_end
 
@@ -104,6 +105,22 @@ void gsc_test_getAll() {
 	short thread_id = Scr_ExecThread((int)paramFunction, 0);
 	Scr_FreeThread(thread_id);
 }
+
+/** Called only once on game start after common inicialization. Registers test functions used by test scripts. */
+void gsc_test_init() {
+	gsc_registerMethod("test_playerGetName", gsc_test_playerGetName);
+
+	gsc_registerFunction("test_returnUndefined", gsc_test_returnUndefined);
+	gsc_registerFunction("test_returnBool", gsc_test_returnBool);
+	gsc_registerFunction("test_returnInt", gsc_test_returnInt);
+	gsc_registerFunction("test_returnFloat", gsc_test_returnFloat);
+	gsc_registerFunction("test_returnString", gsc_test_returnString);
+	gsc_registerFunction("test_returnVector", gsc_test_returnVector);
+	gsc_registerFunction("test_returnArray", gsc_test_returnArray);
+	gsc_registerFunction("test_getAll", gsc_test_getAll);
+	gsc_registerFunction("test_allOk", gsc_test_allOk);
+}
+
 #endif // DEBUG
 
 
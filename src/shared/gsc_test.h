@@ -17,6 +17,7 @@ void gsc_test_returnVector();
 void gsc_test_returnArray();
 void gsc_test_getAll();
 void gsc_test_allOk();
+void gsc_test_init();
 
 void gsc_test_onPlayerConnect(int entnum);
 void gsc_test_onStartGameType();
@@ -1,4 +1,5 @@
 #include "gsc_websocket.h"
+#include "gsc.h"
 
 #include <vector>
 
@@ -62,6 +63,7 @@ void gsc_websocket_connect() {
 	void* onCloseCallback = Scr_GetParamFunction(4);
 	void* onErrorCallback = Scr_GetParamFunction(5);
 
+	unsigned int generation = gsc_callback_generation();
 	WebSocketClient* client;
 
 	if (Scr_GetNumParam() >= 8) {
@@ -73,35 +75,29 @@ void gsc_websocket_connect() {
 		client = new WebSocketClient(headers);
 	}
 
-	client->onOpen([onConnectCallback, idx]() {
+	client->onOpen([onConnectCallback, idx, generation]() {
 		Com_DPrintf("WebSocket client #%d connected.\n", idx);
-		if (onConnectCallback && Scr_IsSystemActive()) {
-			short thread_id = Scr_ExecThread((int)onConnectCallback, 0);
-			Scr_FreeThread(thread_id);
-		}
+		gsc_callback_enqueue(onConnectCallback, generation);
 	});
-	client->onMessage([onMessageCallback](const std::string& message) {
-		if (onMessageCallback && Scr_IsSystemActive()) {
+	client->onMessage([onMessageCallback, generation](const std::string& message) {
+		gsc_callback_enqueue(onMessageCallback, generation, [message]() {
 			Scr_AddString(message.c_str());
-			short thread_id = Scr_ExecThread((int)onMessageCallback, 1);
-			Scr_FreeThread(thread_id);
-		}
+			return 1u;
+		});
 	});
-	client->onClose([onCloseCallback, idx](bool isClosedByRemote, bool isFullyDisconnected) {
+	client->onClose([onCloseCallback, idx, generation](bool isClosedByRemote, bool isFullyDisconnected) {
 		Com_DPrintf("WebSocket client #%d disconnected, isClosedByRemote: %d, isFullyDisconnected: %d\n", idx, isClosedByRemote ? 1 : 0, isFullyDisconnected ? 1 : 0);
-		if (onCloseCallback && Scr_IsSystemActive()) {
+		gsc_callback_enqueue(onCloseCallback, generation, [isClosedByRemote, isFullyDisconnected]() {
 			Scr_AddBool(isFullyDisconnected);
 			Scr_AddBool(isClosedByRemote);
-			short thread_id = Scr_ExecThread((int)onCloseCallback, 2);
-			Scr_FreeThread(thread_id);
-		}
+			return 2u;
+		});
 	});
-	client->onError([onErrorCallback](const std::string& error) {
-		if (onErrorCallback && Scr_IsSystemActive()) {
+	client->onError([onErrorCallback, generation](const std::string& error) {
+		gsc_callback_enqueue(onErrorCallback, generation, [error]() {
 			Scr_AddString(error.c_str());
-			short thread_id = Scr_ExecThread((int)onErrorCallback, 1);
-			Scr_FreeThread(thread_id);
-		}
+			return 1u;
+		});
 	});
 
 	gsc_websocket_clients[idx] = client;
@@ -241,6 +237,9 @@ void gsc_websocket_frame() {
 
 /** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
 void gsc_websocket_init() {
+	gsc_registerFunction("websocket_connect", gsc_websocket_connect);
+	gsc_registerFunction("websocket_sendText", gsc_websocket_sendText);
+	gsc_registerFunction("websocket_close", gsc_websocket_close);
 
 	#if DEBUG
 		Cmd_AddCommand("ws", []() { 
@@ -0,0 +1,263 @@
+#include "gzip.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// Small gzip (RFC 1952) compressor, so rotated logs can be compressed without external library.
+// Data are compressed by LZ77 with hash chains and encoded as one DEFLATE (RFC 1951) block with the fixed Huffman codes.
+// Text logs are compressed to about 20-30% of the original size, which is less than zlib, but good enough for archiving.
+
+#define GZIP_WSIZE          32768               // LZ77 window size, max DEFLATE distance
+#define GZIP_WMASK          (GZIP_WSIZE - 1)
+#define GZIP_BUFFER         (2 * GZIP_WSIZE)    // input buffer, upper half is moved down when full
+#define GZIP_MIN_MATCH      3
+#define GZIP_MAX_MATCH      258
+#define GZIP_LOOKAHEAD      (GZIP_MAX_MATCH + GZIP_MIN_MATCH + 1)
+#define GZIP_HASH_BITS      15
+#define GZIP_HASH_SIZE      (1 << GZIP_HASH_BITS)
+#define GZIP_MAX_CHAIN      64                  // max number of previous positions checked for a match
+#define GZIP_NIL            (-1)
+
+static const unsigned short gzip_lengthBase[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const unsigned char gzip_lengthExtra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+static const unsigned short gzip_distBase[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const unsigned char gzip_distExtra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+struct GzipState {
+    FILE* out;
+    unsigned int bitBuffer;
+    int bitCount;
+    unsigned char outBuffer[16384];
+    size_t outLen;
+    bool error;
+
+    unsigned char window[GZIP_BUFFER];
+    int head[GZIP_HASH_SIZE];
+    int prev[GZIP_WSIZE];
+    unsigned int crc;
+    unsigned int crcTable[256];
+};
+
+
+static void gzip_flushOutput(GzipState& s) {
+    if (s.outLen > 0 && fwrite(s.outBuffer, 1, s.outLen, s.out) != s.outLen)
+        s.error = true;
+    s.outLen = 0;
+}
+
+static inline void gzip_putByte(GzipState& s, unsigned char b) {
+    if (s.outLen == sizeof(s.outBuffer))
+        gzip_flushOutput(s);
+    s.outBuffer[s.outLen++] = b;
+}
+
+// Write bits, least significant bit first
+static inline void gzip_putBits(GzipState& s, unsigned int value, int count) {
+    s.bitBuffer |= value << s.bitCount;
+    s.bitCount += count;
+    while (s.bitCount >= 8) {
+        gzip_putByte(s, (unsigned char)s.bitBuffer);
+        s.bitBuffer >>= 8;
+        s.bitCount -= 8;
+    }
+}
+
+// Huffman codes are stored most significant bit first
+static inline void gzip_putCode(GzipState& s, unsigned int code, int length) {
+    unsigned int reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    gzip_putBits(s, reversed, length);
+}
+
+// Write literal or length symbol with the fixed Huffman code
+static void gzip_putSymbol(GzipState& s, int symbol) {
+    if (symbol < 144)       gzip_putCode(s, 0x30 + symbol, 8);
+    else if (symbol < 256)  gzip_putCode(s, 0x190 + symbol - 144, 9);
+    else if (symbol < 280)  gzip_putCode(s, symbol - 256, 7);
+    else                    gzip_putCode(s, 0xC0 + symbol - 280, 8);
+}
+
+static void gzip_putMatch(GzipState& s, int length, int distance) {
+    int code = 28;
+    while (gzip_lengthBase[code] > length) code--;
+    gzip_putSymbol(s, 257 + code);
+    gzip_putBits(s, length - gzip_lengthBase[code], gzip_lengthExtra[code]);
+
+    code = 29;
+    while (gzip_distBase[code] > distance) code--;
+    gzip_putCode(s, code, 5);
+    gzip_putBits(s, distance - gzip_distBase[code], gzip_distExtra[code]);
+}
+
+static inline unsigned int gzip_hash(const unsigned char* p) {
+    return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (GZIP_HASH_SIZE - 1);
+}
+
+// Find the longest match for position in the window, returns match length and sets the distance
+static int gzip_findMatch(GzipState& s, int pos, int available, int& distance) {
+    int best = 0;
+    int maxLength = available < GZIP_MAX_MATCH ? available : GZIP_MAX_MATCH;
+    if (maxLength < GZIP_MIN_MATCH)
+        return 0;
+
+    const unsigned char* cur = s.window + pos;
+    int chain = GZIP_MAX_CHAIN;
+    for (int candidate = s.head[gzip_hash(cur)]; candidate != GZIP_NIL && pos - candidate <= GZIP_WSIZE && chain-- > 0;
+         candidate = s.prev[candidate & GZIP_WMASK]) {
+        const unsigned char* m = s.window + candidate;
+        if (m[best] != cur[best] || m[0] != cur[0])
+            continue;
+        int length = 0;
+        while (length < maxLength && m[length] == cur[length])
+            length++;
+        if (length > best) {
+            best = length;
+            distance = pos - candidate;
+            if (length == maxLength) break;
+        }
+    }
+    return best >= GZIP_MIN_MATCH ? best : 0;
+}
+
+static inline void gzip_insert(GzipState& s, int pos) {
+    unsigned int h = gzip_hash(s.window + pos);
+    s.prev[pos & GZIP_WMASK] = s.head[h];
+    s.head[h] = pos;
+}
+
+
+/**
+ * Compress the file into gzip file. The destination file is overwritten.
+ * Returns false if any of the files cannot be read or written, the destination file might be incomplete then.
+ */
+bool gzip_compressFile(const char* srcPath, const char* dstPath) {
+    FILE* in = fopen(srcPath, "rb");
+    if (!in)
+        return false;
+    FILE* out = fopen(dstPath, "wb");
+    if (!out) {
+        fclose(in);
+        return false;
+    }
+
+    GzipState* state = new GzipState();
+    GzipState& s = *state;
+    s.out = out;
+    for (int i = 0; i < GZIP_HASH_SIZE; i++)
+        s.head[i] = GZIP_NIL;
+    for (unsigned int n = 0; n < 256; n++) {
+        unsigned int c = n;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        s.crcTable[n] = c;
+    }
+    s.crc = 0xFFFFFFFFu;
+
+    // Header: magic, deflate, no flags, modification time, no extra flags, unknown OS
+    unsigned int mtime = (unsigned int)time(NULL);
+    const unsigned char header[10] = {0x1f, 0x8b, 8, 0, (unsigned char)mtime, (unsigned char)(mtime >> 8), (unsigned char)(mtime >> 16), (unsigned char)(mtime >> 24), 0, 255};
+    for (unsigned char b : header)
+        gzip_putByte(s, b);
+
+    // One final block with fixed Huffman codes
+    gzip_putBits(s, 1, 1);
+    gzip_putBits(s, 1, 2);
+
+    unsigned int totalSize = 0;
+    int pos = 0;        // current position in the window
+    int end = 0;        // end of data in the window
+    bool eof = false;
+
+    while (true) {
+        // Keep enough data after the current position, move the upper half down when the buffer is full
+        if (!eof && end - pos < GZIP_LOOKAHEAD) {
+            if (end == GZIP_BUFFER) {
+                memmove(s.window, s.window + GZIP_WSIZE, GZIP_WSIZE);
+                pos -= GZIP_WSIZE;
+                end -= GZIP_WSIZE;
+                for (int i = 0; i < GZIP_HASH_SIZE; i++)
+                    s.head[i] = s.head[i] >= GZIP_WSIZE ? s.head[i] - GZIP_WSIZE : GZIP_NIL;
+                for (int i = 0; i < GZIP_WSIZE; i++)
+                    s.prev[i] = s.prev[i] >= GZIP_WSIZE ? s.prev[i] - GZIP_WSIZE : GZIP_NIL;
+            }
+            size_t read = fread(s.window + end, 1, GZIP_BUFFER - end, in);
+            for (size_t i = 0; i < read; i++)
+                s.crc = s.crcTable[(s.crc ^ s.window[end + i]) & 0xFF] ^ (s.crc >> 8);
+            end += (int)read;
+            totalSize += (unsigned int)read;
+            if (read == 0) {
+                eof = true;
+                if (ferror(in)) s.error = true;
+            }
+            continue;
+        }
+
+        if (pos >= end)
+            break;
+
+        int available = end - pos;
+        int distance = 0;
+        int length = available >= GZIP_MIN_MATCH ? gzip_findMatch(s, pos, available, distance) : 0;
+
+        // Lazy matching, prefer longer match starting at the next byte
+        if (length > 0 && length < 32 && available > length) {
+            int nextDistance = 0;
+            if (available - 1 >= GZIP_MIN_MATCH) {
+                gzip_insert(s, pos);
+                int nextLength = gzip_findMatch(s, pos + 1, available - 1, nextDistance);
+                if (nextLength > length) {
+                    gzip_putSymbol(s, s.window[pos]);
+                    pos++;
+                    length = nextLength;
+                    distance = nextDistance;
+                    for (int i = 0; i < length; i++) {
+                        if (end - (pos + i) >= GZIP_MIN_MATCH) gzip_insert(s, pos + i);
+                    }
+                    gzip_putMatch(s, length, distance);
+                    pos += length;
+                    continue;
+                }
+                for (int i = 1; i < length; i++) {
+                    if (end - (pos + i) >= GZIP_MIN_MATCH) gzip_insert(s, pos + i);
+                }
+                gzip_putMatch(s, length, distance);
+                pos += length;
+                continue;
+            }
+        }
+
+        if (length > 0) {
+            for (int i = 0; i < length; i++) {
+                if (end - (pos + i) >= GZIP_MIN_MATCH) gzip_insert(s, pos + i);
+            }
+            gzip_putMatch(s, length, distance);
+            pos += length;
+        } else {
+            if (available >= GZIP_MIN_MATCH) gzip_insert(s, pos);
+            gzip_putSymbol(s, s.window[pos]);
+            pos++;
+        }
+    }
+
+    // End of block, pad to byte
+    gzip_putSymbol(s, 256);
+    if (s.bitCount > 0)
+        gzip_putBits(s, 0, 8 - s.bitCount);
+
+    // Trailer: CRC32 and size modulo 2^32
+    unsigned int crc = s.crc ^ 0xFFFFFFFFu;
+    for (int i = 0; i < 4; i++) gzip_putByte(s, (unsigned char)(crc >> (8 * i)));
+    for (int i = 0; i < 4; i++) gzip_putByte(s, (unsigned char)(totalSize >> (8 * i)));
+    gzip_flushOutput(s);
+
+    bool ok = !s.error;
+    delete state;
+    fclose(in);
+    if (fclose(out) != 0)
+        ok = false;
+    return ok;
+}
@@ -0,0 +1,6 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+bool gzip_compressFile(const char* srcPath, const char* dstPath);
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <string>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <sys/stat.h>   // stat, mkdir
+#if defined(_WIN32)
+    #include <direct.h> // _mkdir
+    #include <windows.h> // MoveFileExA
+#endif
+
+/**
+ * HTTP response cache used by HttpClient.
+ * Responses are stored in memory in LRU order with a total size limit and optionally on disk,
+ * so they survive map changes and server restarts.
+ * Honors Cache-Control (no-store, no-cache, max-age), ETag and Last-Modified.
+ * Stale responses with ETag or Last-Modified are revalidated with If-None-Match / If-Modified-Since.
+ */
+class HttpCache {
+public:
+    struct Entry {
+        std::string key;
+        int status = 0;
+        std::map<std::string, std::string> headers;
+        std::string body;
+        std::string etag;
+        std::string lastModified;
+        int64_t expires = 0;  // unix time in ms when the response becomes stale
+
+        size_t size() const {
+            size_t s = key.size() + body.size() + etag.size() + lastModified.size();
+            for (const auto& h : headers)
+                s += h.first.size() + h.second.size();
+            return s;
+        }
+        bool isFresh() const { return HttpCache::now() < expires; }
+        bool canRevalidate() const { return !etag.empty() || !lastModified.empty(); }
+    };
+
+    /**
+     * @param max_bytes   Max total size of responses kept in memory.
+     * @param default_ttl Time in seconds a response is considered fresh when the server does not send Cache-Control max-age.
+     * @param dir         Directory for the disk tier, or empty string to keep the responses only in memory.
+     */
+    HttpCache(size_t max_bytes = 4 * 1024 * 1024, int default_ttl = 0, const std::string& dir = "") {
+        m_maxBytes = max_bytes;
+        m_defaultTtl = default_ttl;
+        setDirectory(dir);
+    }
+
+    void setMaxBytes(size_t max_bytes) { m_maxBytes = max_bytes; evict(); }
+    void setDefaultTtl(int seconds) { m_defaultTtl = seconds; }
+    void setDirectory(const std::string& dir) {
+        m_dir = dir;
+        if (!m_dir.empty()) {
+            #if defined(_WIN32)
+                _mkdir(m_dir.c_str());
+            #else
+                mkdir(m_dir.c_str(), 0755);
+            #endif
+        }
+    }
+
+    // Only responses to GET requests are cached
+    static bool isCacheable(const char* method) {
+        return method == nullptr || strcmp(method, "GET") == 0;
+    }
+
+    // Cache key is made from method, URL and request headers, so requests with different auth headers are not mixed
+    static std::string makeKey(const std::string& method, const std::string& url, const std::string& headers) {
+        return method + " " + url + "\n" + headers;
+    }
+
+    /**
+     * Find the response in memory or on disk.
+     * Returns nullptr if not found. Returned entry may be stale, check isFresh().
+     * The pointer is valid until next call of store() or find().
+     */
+    const Entry* find(const std::string& key) {
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second); // move to front
+            m_hits++;
+            return &*it->second;
+        }
+
+        // Not in memory, try the disk
+        Entry entry;
+        if (!m_dir.empty() && readFile(key, entry)) {
+            m_diskHits++;
+            return insert(std::move(entry));
+        }
+
+        m_misses++;
+        return nullptr;
+    }
+
+    /**
+     * Store the response of a request if the response allows it.
+     * Returns the stored entry or nullptr if the response is not cacheable.
+     */
+    const Entry* store(const std::string& key, int status, const std::map<std::string, std::string>& headers, const std::string& body) {
+        if (status != 200)
+            return nullptr;
+
+        std::string cacheControl = lower(header(headers, "Cache-Control"));
+        if (cacheControl.find("no-store") != std::string::npos)
+            return nullptr;
+
+        Entry entry;
+        entry.key = key;
+        entry.status = status;
+        entry.headers = headers;
+        entry.body = body;
+        entry.etag = header(headers, "ETag");
+        entry.lastModified = header(headers, "Last-Modified");
+        entry.expires = now() + freshness(cacheControl) * 1000;
+
+        // Nothing to reuse - response is immediately stale and cannot be revalidated
+        if (!entry.isFresh() && !entry.canRevalidate())
+            return nullptr;
+
+        if (entry.size() > m_maxBytes)
+            return nullptr;
+
+        if (!m_dir.empty())
+            writeFile(entry);
+
+        return insert(std::move(entry));
+    }
+
+    /**
+     * Server responded with 304 Not Modified - refresh the lifetime of the cached response.
+     * The entry might be evicted while the request was pending, then the stale copy sent with the request is stored again.
+     * Returns the refreshed entry or nullptr if the entry could not be cached.
+     */
+    const Entry* revalidated(const std::string& key, const std::map<std::string, std::string>& headers, const Entry& stale) {
+        auto it = m_index.find(key);
+        Entry* found = it != m_index.end() ? &*it->second : nullptr;
+        if (!found) {
+            Entry copy = stale;
+            found = insert(std::move(copy));
+            if (!found)
+                return nullptr;
+        }
+        Entry& entry = *found;
+
+        std::string cacheControl = lower(header(headers, "Cache-Control"));
+        if (cacheControl.empty())
+            cacheControl = lower(header(entry.headers, "Cache-Control"));
+        entry.expires = now() + freshness(cacheControl) * 1000;
+
+        std::string etag = header(headers, "ETag");
+        if (!etag.empty()) {
+            m_bytes -= entry.etag.size();
+            entry.etag = etag;
+            m_bytes += entry.etag.size();
+        }
+
+        if (!m_dir.empty())
+            writeFile(entry);
+
+        m_revalidated++;
+        return &entry;
+    }
+
+    // Returns conditional request headers for revalidation of stale entry, e.g. "If-None-Match: \"abc\"\r\n"
+    static std::string conditionalHeaders(const Entry& entry) {
+        std::string h;
+        if (!entry.etag.empty())
+            h += "If-None-Match: " + entry.etag + "\r\n";
+        if (!entry.lastModified.empty())
+            h += "If-Modified-Since: " + entry.lastModified + "\r\n";
+        return h;
+    }
+
+    void clear() {
+        m_lru.clear();
+        m_index.clear();
+        m_bytes = 0;
+    }
+
+    // Stats
+    size_t count() const { return m_index.size(); }
+    size_t bytes() const { return m_bytes; }
+    size_t maxBytes() const { return m_maxBytes; }
+    uint64_t hits() const { return m_hits; }
+    uint64_t diskHits() const { return m_diskHits; }
+    uint64_t misses() const { return m_misses; }
+    uint64_t revalidatedCount() const { return m_revalidated; }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::list<Entry> m_lru; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    size_t m_bytes = 0;
+    size_t m_maxBytes;
+    int m_defaultTtl;
+    std::string m_dir;
+
+    uint64_t m_hits = 0;
+    uint64_t m_diskHits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_revalidated = 0;
+
+
+    Entry* insert(Entry&& entry) {
+        auto it = m_index.find(entry.key);
+        if (it != m_index.end()) {
+            m_bytes -= it->second->size();
+            m_lru.erase(it->second);
+            m_index.erase(it);
+        }
+        m_bytes += entry.size();
+        m_lru.push_front(std::move(entry));
+        m_index[m_lru.front().key] = m_lru.begin();
+        evict();
+        return m_lru.empty() ? nullptr : &m_lru.front();
+    }
+
+    // Remove least recently used entries until the size fits the limit (disk copies are kept)
+    void evict() {
+        while (m_bytes > m_maxBytes && !m_lru.empty()) {
+            Entry& last = m_lru.back();
+            m_bytes -= last.size();
+            m_index.erase(last.key);
+            m_lru.pop_back();
+        }
+    }
+
+    // Number of seconds the response is fresh
+    int64_t freshness(const std::string& cacheControl) const {
+        if (cacheControl.find("no-cache") != std::string::npos)
+            return 0;
+        size_t pos = cacheControl.find("max-age=");
+        if (pos != std::string::npos)
+            return atoll(cacheControl.c_str() + pos + 8);
+        return m_defaultTtl;
+    }
+
+    static std::string lower(std::string s) {
+        for (auto& c : s) c = (char)tolower((unsigned char)c);
+        return s;
+    }
+
+    // Case-insensitive header lookup
+    static std::string header(const std::map<std::string, std::string>& headers, const char* name) {
+        for (const auto& h : headers) {
+            if (strcasecmp(h.first.c_str(), name) == 0)
+                return h.second;
+        }
+        return "";
+    }
+
+
+    // Disk tier
+    // File format: magic line, key, expires, status, etag, last-modified, headers count, headers, body length, body
+
+    std::string filePath(const std::string& key) const {
+        // FNV-1a 64-bit hash of the key as filename
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : key) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.cache", (unsigned long long)hash);
+        return m_dir + "/" + name;
+    }
+
+    void writeFile(const Entry& entry) const {
+        std::string path = filePath(entry.key);
+        std::string tmp = path + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (!f) return;
+
+        fprintf(f, "CoD2xHttpCache 1\n");
+        writeString(f, entry.key);
+        fprintf(f, "%lld %d\n", (long long)entry.expires, entry.status);
+        writeString(f, entry.etag);
+        writeString(f, entry.lastModified);
+        fprintf(f, "%u\n", (unsigned)entry.headers.size());
+        for (const auto& h : entry.headers) {
+            writeString(f, h.first);
+            writeString(f, h.second);
+        }
+        writeString(f, entry.body);
+        bool ok = ferror(f) == 0;
+        fclose(f);
+
+        // Replace the file only when fully written, so the cache is never corrupted
+        #if defined(_WIN32)
+            ok = ok && MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+        #else
+            ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+        #endif
+        if (!ok)
+            remove(tmp.c_str());
+    }
+
+    bool readFile(const std::string& key, Entry& entry) const {
+        FILE* f = fopen(filePath(key).c_str(), "rb");
+        if (!f) return false;
+
+        char magic[32] = {};
+        bool ok = fgets(magic, sizeof(magic), f) && strcmp(magic, "CoD2xHttpCache 1\n") == 0;
+        long long expires = 0;
+        unsigned int count = 0;
+        ok = ok && readString(f, entry.key) && entry.key == key; // different key with same hash
+        ok = ok && fscanf(f, "%lld %d\n", &expires, &entry.status) == 2;
+        ok = ok && readString(f, entry.etag) && readString(f, entry.lastModified);
+        ok = ok && fscanf(f, "%u\n", &count) == 1 && count < 1024;
+        for (unsigned int i = 0; ok && i < count; i++) {
+            std::string name, value;
+            ok = readString(f, name) && readString(f, value);
+            entry.headers[name] = value;
+        }
+        ok = ok && readString(f, entry.body);
+        fclose(f);
+
+        entry.expires = expires;
+        return ok && entry.size() <= m_maxBytes;
+    }
+
+    // Strings are stored as "<length>\n<data>\n" so they can contain any bytes
+    static void writeString(FILE* f, const std::string& s) {
+        fprintf(f, "%u\n", (unsigned)s.size());
+        fwrite(s.data(), 1, s.size(), f);
+        fputc('\n', f);
+    }
+
+    static bool readString(FILE* f, std::string& s) {
+        unsigned int len = 0;
+        if (fscanf(f, "%u", &len) != 1 || fgetc(f) != '\n' || len > 64 * 1024 * 1024)
+            return false;
+        s.resize(len);
+        if (len > 0 && fread(&s[0], 1, len, f) != len)
+            return false;
+        return fgetc(f) == '\n';
+    }
+};
+
+#endif
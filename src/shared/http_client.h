@@ -2,9 +2,11 @@
 #define HTTP_CLIENT_H
 
 #include "mongoose/mongoose.h"
+#include "http_cache.h"
 #include <functional>
 #include <string>
 #include <map>
+#include <vector>
 #include <cstring>
 #include <cstdint>
 
@@ -15,6 +17,7 @@
  * Supports GET and POST requests with custom headers and timeouts.
  * Connection is closed after each request.
  * Call poll() periodically to process events.
+ * If cache is set, GET responses are cached and fresh cached responses are returned immediately from request() without network access.
  */
 class HttpClient {
 public:
@@ -30,6 +33,9 @@ public:
     // Headers used in every request
     std::vector<std::string> headers;
 
+    // Optional response cache, not owned by the client
+    HttpCache* cache = nullptr;
+
 
     HttpClient() {
         mg_log_set(MG_LL_NONE);
@@ -107,6 +113,7 @@ public:
      * @param timeout_ms  Timeout for the request in milliseconds.
      *
      * If the connection cannot be established, the onError callback is invoked with an error message.
+     * If a fresh response is found in the cache, the onDone callback is invoked before this function returns.
      */
     void request(const char* method, const char* url, const char* data, const char* headers, Callback onDone, ErrorCallback onError, int timeout_ms)
     {
@@ -128,6 +135,28 @@ public:
         ctx->onDone  = std::move(onDone);
         ctx->onError = std::move(onError);
         ctx->timeout_ms = timeout_ms;
+        ctx->client  = this;
+
+        if (cache && HttpCache::isCacheable(method)) {
+            ctx->cacheKey = HttpCache::makeKey(ctx->method, ctx->url, ctx->headers);
+            const HttpCache::Entry* entry = cache->find(ctx->cacheKey);
+            if (entry) {
+                // Fresh response - complete the request now without network access
+                if (entry->isFresh()) {
+                    Response res;
+                    res.status = entry->status;
+                    res.headers = entry->headers;
+                    res.body = entry->body;
+                    Callback done = std::move(ctx->onDone);
+                    delete ctx;
+                    if (done) done(res);
+                    return;
+                }
+                // Stale response - ask the server if it was modified, the copy is used if the entry is evicted meanwhile
+                ctx->headers += HttpCache::conditionalHeaders(*entry);
+                ctx->stale = *entry;
+            }
+        }
 
         struct mg_connection* c = mg_http_connect(&mgr, ctx->url.c_str(), ev_handler, ctx);
         if (!c) {
@@ -145,6 +174,9 @@ private:
         Callback onDone;
         ErrorCallback onError;
         int timeout_ms = 0;
+        HttpClient* client = nullptr;
+        std::string cacheKey;
+        HttpCache::Entry stale;     // cached response being revalidated, empty key if none
     };
 
     mg_mgr mgr;
@@ -222,6 +254,21 @@ private:
                     std::string(hm->headers[i].value.buf, hm->headers[i].value.len);
             }
 
+            HttpCache* cache = ctx ? ctx->client->cache : nullptr;
+            if (cache && !ctx->cacheKey.empty()) {
+                if (res.status == 304 && !ctx->stale.key.empty()) {
+                    // Not modified - use the cached response
+                    const HttpCache::Entry* entry = cache->revalidated(ctx->cacheKey, res.headers, ctx->stale);
+                    if (!entry)
+                        entry = &ctx->stale;
+                    res.status = entry->status;
+                    res.headers = entry->headers;
+                    res.body = entry->body;
+                } else {
+                    cache->store(ctx->cacheKey, res.status, res.headers, res.body);
+                }
+            }
+
             if (ctx && ctx->onDone) ctx->onDone(res);
             c->is_closing = 1;
         }
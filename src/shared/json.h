@@ -1,7 +1,14 @@
+#ifndef JSON_H
+#define JSON_H
+
 #include "mongoose/mongoose.h"
+#include "cJSON/cJSON.h"
 #include <stdbool.h>
 #include <string.h>
 #include <functional>
+#include <emmintrin.h>
+
+#include "shared.h"
 
 // Get string field. Caller provides buffer.
 // Returns true if found, false otherwise.
@@ -64,6 +71,30 @@ static inline bool json_get_long(const char *json, const char *path, long *out)
     return true;
 }
 
+// Get string value of parsed cJSON item. Caller provides buffer.
+// Numbers and booleans are converted to string the same way as in json_get_str.
+// Returns true if item is string, number or boolean, false otherwise.
+static inline bool json_item_get_str(const cJSON *item, char *out, size_t out_len)
+{
+    if (item == NULL || out_len == 0) return false;
+
+    if (cJSON_IsString(item) && item->valuestring != NULL) {
+        strncpy(out, item->valuestring, out_len - 1);
+        out[out_len - 1] = '\0';
+        return true;
+    }
+    if (cJSON_IsNumber(item)) {
+        snprintf(out, out_len, "%.0f", item->valuedouble);
+        return true;
+    }
+    if (cJSON_IsBool(item)) {
+        strncpy(out, cJSON_IsTrue(item) ? "true" : "false", out_len - 1);
+        out[out_len - 1] = '\0';
+        return true;
+    }
+    return false;
+}
+
 /**
  * @brief Iterates over elements of a JSON array at the specified path and invokes a callback for each element.
  *
@@ -94,34 +125,108 @@ static inline bool json_iter_array(const char *json, const char *path, const std
     return true;
 }
 
+// Scalar version of json_escape_append, used when SSE2 is not available
+static inline void json_escape_append_scalar(std::string &out, const char *in, size_t len) {
+    size_t start = 0; // start of the run of characters that dont need escaping
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char) in[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        out.append(in + start, i - start);
+        start = i + 1;
+
+        switch (c) {
+            case '"':  out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2);  break;
+            case '\f': out.append("\\f", 2);  break;
+            case '\n': out.append("\\n", 2);  break;
+            case '\r': out.append("\\r", 2);  break;
+            case '\t': out.append("\\t", 2);  break;
+            default: {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned) c);
+                out.append(buf, 6);
+            }
+        }
+    }
+    out.append(in + start, len - start);
+}
+
+// SSE2 version of json_escape_append
+// Characters are checked 16 at once and runs of characters that dont need escaping are copied in bulk
+__attribute__((target("sse2")))
+static inline void json_escape_append_sse2(std::string &out, const char *in, size_t len) {
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    size_t start = 0; // start of the run of characters that dont need escaping
+    size_t i = 0;
+
+    while (i < len) {
+        // Find next character that needs escaping
+        if (i + 16 <= len) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+            __m128i m = _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v); // c <= 0x1F
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, quote));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, backslash));
+            int mask = _mm_movemask_epi8(m);
+            if (mask == 0) {
+                i += 16;
+                continue;
+            }
+            i += __builtin_ctz(mask);
+        } else {
+            unsigned char c = (unsigned char) in[i];
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                i++;
+                continue;
+            }
+        }
+
+        out.append(in + start, i - start);
+        unsigned char c = (unsigned char) in[i];
+        switch (c) {
+            case '"':  out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2);  break;
+            case '\f': out.append("\\f", 2);  break;
+            case '\n': out.append("\\n", 2);  break;
+            case '\r': out.append("\\r", 2);  break;
+            case '\t': out.append("\\t", 2);  break;
+            default: {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned) c);
+                out.append(buf, 6);
+            }
+        }
+        start = ++i;
+    }
+    out.append(in + start, len - start);
+}
+
+/**
+ * Escape a string for JSON output and append it to the output string, without allocating temporary strings.
+ * Example: json_escape_append(out, "Hello \"world\"", 15); => Hello \"world\"
+ */
+static inline void json_escape_append(std::string &out, const char *in, size_t len) {
+    if (cpu_sse2)
+        json_escape_append_sse2(out, in, len);
+    else
+        json_escape_append_scalar(out, in, len);
+}
+
 /**
  * Escape a string for JSON output.
  * Example: json_escape_string("Hello \"world\"", escaped, sizeof(escaped)); => "Hello \"world\""
  */
 static inline std::string json_escape_string(const std::string &in) {
     std::string out;
-    out.reserve(in.size() * 2 + 16); // Worst case: every char escapes to two chars, plus a few \uXXXX. Reserve some headroom.
-
-    for (size_t i = 0; i < in.size(); i++) {
-        unsigned char c = (unsigned char) in[i];
-        switch (c) {
-            case '"':  out.push_back('\\'); out.push_back('"'); break;
-            case '\\': out.push_back('\\'); out.push_back('\\'); break;
-            case '\b': out.push_back('\\'); out.push_back('b');  break;
-            case '\f': out.push_back('\\'); out.push_back('f');  break;
-            case '\n': out.push_back('\\'); out.push_back('n');  break;
-            case '\r': out.push_back('\\'); out.push_back('r');  break;
-            case '\t': out.push_back('\\'); out.push_back('t');  break;
-            default:
-                if (c < 0x20) {
-                    char buf[8];
-                    std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned) c);
-                    buf[sizeof(buf) - 1] = '\0';
-                    out.append(buf);
-                } else {
-                    out.push_back(static_cast<char>(c));
-                }
-        }
-    }
+    out.reserve(in.size() + 16);
+    json_escape_append(out, in.data(), in.size());
     return out;
-}
\ No newline at end of file
+}
+
+#endif
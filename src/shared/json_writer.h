@@ -0,0 +1,52 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <cstring>
+
+#include "json.h"
+
+/**
+ * Streaming JSON writer that appends into one growable buffer.
+ * Strings are escaped directly into the buffer, no temporary strings are created.
+ * The buffer keeps its capacity after clear(), so the writer can be reused without new allocations.
+ * Formatting (new lines, indentation) is up to the caller via raw().
+ * Example:
+ *   writer.clear();
+ *   writer.raw("{\"name\": ").string(name).raw("}");
+ *   send(writer.c_str(), writer.size());
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(size_t reserve = 4096) {
+        m_buf.reserve(reserve);
+    }
+
+    // Remove the content, but keep allocated memory
+    void clear() { m_buf.clear(); }
+    void reserve(size_t size) { m_buf.reserve(size); }
+
+    // Append text as it is
+    JsonWriter& raw(const char* s, size_t len) { m_buf.append(s, len); return *this; }
+    JsonWriter& raw(const char* s) { return raw(s, strlen(s)); }
+    JsonWriter& raw(const std::string& s) { return raw(s.data(), s.size()); }
+
+    // Append escaped text without quotes
+    JsonWriter& escaped(const char* s, size_t len) { json_escape_append(m_buf, s, len); return *this; }
+    JsonWriter& escaped(const char* s) { return escaped(s, strlen(s)); }
+    JsonWriter& escaped(const std::string& s) { return escaped(s.data(), s.size()); }
+
+    // Append quoted and escaped string
+    JsonWriter& string(const char* s, size_t len) { m_buf.push_back('"'); escaped(s, len); m_buf.push_back('"'); return *this; }
+    JsonWriter& string(const char* s) { return string(s, strlen(s)); }
+    JsonWriter& string(const std::string& s) { return string(s.data(), s.size()); }
+
+    const std::string& str() const { return m_buf; }
+    const char* c_str() const { return m_buf.c_str(); }
+    size_t size() const { return m_buf.size(); }
+
+private:
+    std::string m_buf;
+};
+
+#endif
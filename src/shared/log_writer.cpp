@@ -0,0 +1,670 @@
+#include "log_writer.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <ctime>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "shared.h"
+#if COD2X_WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+#endif
+
+#include "cod2_common.h"
+#include "cod2_dvars.h"
+#include "cod2_cmd.h"
+#include "gzip.h"
+
+// Buffered writer for the server log files (games_mp.log written by G_LogPrintf and console_mp_server.log written by Com_PrintMessage).
+// The engine writes every line from the main thread and flushes it when g_logSync or logfile 2 is set, which
+// causes frame hitches on slow disks. Writes into these files are hooked, lines are copied into memory and
+// a worker thread writes them in the same order. Before the engine closes the file, everything is written synchronously.
+//
+// Log files can be rotated by size or time. Rotation thread renames the file to <name>.<YYYYMMDD-HHMMSS> and
+// reopens the original name, so the engine keeps writing without noticing. On Linux the new file is opened under
+// the same file descriptor. On Windows an opened file cannot be renamed, so it is closed, moved by MoveFileEx
+// and opened again, and the new FILE* is stored into the file handle of the engine.
+// Rotated files are then compressed to .gz and the oldest are deleted on the same low priority thread.
+//
+// On Windows the executable has its own statically linked C runtime, so FILE* of the log files must be written
+// and flushed by the functions of the executable, not by the runtime of this library.
+
+#define LOG_WRITER_IDLE_MS          10
+#define LOG_WRITER_MAX_PENDING      (8 * 1024 * 1024)   // if worker cannot keep up, main thread writes synchronously
+#define LOG_WRITER_ROTATE_CHECK_MS  1000
+
+// Original engine functions
+#define FS_Write_original           ((int (*)(const void* buffer, int len, int h))ADDR(0x00422f90, 0x080a0656))
+#define FS_FCloseFile_original      ((void (*)(int h))ADDR(0x00421fd0, 0x0809ee54))
+#define fsh_files                   ADDR(0x00b1e7e8, 0x0849fd80)   // FILE* of file handles, 0x11c bytes per handle
+
+static inline FILE* FS_FileForHandle(int h) {
+    return *(FILE**)(fsh_files + h * 0x11c);
+}
+
+#if COD2X_WIN32
+#define fsh_names                   (fsh_files + 0x1c)              // name of the file relative to the game directory
+#define fs_gamedir                  ((const char*)0x00b1a4a8)
+
+static inline void FS_SetFileForHandle(int h, FILE* file) {
+    *(FILE**)(fsh_files + h * 0x11c) = file;
+}
+#endif
+
+static inline void FS_ForceFlush_original(int h) {
+    ASM_CALL(RETURN_VOID, ADDR(0x00425c90, 0x080a36e2), WL(0, 1), WL(EAX, PUSH)(h));
+}
+
+// Write and flush the FILE* opened by the engine
+static inline void log_writer_fwrite(const void* data, size_t size, FILE* file) {
+    #if COD2X_WIN32
+        size_t itemSize = 1;
+        ASM_CALL(RETURN_VOID, 0x0057bea6, 4, PUSH(data), PUSH(itemSize), PUSH(size), PUSH(file)); // fwrite of the executable
+    #else
+        fwrite(data, 1, size, file);
+    #endif
+}
+
+static inline void log_writer_fflush(FILE* file) {
+    #if COD2X_WIN32
+        ASM_CALL(RETURN_VOID, 0x0057c31f, 1, PUSH(file)); // fflush of the executable
+    #else
+        fflush(file);
+    #endif
+}
+
+#if COD2X_WIN32
+// Close and open the FILE* of the engine, used to reopen the log file after rotation
+static inline void log_writer_fclose(FILE* file) {
+    ASM_CALL(RETURN_VOID, 0x0057c016, 1, PUSH(file)); // fclose of the executable
+}
+
+static inline FILE* log_writer_fopen(const char* path, const char* mode) {
+    FILE* ret;
+    ASM_CALL(RETURN(ret), 0x0057bc57, 2, PUSH(path), PUSH(mode)); // fopen of the executable
+    return ret;
+}
+#endif
+
+dvar_t* sv_logBuffer;
+dvar_t* sv_logBufferSize;
+dvar_t* sv_logBufferInterval;
+dvar_t* sv_logRotateSize;
+dvar_t* sv_logRotateTime;
+dvar_t* sv_logRotateKeep;
+dvar_t* sv_logRotateCompress;
+
+struct LogWriterChunk {
+    int h;                  // file handle, the FILE* might be replaced by rotation
+    std::string data;
+    bool flush;             // flush the file after the data are written
+};
+
+struct LogWriterFile {
+    int h;
+    std::string path;       // Windows only, on Linux the path is read from the descriptor
+};
+
+static struct {
+    std::vector<LogWriterChunk> pending;
+    size_t pendingBytes;
+    uint64_t pendingSince;  // time of the oldest pending write
+    uint64_t written;       // bytes written by the worker
+    std::vector<LogWriterFile> files;   // opened log files seen by the hooks
+    bool rotateRequested;   // rotate all files at next check (logRotate command)
+    int rotated;            // number of rotated files
+    int compressed;         // number of compressed files
+    int failed;             // number of failed rotations or compressions
+    std::map<std::string, time_t> rotatedAt;    // path -> time of last rotation or first write, used only by rotation thread
+    bool initialized;
+    #if COD2X_WIN32
+        CRITICAL_SECTION cs;    // protects pending data
+        CRITICAL_SECTION io;    // held while writing, so chunks are written in order by the worker or main thread
+    #else
+        pthread_mutex_t cs;
+        pthread_mutex_t io;
+    #endif
+} logw;
+
+
+static void log_writer_lock(bool io) {
+    #if COD2X_WIN32
+        EnterCriticalSection(io ? &logw.io : &logw.cs);
+    #else
+        pthread_mutex_lock(io ? &logw.io : &logw.cs);
+    #endif
+}
+
+static void log_writer_unlock(bool io) {
+    #if COD2X_WIN32
+        LeaveCriticalSection(io ? &logw.io : &logw.cs);
+    #else
+        pthread_mutex_unlock(io ? &logw.io : &logw.cs);
+    #endif
+}
+
+static void log_writer_sleep(int ms) {
+    #if COD2X_WIN32
+        Sleep(ms);
+    #else
+        usleep(ms * 1000);
+    #endif
+}
+
+// Write all pending chunks. Must be called with the io lock held, so chunks taken by other thread are written first.
+static size_t log_writer_writePending() {
+    std::vector<LogWriterChunk> chunks;
+    log_writer_lock(false);
+    chunks.swap(logw.pending);
+    logw.pendingBytes = 0;
+    log_writer_unlock(false);
+
+    size_t bytes = 0;
+    FILE* last = NULL;
+    for (const auto& c : chunks) {
+        FILE* file = FS_FileForHandle(c.h);
+        if (!file)
+            continue; // handle is not opened
+        log_writer_fwrite(c.data.data(), c.data.size(), file);
+        bytes += c.data.size();
+        if (last && last != file) log_writer_fflush(last);
+        last = file;
+        if (c.flush) log_writer_fflush(file);
+    }
+    if (last) log_writer_fflush(last);
+    return bytes;
+}
+
+static void log_writer_worker() {
+    while (true) {
+        log_writer_sleep(LOG_WRITER_IDLE_MS);
+
+        log_writer_lock(false);
+        bool ready = !logw.pending.empty() && (
+            logw.pendingBytes >= (size_t)sv_logBufferSize->value.integer * 1024 ||
+            ticks_ms() - logw.pendingSince >= (uint64_t)sv_logBufferInterval->value.integer);
+        log_writer_unlock(false);
+
+        if (!ready)
+            continue;
+
+        log_writer_lock(true);
+        size_t bytes = log_writer_writePending();
+        log_writer_unlock(true);
+
+        log_writer_lock(false);
+        logw.written += bytes;
+        log_writer_unlock(false);
+    }
+}
+
+#if COD2X_WIN32
+static DWORD WINAPI log_writer_workerThread(LPVOID arg) {
+    log_writer_worker();
+    return 0;
+}
+#else
+static void* log_writer_workerThread(void* arg) {
+    log_writer_worker();
+    return NULL;
+}
+#endif
+
+
+/** Write all pending data to the disk synchronously. */
+void log_writer_flush() {
+    if (!logw.initialized)
+        return;
+    log_writer_lock(true);
+    log_writer_writePending();
+    log_writer_unlock(true);
+}
+
+// Remember the log file, so the rotation thread knows which files to check. Must be called with the cs lock held.
+static void log_writer_trackFile(int h) {
+    for (const auto& f : logw.files) {
+        if (f.h == h) return;
+    }
+    #if COD2X_WIN32
+        // Same path as FS_BuildOSPath used by the engine when opening the file
+        std::string path = std::string(Dvar_GetString("fs_homepath")) + "\\" + fs_gamedir + "\\" + (const char*)(fsh_names + h * 0x11c);
+        logw.files.push_back({h, path});
+    #else
+        logw.files.push_back({h, std::string()});
+    #endif
+}
+
+// Replaces FS_Write(buffer, len, h) when writing a line into the log file
+static int log_writer_FS_Write(const void* buffer, int len, int h) {
+    if (!logw.initialized || h == 0 || len <= 0 || !FS_FileForHandle(h))
+        return FS_Write_original(buffer, len, h);
+
+    log_writer_lock(false);
+    log_writer_trackFile(h);
+
+    if (!sv_logBuffer->value.boolean) {
+        log_writer_unlock(false);
+        // Buffering might be just disabled, keep the order. Written under io lock so the file is not rotated meanwhile.
+        log_writer_lock(true);
+        log_writer_writePending();
+        int ret = FS_Write_original(buffer, len, h);
+        log_writer_unlock(true);
+        return ret;
+    }
+
+    if (logw.pending.empty())
+        logw.pendingSince = ticks_ms();
+    if (logw.pending.empty() || logw.pending.back().h != h || logw.pending.back().flush)
+        logw.pending.push_back({h, std::string(), false});
+    logw.pending.back().data.append((const char*)buffer, len);
+    logw.pendingBytes += len;
+    bool overflow = logw.pendingBytes > LOG_WRITER_MAX_PENDING;
+    log_writer_unlock(false);
+
+    // Worker cannot keep up with the disk, dont let the memory grow
+    if (overflow)
+        log_writer_flush();
+
+    return len;
+}
+
+// Replaces FS_ForceFlush(h) called after each console log line when logfile is 2, the worker flushes the file instead
+static void log_writer_FS_ForceFlush(int h) {
+    if (!logw.initialized) {
+        FS_ForceFlush_original(h);
+        return;
+    }
+    if (!sv_logBuffer->value.boolean) {
+        log_writer_lock(true);
+        log_writer_writePending();
+        FS_ForceFlush_original(h);
+        log_writer_unlock(true);
+        return;
+    }
+
+    log_writer_lock(false);
+    if (!logw.pending.empty())
+        logw.pending.back().flush = true;
+    log_writer_unlock(false);
+}
+
+// Replaces FS_FCloseFile(h) of the log files, pending data must be written before the file is closed
+static void log_writer_FS_FCloseFile(int h) {
+    if (!logw.initialized) {
+        FS_FCloseFile_original(h);
+        return;
+    }
+
+    // Closed under io lock, so the rotation thread does not use the file meanwhile
+    log_writer_lock(true);
+    log_writer_writePending();
+
+    log_writer_lock(false);
+    for (size_t i = 0; i < logw.files.size(); i++) {
+        if (logw.files[i].h == h) {
+            logw.files.erase(logw.files.begin() + i);
+            break;
+        }
+    }
+    log_writer_unlock(false);
+
+    FS_FCloseFile_original(h);
+    log_writer_unlock(true);
+}
+
+#if COD2X_WIN32
+static void log_writer_FS_ForceFlush_Win32() {
+    int h;
+    ASM( movr, h, "eax" );
+    log_writer_FS_ForceFlush(h);
+}
+#endif
+
+
+static void log_writer_localtime(time_t t, struct tm* out) {
+    #if COD2X_WIN32
+        *out = *localtime(&t); // thread local buffer in the Windows runtime
+    #else
+        localtime_r(&t, out);
+    #endif
+}
+
+// Rename the file, existing destination is replaced
+static bool log_writer_moveFile(const std::string& from, const std::string& to) {
+    #if COD2X_WIN32
+        return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    #else
+        return rename(from.c_str(), to.c_str()) == 0;
+    #endif
+}
+
+// Rotated files are named <log name>.<YYYYMMDD-HHMMSS>[-N][.gz]
+static bool log_writer_isRotatedName(const std::string& name, const std::string& logName, std::string& key) {
+    if (name.size() < logName.size() + 16 || name.compare(0, logName.size(), logName) != 0 || name[logName.size()] != '.')
+        return false;
+    const char* p = name.c_str() + logName.size() + 1;
+    for (int i = 0; i < 15; i++) {
+        if (i == 8 ? p[i] != '-' : (p[i] < '0' || p[i] > '9'))
+            return false;
+    }
+    key = name;
+    if (key.size() > 3 && key.compare(key.size() - 3, 3, ".gz") == 0)
+        key.resize(key.size() - 3);
+    // Only digits of the optional counter may follow, this also skips unfinished .gz.tmp files
+    for (size_t i = logName.size() + 16; i < key.size(); i++) {
+        if (!(key[i] == '-' && i == logName.size() + 16) && (key[i] < '0' || key[i] > '9'))
+            return false;
+    }
+    return true;
+}
+
+// Compress rotated files of the log and delete the oldest ones over the limit. Called without any lock, might take long.
+static void log_writer_archive(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::string prefix = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    std::string logName = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    // Sorted by key, the time in the name, so the oldest are first
+    std::map<std::string, std::vector<std::string>> rotated;
+    DIR* d = opendir(dir.c_str());
+    if (!d)
+        return;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        std::string key;
+        if (log_writer_isRotatedName(entry->d_name, logName, key))
+            rotated[key].push_back(entry->d_name);
+    }
+    closedir(d);
+
+    if (sv_logRotateCompress->value.boolean) {
+        for (auto& r : rotated) {
+            if (r.second.size() != 1 || r.second[0] != r.first)
+                continue; // already compressed
+            std::string src = prefix + r.first;
+            std::string tmp = src + ".gz.tmp";
+            bool ok = gzip_compressFile(src.c_str(), tmp.c_str()) && log_writer_moveFile(tmp, src + ".gz");
+            if (ok) {
+                remove(src.c_str());
+                r.second[0] = r.first + ".gz";
+            } else {
+                remove(tmp.c_str());
+            }
+            log_writer_lock(false);
+            if (ok) logw.compressed++; else logw.failed++;
+            log_writer_unlock(false);
+        }
+    }
+
+    int keep = sv_logRotateKeep->value.integer;
+    if (keep <= 0)
+        return;
+    int count = (int)rotated.size() - keep;
+    for (auto it = rotated.begin(); it != rotated.end() && count > 0; ++it, count--) {
+        for (const auto& name : it->second)
+            remove((prefix + name).c_str());
+    }
+}
+
+// Get the current path and size of the log file. Returns false if the file was deleted or is unknown.
+static bool log_writer_fileInfo(const LogWriterFile& f, std::string& path, long long& size) {
+    #if COD2X_WIN32
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(f.path.c_str(), GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            return false;
+        path = f.path;
+        size = ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    #else
+        char link[64];
+        char buffer[4096];
+        int fd = fileno(FS_FileForHandle(f.h));
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+        ssize_t len = readlink(link, buffer, sizeof(buffer) - 1);
+        struct stat st;
+        if (len <= 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_nlink == 0)
+            return false;
+        path.assign(buffer, len);
+        size = st.st_size;
+    #endif
+    return true;
+}
+
+// Rename the log file and reopen the original path for the engine. Must be called with the io lock held.
+static bool log_writer_rotateFile(int h, const std::string& path, time_t now) {
+    // Data written before the rotation belong to the old file
+    log_writer_writePending();
+    FILE* file = FS_FileForHandle(h);
+    log_writer_fflush(file);
+
+    struct tm t;
+    log_writer_localtime(now, &t);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &t);
+
+    std::string rotated = path + "." + stamp;
+    struct stat st;
+    for (int i = 1; stat(rotated.c_str(), &st) == 0 || stat((rotated + ".gz").c_str(), &st) == 0; i++)
+        rotated = path + "." + stamp + "-" + std::to_string(i);
+
+    #if COD2X_WIN32
+        // The engine writes into the FILE* of the handle without any check, it must never be NULL.
+        // Null device is opened before the log is closed and used if the log file cannot be opened again.
+        FILE* spare = log_writer_fopen("NUL", "ab");
+        if (!spare)
+            return false;
+
+        // The file is opened without FILE_SHARE_DELETE, it must be closed before it can be moved
+        log_writer_fclose(file);
+        bool moved = MoveFileExA(path.c_str(), rotated.c_str(), MOVEFILE_WRITE_THROUGH) != 0;
+        FILE* reopened = log_writer_fopen(path.c_str(), "ab");
+        if (!reopened && moved) {
+            moved = false;
+            MoveFileExA(rotated.c_str(), path.c_str(), MOVEFILE_WRITE_THROUGH);
+            reopened = log_writer_fopen(path.c_str(), "ab");
+        }
+        if (reopened) {
+            log_writer_fclose(spare);
+        } else {
+            moved = false;
+            reopened = spare; // lines are discarded until the engine opens the log again
+        }
+        FS_SetFileForHandle(h, reopened);
+        return moved;
+    #else
+        if (rename(path.c_str(), rotated.c_str()) != 0)
+            return false;
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0 || dup2(fd, fileno(file)) < 0) {
+            if (fd >= 0) close(fd);
+            rename(rotated.c_str(), path.c_str());
+            return false;
+        }
+        close(fd);
+        return true;
+    #endif
+}
+
+// Returns true if the rotation period (in minutes, aligned to the local midnight) changed between the times
+static bool log_writer_periodChanged(time_t from, time_t to, int minutes) {
+    struct tm t;
+    log_writer_localtime(from, &t);
+    long long a = (long long)WL(_mkgmtime, timegm)(&t) / (minutes * 60LL);
+    log_writer_localtime(to, &t);
+    long long b = (long long)WL(_mkgmtime, timegm)(&t) / (minutes * 60LL);
+    return a != b;
+}
+
+static void log_writer_checkRotation() {
+    long long sizeLimit = (long long)sv_logRotateSize->value.integer * 1024 * 1024;
+    int minutes = sv_logRotateTime->value.integer;
+    time_t now = time(NULL);
+    std::vector<std::string> rotatedPaths;
+
+    // The io lock is held only for the size check and rename, files cannot be closed by the main thread meanwhile
+    log_writer_lock(true);
+    log_writer_lock(false);
+    std::vector<LogWriterFile> files = logw.files;
+    bool force = logw.rotateRequested;
+    logw.rotateRequested = false;
+    log_writer_unlock(false);
+
+    for (const auto& f : files) {
+        std::string path;
+        long long size;
+        if (!FS_FileForHandle(f.h) || !log_writer_fileInfo(f, path, size))
+            continue; // deleted or unknown file
+
+        auto it = logw.rotatedAt.find(path);
+        if (it == logw.rotatedAt.end())
+            it = logw.rotatedAt.insert({path, now}).first;
+
+        bool due = force ||
+            (sizeLimit > 0 && size >= sizeLimit) ||
+            (minutes > 0 && log_writer_periodChanged(it->second, now, minutes));
+        if (!due)
+            continue;
+        it->second = now;
+        if (size == 0 && !force)
+            continue; // nothing was written in this period
+
+        bool ok = log_writer_rotateFile(f.h, path, now);
+        log_writer_lock(false);
+        if (ok) logw.rotated++; else logw.failed++;
+        log_writer_unlock(false);
+        if (ok)
+            rotatedPaths.push_back(path);
+    }
+    log_writer_unlock(true);
+
+    for (const auto& path : rotatedPaths)
+        log_writer_archive(path);
+}
+
+static void log_writer_rotate() {
+    while (true) {
+        log_writer_sleep(LOG_WRITER_ROTATE_CHECK_MS);
+        log_writer_checkRotation();
+    }
+}
+
+// Compression is not urgent, dont compete with the server frame for the CPU
+#if COD2X_WIN32
+static DWORD WINAPI log_writer_rotateThread(LPVOID arg) {
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+    log_writer_rotate();
+    return 0;
+}
+#else
+static void* log_writer_rotateThread(void* arg) {
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+    log_writer_rotate();
+    return NULL;
+}
+#endif
+
+
+void log_writer_cmd_status() {
+    log_writer_lock(false);
+    size_t pending = logw.pendingBytes;
+    uint64_t written = logw.written;
+    int rotated = logw.rotated;
+    int compressed = logw.compressed;
+    int failed = logw.failed;
+    log_writer_unlock(false);
+
+    // Printing writes into the console log, so it must not be called with the lock held
+    Com_Printf("Log writer: %s, %u bytes pending, %llu bytes written by worker\n", sv_logBuffer->value.boolean ? "enabled" : "disabled",
+        (unsigned)pending, (unsigned long long)written);
+    Com_Printf("Log rotation: %d files rotated, %d compressed, %d failed\n", rotated, compressed, failed);
+}
+
+void log_writer_cmd_rotate() {
+    log_writer_lock(false);
+    logw.rotateRequested = true;
+    log_writer_unlock(false);
+    Com_Printf("Log files will be rotated\n");
+}
+
+
+/**
+ * Called before a map change, restart or shutdown that can be triggered from a script or a command.
+ * Returns true to proceed, false to cancel the operation. Return value is ignored when shutdown is true.
+ * @param fromScript true if map change was triggered from a script, false if from a command.
+ * @param bComplete true if map change or restart is complete, false if it's a round restart so persistent variables are kept.
+ * @param shutdown true if the server is shutting down, false otherwise.
+ * @param source the source of the map change or restart.
+ */
+bool log_writer_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source) {
+
+    // Log files might be closed or reopened by the engine (for example file system restart)
+    log_writer_flush();
+
+    return true;
+}
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void log_writer_init() {
+    sv_logBuffer = Dvar_RegisterBool("sv_logBuffer", true, (dvarFlags_e)(DVAR_CHANGEABLE_RESET));
+    sv_logBufferSize = Dvar_RegisterInt("sv_logBufferSize", 64, 1, 4096, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // KB, written when exceeded
+    sv_logBufferInterval = Dvar_RegisterInt("sv_logBufferInterval", 1000, 10, 60000, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // ms, max time the line stays in memory
+    sv_logRotateSize = Dvar_RegisterInt("sv_logRotateSize", 0, 0, 16384, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // MB, 0 = disabled
+    sv_logRotateTime = Dvar_RegisterInt("sv_logRotateTime", 0, 0, 43200, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // minutes aligned to midnight (1440 = daily), 0 = disabled
+    sv_logRotateKeep = Dvar_RegisterInt("sv_logRotateKeep", 10, 0, 10000, (dvarFlags_e)(DVAR_CHANGEABLE_RESET)); // number of rotated files kept per log, 0 = all
+    sv_logRotateCompress = Dvar_RegisterBool("sv_logRotateCompress", true, (dvarFlags_e)(DVAR_CHANGEABLE_RESET));
+
+    #if COD2X_WIN32
+        InitializeCriticalSection(&logw.cs);
+        InitializeCriticalSection(&logw.io);
+    #else
+        pthread_mutex_init(&logw.cs, NULL);
+        pthread_mutex_init(&logw.io, NULL);
+    #endif
+
+    #if COD2X_WIN32
+        HANDLE thread = CreateThread(NULL, 0, log_writer_workerThread, NULL, 0, NULL);
+        if (!thread) return;
+        CloseHandle(thread);
+
+        HANDLE rotateThread = CreateThread(NULL, 0, log_writer_rotateThread, NULL, 0, NULL);
+        if (rotateThread)
+            CloseHandle(rotateThread);
+    #else
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, log_writer_workerThread, NULL) != 0) return;
+        pthread_detach(thread);
+
+        pthread_t rotateThread;
+        if (pthread_create(&rotateThread, NULL, log_writer_rotateThread, NULL) == 0)
+            pthread_detach(rotateThread);
+    #endif
+
+    logw.initialized = true;
+
+    Cmd_AddCommand("logWriterStatus", log_writer_cmd_status);
+    Cmd_AddCommand("logRotate", log_writer_cmd_rotate);
+}
+
+/** Called before the entry point is called. Used to patch the memory. */
+void log_writer_patch() {
+    patch_call(ADDR(0x004fcc0e, 0x08109ad5), (unsigned int)log_writer_FS_Write);          // G_LogPrintf
+    patch_call(ADDR(0x004fc83a, 0x08109523), (unsigned int)log_writer_FS_FCloseFile);     // G_ShutdownGame, closing games_mp.log
+    patch_call(ADDR(0x00431ea4, 0x08060dbb), (unsigned int)log_writer_FS_Write);          // Com_PrintMessage, console log
+    patch_call(ADDR(0x00431ebf, 0x08060dd3), (unsigned int)WL(log_writer_FS_ForceFlush_Win32, log_writer_FS_ForceFlush)); // Com_PrintMessage, console log when logfile is 2
+    patch_call(ADDR(0x004352da, 0x08062879), (unsigned int)log_writer_FS_FCloseFile);     // Com_Shutdown, closing console log
+    #if COD2X_WIN32
+        patch_call(0x0043274e, (unsigned int)log_writer_FS_FCloseFile);                   // Com_Quit_f, Com_Shutdown is inlined
+    #endif
+}
@@ -0,0 +1,11 @@
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include "server.h"
+
+void log_writer_flush();
+bool log_writer_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
+void log_writer_init();
+void log_writer_patch();
+
+#endif
@@ -2,52 +2,93 @@
 
 #include <string.h>
 #include <stdio.h>
-#include <time.h>
 #include <stdarg.h>
-#if _WIN32 == 1
-  #include <windows.h> // For CRITICAL_SECTION
-#else
-  #include <pthread.h>
-#endif
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+// Lock-free ring of variable-length records, any thread can write, readers never block writers.
+//
+// Writers reserve space by CAS on a cursor that packs the next sequence number and the next byte position,
+// so sequence numbers follow the order of records in the ring. The record is then written and published by
+// storing its tag (sequence + 1) into the record header and into the index slot of the sequence.
+//
+// Readers take records from the index and copy them without any lock. After the copy they check the cursor,
+// if writers have reserved space over the copied record in the meantime, the record is dropped as overwritten.
+
+#define LOG_BUFFER_SIZE  32768   // bytes of the ring, power of 2
+#define LOG_RECORD_ALIGN 16      // records start aligned, so the header is never split by the end of the ring
+
+typedef struct {
+    std::atomic<uint32_t> tag;   // sequence + 1 when the record is complete, 0 while written
+    uint32_t length;             // message length excluding NUL
+    int64_t  time;               // monotonic time in milliseconds
+} log_header_t;
+
+static_assert(sizeof(log_header_t) == LOG_RECORD_ALIGN, "log header must fill one alignment unit");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "logger requires lock-free 64-bit atomics");
 
 static struct {
-    size_t head;      // next write index
-    size_t count;     // number of valid entries (≤ LOG_CAPACITY)
-    time_t timestamps[LOG_CAPACITY];
-    char   messages[LOG_CAPACITY][LOG_MSG_LEN + 1];
-    #if _WIN32 == 1
-        CRITICAL_SECTION cs;
-    #else
-        pthread_mutex_t cs;
-    #endif
+    std::atomic<uint64_t> cursor;               // high 32 bits: next sequence, low 32 bits: next byte position
+    std::atomic<uint64_t> index[LOG_CAPACITY];  // high 32 bits: tag, low 32 bits: byte position of the record
+    alignas(LOG_RECORD_ALIGN) unsigned char buffer[LOG_BUFFER_SIZE];
 } lg;
 
+static inline uint64_t logger_pack(uint32_t high, uint32_t low) {
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline int64_t logger_time() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Copy data into the ring at position, wrapping around the end
+static void logger_write_bytes(uint32_t pos, const char* data, size_t len) {
+    size_t offset = pos & (LOG_BUFFER_SIZE - 1);
+    size_t first = len < LOG_BUFFER_SIZE - offset ? len : LOG_BUFFER_SIZE - offset;
+    memcpy(lg.buffer + offset, data, first);
+    memcpy(lg.buffer, data + first, len - first);
+}
+
+// Copy data from the ring at position, wrapping around the end
+static void logger_read_bytes(uint32_t pos, char* data, size_t len) {
+    size_t offset = pos & (LOG_BUFFER_SIZE - 1);
+    size_t first = len < LOG_BUFFER_SIZE - offset ? len : LOG_BUFFER_SIZE - offset;
+    memcpy(data, lg.buffer + offset, first);
+    memcpy(data + first, lg.buffer, len - first);
+}
+
 void logger_add(const char *fmt, ...) {
     char message[LOG_MSG_LEN + 1];
     va_list args;
     va_start(args, fmt);
-    vsnprintf(message, sizeof(message), fmt, args);
+    int len = vsnprintf(message, sizeof(message), fmt, args);
     va_end(args);
-
-    time_t now = time(NULL);
-
-    #if _WIN32 == 1
-        EnterCriticalSection(&lg.cs);
-    #else
-        pthread_mutex_lock(&lg.cs);
-    #endif
-
-    lg.timestamps[lg.head] = now;
-    strncpy(lg.messages[lg.head], message, LOG_MSG_LEN);
-    lg.messages[lg.head][LOG_MSG_LEN] = '\0';
-    lg.head = (lg.head + 1) % LOG_CAPACITY;
-    if (lg.count < LOG_CAPACITY) lg.count++;
-
-    #if _WIN32 == 1
-        LeaveCriticalSection(&lg.cs);
-    #else
-        pthread_mutex_unlock(&lg.cs);
-    #endif
+    if (len < 0) return;
+    if (len > LOG_MSG_LEN) len = LOG_MSG_LEN;
+
+    int64_t now = logger_time();
+    uint32_t size = (uint32_t)(sizeof(log_header_t) + len + LOG_RECORD_ALIGN - 1) & ~(uint32_t)(LOG_RECORD_ALIGN - 1);
+
+    // Reserve sequence number and space
+    uint64_t cursor = lg.cursor.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = logger_pack((uint32_t)(cursor >> 32) + 1, (uint32_t)cursor + size);
+    } while (!lg.cursor.compare_exchange_weak(cursor, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    uint32_t seq = (uint32_t)(cursor >> 32);
+    uint32_t pos = (uint32_t)cursor;
+
+    // Write the record, the tag is stored last so readers see only complete records
+    log_header_t* header = (log_header_t*)(lg.buffer + (pos & (LOG_BUFFER_SIZE - 1)));
+    header->tag.store(0, std::memory_order_relaxed);
+    header->length = (uint32_t)len;
+    header->time = now;
+    logger_write_bytes(pos + sizeof(log_header_t), message, len);
+    header->tag.store(seq + 1, std::memory_order_release);
+
+    lg.index[seq % LOG_CAPACITY].store(logger_pack(seq + 1, pos), std::memory_order_release);
 }
 
 size_t logger_get_recent(char *buffer, size_t max_chars) {
@@ -55,65 +96,59 @@ size_t logger_get_recent(char *buffer, size_t max_chars) {
     size_t written = 0;
     buffer[0] = '\0';
 
-    #if _WIN32 == 1
-        EnterCriticalSection(&lg.cs);
-    #else
-        pthread_mutex_lock(&lg.cs);
-    #endif
-
-    if (lg.count == 0) {
-        #if _WIN32 == 1
-                LeaveCriticalSection(&lg.cs);
-        #else
-                pthread_mutex_unlock(&lg.cs);
-        #endif
-        return 0;
-    }
-
-    ssize_t newest_idx = (ssize_t)lg.head - 1;
-    if (newest_idx < 0) newest_idx += LOG_CAPACITY;
-    time_t t0 = lg.timestamps[newest_idx];
-
-    ssize_t idx = newest_idx;
-    for (size_t n = 0; n < lg.count; n++) {
-        time_t t = lg.timestamps[idx];
-        long offset = (long)(t0 - t);
+    uint64_t cursor = lg.cursor.load(std::memory_order_acquire);
+    uint32_t end = (uint32_t)(cursor >> 32);
+    bool hasNewest = false;
+    int64_t t0 = 0;
+
+    // From the newest record to the oldest one
+    for (uint32_t n = 0; n < LOG_CAPACITY && n < end; n++) {
+        uint32_t seq = end - 1 - n;
+
+        uint64_t entry = lg.index[seq % LOG_CAPACITY].load(std::memory_order_acquire);
+        if ((uint32_t)(entry >> 32) != seq + 1)
+            continue; // not published yet, or the slot was reused by a newer record
+        uint32_t pos = (uint32_t)entry;
+
+        log_header_t* header = (log_header_t*)(lg.buffer + (pos & (LOG_BUFFER_SIZE - 1)));
+        if (header->tag.load(std::memory_order_acquire) != seq + 1)
+            continue;
+
+        uint32_t length = header->length;
+        int64_t time = header->time;
+        if (length > LOG_MSG_LEN)
+            continue;
+        char message[LOG_MSG_LEN + 1];
+        logger_read_bytes(pos + sizeof(log_header_t), message, length);
+        message[length] = '\0';
+
+        // Writers might have reserved this space while it was copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t reserved = (uint32_t)lg.cursor.load(std::memory_order_relaxed);
+        if (reserved - pos > LOG_BUFFER_SIZE)
+            break; // this and all older records are overwritten
+
+        if (!hasNewest) {
+            t0 = time;
+            hasNewest = true;
+        }
+        long offset = time < t0 ? (long)((t0 - time) / 1000) : 0; // timestamps of concurrent writers might be out of order
 
         char line[32 + LOG_MSG_LEN + 4];
-        int len = snprintf(line, sizeof(line), "%lds: %s\n", offset, lg.messages[idx]);
+        int len = snprintf(line, sizeof(line), "%lds: %s\n", offset, message);
         if (len < 0) break;
         if (written + (size_t)len > max_chars) break;
 
         memcpy(buffer + written, line, len);
         written += len;
         buffer[written] = '\0';
-
-        idx = (idx - 1 + LOG_CAPACITY) % LOG_CAPACITY;
     }
 
-    #if _WIN32 == 1
-        LeaveCriticalSection(&lg.cs);
-    #else
-        pthread_mutex_unlock(&lg.cs);
-    #endif
-
     return written;
 }
 
 void logger_init(void) {
-    lg.head  = 0;
-    lg.count = 0;
-    #if _WIN32 == 1
-        InitializeCriticalSection(&lg.cs);
-    #else
-        pthread_mutex_init(&lg.cs, NULL);
-    #endif
+    lg.cursor.store(0);
+    for (int i = 0; i < LOG_CAPACITY; i++)
+        lg.index[i].store(0);
 }
-
-void logger_destroy(void) {
-    #if _WIN32 == 1
-        DeleteCriticalSection(&lg.cs);
-    #else
-        pthread_mutex_destroy(&lg.cs);
-    #endif
-}
\ No newline at end of file
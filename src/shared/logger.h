@@ -2,21 +2,22 @@
 #define LOGGER_H
 
 #include <stddef.h>   // for size_t
-#include <time.h>     // for time_t
 
-#define LOG_CAPACITY  50      // max entries
+#define LOG_CAPACITY  50      // max entries returned by logger_get_recent
 #define LOG_MSG_LEN   512     // max chars per message (excl. NUL)
 
-// Add a message (truncated to LOG_MSG_LEN) with current timestamp.
+// Add a message (truncated to LOG_MSG_LEN) with current monotonic timestamp.
+// Lock-free, can be called from any thread.
 void logger_add(const char *fmt, ...);
 
 // Write up to max_chars of the most recent logs into buffer,
 // each line formatted as "<offset>s: message\n", where offset is
 // seconds since the newest log (newest is always “0s”).
+// Does not block writers, records overwritten while reading are skipped.
 // Returns number of chars written (excluding terminating NUL).
 size_t logger_get_recent(char *buffer, size_t max_chars);
 
-// Must call once before any logging.
+// Clear the log. Not thread-safe, call once before other threads start logging.
 void logger_init(void);
 
 #endif // LOGGER_H
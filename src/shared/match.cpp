@@ -1,6 +1,9 @@
 #include "match.h"
 
 #include <string>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
 
 #include "shared.h"
 #include "cod2_dvars.h"
@@ -11,45 +14,92 @@
 #include "cod2_server.h"
 #include "server.h"
 #include "json.h"
+#include "outbox.h"
+#include "json_writer.h"
+#include "match_journal.h"
 
 dvar_t *match_login; // Cvar to store match login hash
 Match match;
 
+// Writer shared by all match uploads, its buffer is reused so uploads dont allocate memory again
+JsonWriter match_json_writer(16 * 1024);
+
+// Write match progress value, numbers are written as JSON numbers
+void match_json_value(JsonWriter& json, const MatchValue& value) {
+    char buf[32];
+    if (value.type == MatchValue::STRING)
+        json.string(value.stringValue);
+    else if (value.type == MatchValue::FLOAT && !std::isfinite(value.floatValue))
+        json.raw("null");
+    else
+        json.raw(value.c_str(buf, sizeof(buf)));
+}
+
 // TODO secure vypsani uuid, aby neslo zneuzit
-std::string match_create_json_data()
+// Returned string is valid until next call of match_create_json_data or match_upload_error
+const std::string& match_create_json_data()
 {
-    std::string json;
-    json += "{\n";
-    json += "  \"type\": \"data\",\n";
+    JsonWriter& json = match_json_writer;
+    json.clear();
+    json.raw("{\n");
+    json.raw("  \"type\": \"data\",\n");
 
     char buf[32];
     time_to_iso8601(match.start_time, buf, sizeof(buf));
-    json += "  \"start_time\": \"" + std::string(buf) + "\",\n";
+    json.raw("  \"start_time\": \"").raw(buf).raw("\",\n");
 
     // Print globalData as individual JSON items
-    for (const auto& key : match.progressData.globalData.keys()) {
-        json += "  \"" + json_escape_string(key) + "\": \"" + json_escape_string(match.progressData.globalData.at(key)) + "\",\n";
+    for (const auto& item : match.progressData.globalData) {
+        json.raw("  ").string(item.key).raw(": ");
+        match_json_value(json, item.value);
+        json.raw(",\n");
     }
 
     // Print player data as an array
-    json += "  \"players\": [\n";
+    json.raw("  \"players\": [\n");
     bool firstPlayer = true;
-    for (const auto& key : match.progressData.playerData.keys()) {
-        if (!firstPlayer) json += ",\n";
+    for (const auto& player : match.progressData.playerData) {
+        if (!firstPlayer) json.raw(",\n");
         firstPlayer = false;
-        json += "    {\n";
+        json.raw("    {\n");
         bool firstField = true;
-        for (const auto& player_key : match.progressData.playerData.at(key).keys()) {
-            if (!firstField) json += ",\n";
+        for (const auto& field : player.value) {
+            if (!firstField) json.raw(",\n");
             firstField = false;
-            json += "      \"" + json_escape_string(player_key) + "\": \"" + json_escape_string(match.progressData.playerData.at(key).at(player_key)) + "\"";
+            json.raw("      ").string(field.key).raw(": ");
+            match_json_value(json, field.value);
         }
-        json += "\n    }";
+        json.raw("\n    }");
     }
-    json += "\n  ]\n";
-    json += "}\n";
+    json.raw("\n  ]\n");
+    json.raw("}\n");
 
-    return json;
+    return json.str();
+}
+
+
+
+// Save the upload to the outbox, it will be retried by the outbox worker in the background
+// Match data are full snapshot, so only the newest one is kept in the outbox
+void match_upload_to_outbox(const std::string& json, bool isMatchData) {
+    if (json.empty())
+        return;
+
+    std::string headers;
+    if (match.httpClient) {
+        for (const auto& h : match.httpClient->headers) {
+            headers += h;
+            headers += "\r\n";
+        }
+    }
+    headers += "Content-Type: application/json";
+
+    outbox_add("POST", match.url, headers, json, isMatchData ? va("match_data %s", match.url) : nullptr);
+}
+
+// Returns true if the failed upload should be retried, false if the server rejected the data
+bool match_upload_is_retryable(int status) {
+    return status == 0 || status == 408 || status == 429 || status >= 500;
 }
 
 
@@ -66,29 +116,38 @@ bool match_upload_match_data(std::function<void()> onDone, std::function<void(co
     }
 
     // Create JSON data
-    std::string json_data = match_create_json_data();
-    if (json_data.empty()) {
+    match.uploadingData = match_create_json_data();
+    if (match.uploadingData.empty()) {
         Com_Printf("Failed to create JSON data for match upload.\n");
         return false;
     }
 
     match.uploading = true;
 
-    match.httpClient->postJson(match.url, json_data.c_str(),
+    match.httpClient->postJson(match.url, match.uploadingData.c_str(),
         [onError, onDone](const HttpClient::Response& res) {
             match.uploading = false;
             if (res.status != 200 && res.status != 201) {
                 Com_Printf("Match uploading error, invalid status: %d\n%s\n", res.status, res.body.c_str());
+                if (match_upload_is_retryable(res.status))
+                    match_upload_to_outbox(match.uploadingData, true);
+                match.uploadingData.clear();
                 if (onError) onError("Invalid status: " + std::to_string(res.status));
                 return;
             }
             //Com_Printf("Match upload succeeded: %s\n", res.body.c_str());
 
+            // Older snapshot waiting in the outbox is no longer needed
+            outbox_remove(va("match_data %s", match.url));
+            match.uploadingData.clear();
+
             if (onDone) onDone();
         },
         [onError](const std::string& error) {
             match.uploading = false;
-            Com_Printf("Match uploading error: %s\n", error.c_str());
+            Com_Printf("Match uploading error: %s, will be retried in the background\n", error.c_str());
+            match_upload_to_outbox(match.uploadingData, true);
+            match.uploadingData.clear();
             if (onError) onError(error);
         }
     );
@@ -112,28 +171,34 @@ bool match_upload_error(const char* error, const char* errorMessage) {
     }
 
     // Create JSON data
-    std::string json;
-    json += "{\n";
-    json += "  \"type\": \"error\",\n";
-    json += "  \"error\": \"" + json_escape_string(error) + "\",\n";
-    json += "  \"errorMessage\": \"" + json_escape_string(errorMessage) + "\"\n";
-    json += "}\n";
+    JsonWriter& json = match_json_writer;
+    json.clear();
+    json.raw("{\n");
+    json.raw("  \"type\": \"error\",\n");
+    json.raw("  \"error\": ").string(error).raw(",\n");
+    json.raw("  \"errorMessage\": ").string(errorMessage).raw("\n");
+    json.raw("}\n");
 
     match.uploadingError = true;
+    match.uploadingErrorData = json.str();
 
     // Send POST request to URL
-    match.httpClient->postJson(match.url, json.c_str(),
+    match.httpClient->postJson(match.url, match.uploadingErrorData.c_str(),
         [](const HttpClient::Response& res) {
             match.uploadingError = false;
             if (res.status != 200 && res.status != 201) {
                 Com_Printf("Match error uploading failed, invalid status: %d\n%s\n", res.status, res.body.c_str());
-                return;
+                if (match_upload_is_retryable(res.status))
+                    match_upload_to_outbox(match.uploadingErrorData, false);
             }
             //Com_Printf("Match error uploading succeeded: %s\n", res.body.c_str());
+            match.uploadingErrorData.clear();
         },
         [](const std::string& error) {
             match.uploadingError = false;
-            Com_Printf("Match error uploading failed: %s\n", error.c_str());
+            Com_Printf("Match error uploading failed: %s, will be retried in the background\n", error.c_str());
+            match_upload_to_outbox(match.uploadingErrorData, false);
+            match.uploadingErrorData.clear();
         }
     );
 
@@ -149,36 +214,75 @@ MatchPlayer* match_find_player_by_uuid(const char* uuid)
 {
     if (!uuid || uuid[0] == '\0') return nullptr;
 
-    for (int j = 0; j < match.data.team1.num_players; j++) {
-        if (strcmp(match.data.team1.players[j].id, uuid) == 0) {
-            return &match.data.team1.players[j];
-        }
-    }
-    for (int j = 0; j < match.data.team2.num_players; j++) {
-        if (strcmp(match.data.team2.players[j].id, uuid) == 0) {
-            return &match.data.team2.players[j];
+    MatchPlayer** player = match.players.find(uuid);
+    return player ? *player : nullptr;
+}
+
+// Must be called every time match.data is changed, rebuilds the player index and invalidates cached client identities
+void match_data_changed()
+{
+    match.players.clear();
+    MatchTeam* teams[] = { &match.data.team1, &match.data.team2 };
+    for (MatchTeam* team : teams) {
+        for (int j = 0; j < team->num_players; j++) {
+            if (!match.players.contains(team->players[j].id)) // first player with the uuid is used
+                match.players[team->players[j].id] = &team->players[j];
         }
     }
-    return nullptr;
+    match.dataVersion++;
 }
 
 
+MatchClientIdentity match_clients[MAX_CLIENTS];
 
-// Parses match data from a JSON string and fills the match.data struct.
-// Returns true on success, false on failure.
-bool match_parse_json_match_data(const char* json_str, MatchData* match_data) {
-    if (!json_str || json_str[0] == '\0') return false;
+// Called when client connects or changes userinfo
+void match_client_changed(int clientNum)
+{
+    if (clientNum >= 0 && clientNum < MAX_CLIENTS)
+        match_clients[clientNum].valid = false;
+}
 
-    match_data->json = json_str;
+// Returns match identity of the client, resolved from userinfo only when it changed
+MatchClientIdentity* match_get_client_identity(int clientNum)
+{
+    MatchClientIdentity* identity = &match_clients[clientNum];
+    client_t* client = &svs_clients[clientNum];
+
+    if (identity->valid && identity->dataVersion == match.dataVersion && identity->guid == client->guid)
+        return identity;
+
+    const char* uuid = Info_ValueForKey(client->userinfo, "match_login");
+    Q_strncpyz(identity->uuid, uuid, sizeof(identity->uuid));
+    identity->player = match_find_player_by_uuid(uuid);
+
+    // If UUID is set and is valid, use UUID
+    // If UUID is empty or not within team, user player's guid as identification, if guid is empty, use name as fallback
+    if (identity->player != nullptr)
+        snprintf(identity->key, sizeof(identity->key), "UUID_%s", uuid);
+    else if (client->guid != 0)
+        snprintf(identity->key, sizeof(identity->key), "GUID_%i", client->guid);
+    else
+        snprintf(identity->key, sizeof(identity->key), "NAME_%s", client->name);
+
+    identity->guid = client->guid;
+    identity->dataVersion = match.dataVersion;
+    identity->valid = true;
+    return identity;
+}
+
+
+
+// Fills match.data struct from parsed JSON document.
+static bool match_parse_json_match_data_root(const cJSON* root, MatchData* match_data) {
 
     // matchId
-    if (!json_get_str(json_str, "$.matchId", match_data->match_id, MAX_ID_LENGTH) || match_data->match_id[0] == '\0') {
+    if (!json_item_get_str(cJSON_GetObjectItemCaseSensitive(root, "matchId"), match_data->match_id, MAX_ID_LENGTH) || match_data->match_id[0] == '\0') {
         match_data->error = "Invalid matchId '" + std::string(match_data->match_id) + "'";
         return false;
     }
 
     // format
-    /*if (!json_get_str(json_str, "$.format", match_data->format, sizeof(match_data->format))) {
+    /*if (!json_item_get_str(cJSON_GetObjectItemCaseSensitive(root, "format"), match_data->format, sizeof(match_data->format))) {
         match_data->error = "Invalid format";
         return false;
     }
@@ -189,38 +293,30 @@ bool match_parse_json_match_data(const char* json_str, MatchData* match_data) {
 
     // maps
     int map_count = 0;
-    if (!json_iter_array(json_str, "$.maps", [&](int idx, const char* val, int len) {
-        if (len <= 0) {
+    int idx = 0;
+    const cJSON* map;
+    cJSON_ArrayForEach(map, cJSON_GetObjectItemCaseSensitive(root, "maps")) {
+        char mapName[MAX_MAP_NAME_LENGTH + 1] = {};
+        if (!json_item_get_str(map, mapName, sizeof(mapName)) || mapName[0] == '\0') {
             match_data->error = "Map name is empty on index " + std::to_string(idx);
             return false;
         }
-        const char* inner = val;
-        int innerLen = len;
-        if (innerLen >= 2 && inner[0] == '"' && inner[innerLen - 1] == '"') {
-            inner += 1;
-            innerLen -= 2;
-        }
-        if (innerLen <= 0 || innerLen >= MAX_MAP_NAME_LENGTH) {
+        if (strlen(mapName) >= MAX_MAP_NAME_LENGTH) {
             match_data->error = "Invalid map name length on index " + std::to_string(idx);
             return false;
         }
-        memcpy(match_data->maps[map_count], inner, static_cast<size_t>(innerLen));
-        match_data->maps[map_count][innerLen] = '\0';
+        if (map_count >= MAX_MAPS) {
+            match_data->error = "Too many maps (max " STRINGIFY(MAX_MAPS) ")";
+            return false;
+        }
+        strcpy(match_data->maps[map_count], mapName);
         map_count++;
 
-        const char* mapName = match_data->maps[map_count - 1];
         if (!SV_MapExists(mapName)) {
             match_data->error = "Map '" + std::string(mapName) + "' does not exist on the server";
             return false;
         }
-
-        if (map_count > MAX_MAPS) {
-            match_data->error = "Too many maps (max " STRINGIFY(MAX_MAPS) ")";
-            return false;
-        }
-        return true;
-    })) {
-        return false;
+        idx++;
     }
     match_data->maps_count = map_count;
 
@@ -239,44 +335,44 @@ bool match_parse_json_match_data(const char* json_str, MatchData* match_data) {
 
     // Helper for teams
     auto fill_team = [&](int teamNumber, MatchTeam* team) -> bool {
-        char path[64];
+        const cJSON* teamObj = cJSON_GetObjectItemCaseSensitive(root, teamNumber == 1 ? "team1" : "team2");
+
         // id
-        snprintf(path, sizeof(path), "$.team%i.id", teamNumber);
-        if (!json_get_str(json_str, path, team->id, MAX_ID_LENGTH) || team->id[0] == '\0') {
+        if (!json_item_get_str(cJSON_GetObjectItemCaseSensitive(teamObj, "id"), team->id, MAX_ID_LENGTH) || team->id[0] == '\0') {
             match_data->error = "Invalid team id";
             return false;
         }
 
         // name
-        snprintf(path, sizeof(path), "$.team%i.name", teamNumber);
-        if (!json_get_str(json_str, path, team->name, MAX_NAME_LENGTH) || team->name[0] == '\0') {
+        if (!json_item_get_str(cJSON_GetObjectItemCaseSensitive(teamObj, "name"), team->name, MAX_NAME_LENGTH) || team->name[0] == '\0') {
             match_data->error = "Invalid team name";
             return false;
         }
 
         // tag, can be null
-        snprintf(path, sizeof(path), "$.team%i.tag", teamNumber);
-        json_get_str(json_str, path, team->tag, MAX_NAME_LENGTH);
+        json_item_get_str(cJSON_GetObjectItemCaseSensitive(teamObj, "tag"), team->tag, MAX_NAME_LENGTH);
 
         // players
-        snprintf(path, sizeof(path), "$.team%i.players", teamNumber);
         team->num_players = 0;
-        if (!json_iter_array(json_str, path, [&](int idx, const char* val, int len) {
+        int idx = 0;
+        const cJSON* playerObj;
+        cJSON_ArrayForEach(playerObj, cJSON_GetObjectItemCaseSensitive(teamObj, "players")) {
+            MatchPlayer* player = &team->players[team->num_players];
 
             // Fill team number for player for easy access
-            team->players[team->num_players].teamNumber = teamNumber;
+            player->teamNumber = teamNumber;
 
             // Fill team name for player for easy access
-            strncpy(team->players[team->num_players].teamName, team->name, MAX_NAME_LENGTH);
-            team->players[team->num_players].teamName[MAX_NAME_LENGTH - 1] = '\0';
+            strncpy(player->teamName, team->name, MAX_NAME_LENGTH);
+            player->teamName[MAX_NAME_LENGTH - 1] = '\0';
 
             // player id
-            if (!json_get_str(val, "$.uuid", team->players[team->num_players].id, MAX_ID_LENGTH)) {
+            if (!json_item_get_str(cJSON_GetObjectItemCaseSensitive(playerObj, "uuid"), player->id, MAX_ID_LENGTH)) {
                 match_data->error = "Invalid player id in team " + std::to_string(teamNumber) + " on index " + std::to_string(idx);
                 return false;
             }
             // player name
-            if (!json_get_str(val, "$.name", team->players[team->num_players].name, MAX_NAME_LENGTH)) {
+            if (!json_item_get_str(cJSON_GetObjectItemCaseSensitive(playerObj, "name"), player->name, MAX_NAME_LENGTH)) {
                 match_data->error = "Invalid player name in team " + std::to_string(teamNumber) + " on index " + std::to_string(idx);
                 return false;
             }
@@ -285,9 +381,7 @@ bool match_parse_json_match_data(const char* json_str, MatchData* match_data) {
                 match_data->error = "Too many players in team " + std::to_string(teamNumber) + " (max " STRINGIFY(MAX_TEAM_PLAYERS) ")";
                 return false;
             }
-            return true;
-        })) {
-            return false;
+            idx++;
         }
         if (team->num_players <= 0) {
             match_data->error = "Team " + std::to_string(teamNumber) + " has no players";
@@ -304,11 +398,242 @@ bool match_parse_json_match_data(const char* json_str, MatchData* match_data) {
 }
 
 
+// Parses match data from a JSON string and fills the match.data struct.
+// Returns true on success, false on failure.
+bool match_parse_json_match_data(const char* json_str, MatchData* match_data) {
+    if (!json_str || json_str[0] == '\0') return false;
+
+    match_data->json = json_str;
+
+    // Parse the document once, all fields are then read from the parsed tree
+    cJSON* root = cJSON_Parse(json_str);
+    if (root == nullptr) {
+        match_data->error = "Invalid JSON";
+        return false;
+    }
+    bool ok = match_parse_json_match_data_root(root, match_data);
+    cJSON_Delete(root);
+    return ok;
+}
+
+
+#if DEBUG
+// Previous implementation that reads every field by its path, each lookup scans the document from the start
+// Kept only to compare the speed in matchParseBench
+static bool match_parse_json_match_data_paths(const char* json_str, MatchData* match_data) {
+    if (!json_get_str(json_str, "$.matchId", match_data->match_id, MAX_ID_LENGTH) || match_data->match_id[0] == '\0')
+        return false;
+
+    int map_count = 0;
+    json_iter_array(json_str, "$.maps", [&](int idx, const char* val, int len) {
+        if (len < 2 || len - 2 >= MAX_MAP_NAME_LENGTH || map_count >= MAX_MAPS) return false;
+        memcpy(match_data->maps[map_count], val + 1, len - 2);
+        match_data->maps[map_count][len - 2] = '\0';
+        return SV_MapExists(match_data->maps[map_count++]) != 0;
+    });
+    match_data->maps_count = map_count;
+
+    for (int teamNumber = 1; teamNumber <= 2; teamNumber++) {
+        MatchTeam* team = teamNumber == 1 ? &match_data->team1 : &match_data->team2;
+        char path[64];
+        snprintf(path, sizeof(path), "$.team%i.id", teamNumber);
+        json_get_str(json_str, path, team->id, MAX_ID_LENGTH);
+        snprintf(path, sizeof(path), "$.team%i.name", teamNumber);
+        json_get_str(json_str, path, team->name, MAX_NAME_LENGTH);
+        snprintf(path, sizeof(path), "$.team%i.tag", teamNumber);
+        json_get_str(json_str, path, team->tag, MAX_NAME_LENGTH);
+        snprintf(path, sizeof(path), "$.team%i.players", teamNumber);
+        team->num_players = 0;
+        json_iter_array(json_str, path, [&](int idx, const char* val, int len) {
+            if (team->num_players >= MAX_TEAM_PLAYERS - 1) return false;
+            json_get_str(val, "$.uuid", team->players[team->num_players].id, MAX_ID_LENGTH);
+            json_get_str(val, "$.name", team->players[team->num_players].name, MAX_NAME_LENGTH);
+            team->num_players++;
+            return true;
+        });
+    }
+    return true;
+}
+
+/**
+ * Compare the speed of path based parsing and single pass parsing of match data.
+ * USAGE: matchParseBench [playersPerTeam] [paddingBytes] [iterations]
+ *  - paddingBytes is size of extra data per player to simulate large documents
+ */
+void match_cmd_parseBench() {
+    int players = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : MAX_TEAM_PLAYERS - 1;
+    int padding = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 256;
+    int iterations = Cmd_Argc() > 3 ? atoi(Cmd_Argv(3)) : 1000;
+    if (players < 1 || players >= MAX_TEAM_PLAYERS || padding < 0 || iterations < 1) {
+        Com_Printf("USAGE: matchParseBench [playersPerTeam 1-%i] [paddingBytes] [iterations]\n", MAX_TEAM_PLAYERS - 1);
+        return;
+    }
+
+    // Build the document
+    std::string pad(padding, 'x');
+    std::string json = "{\"matchId\":\"bench\",\"format\":\"BO1\",\"maps\":[\"mp_toujane\"]";
+    for (int t = 1; t <= 2; t++) {
+        json += ",\"team" + std::to_string(t) + "\":{\"id\":\"t" + std::to_string(t) + "\",\"name\":\"Team " + std::to_string(t) + "\",\"tag\":null,\"players\":[";
+        for (int p = 0; p < players; p++) {
+            if (p > 0) json += ",";
+            json += "{\"uuid\":\"" + std::to_string(t * 1000 + p) + "\",\"name\":\"Player " + std::to_string(p) + "\",\"stats\":\"" + pad + "\"}";
+        }
+        json += "]}";
+    }
+    json += "}";
+
+    MatchData* data = new MatchData();
+    bool ok = match_parse_json_match_data(json.c_str(), data);
+    if (!ok) {
+        Com_Printf("matchParseBench: failed to parse the document: %s\n", data->error.c_str());
+        delete data;
+        return;
+    }
+
+    uint64_t start = ticks_ms();
+    for (int i = 0; i < iterations; i++) {
+        *data = MatchData{};
+        match_parse_json_match_data_paths(json.c_str(), data);
+    }
+    uint64_t pathsMs = ticks_ms() - start;
+
+    start = ticks_ms();
+    for (int i = 0; i < iterations; i++) {
+        *data = MatchData{};
+        match_parse_json_match_data(json.c_str(), data);
+    }
+    uint64_t singlePassMs = ticks_ms() - start;
+
+    delete data;
+
+    Com_Printf("matchParseBench: %i players per team, %u bytes document, %i iterations\n", players, (unsigned)json.size(), iterations);
+    Com_Printf("  path lookups: %8.3f ms per parse\n", (double)pathsMs / iterations);
+    Com_Printf("  single pass:  %8.3f ms per parse\n", (double)singlePassMs / iterations);
+}
+
+// Previous implementation of ordered_map, kept only to compare the speed in matchDataBench
+template <typename K, typename V>
+class ordered_map_legacy {
+    std::unordered_map<K, V> m_map;
+    std::vector<K> m_order;
+public:
+    V& operator[](const K& key) {
+        auto [it, inserted] = m_map.emplace(key, V{});
+        if (inserted) m_order.push_back(key);
+        return it->second;
+    }
+    bool contains(const K& key) const { return m_map.find(key) != m_map.end(); }
+    bool erase(const K& key) {
+        auto it = m_map.find(key);
+        if (it == m_map.end()) return false;
+        m_map.erase(it);
+        m_order.erase(std::remove(m_order.begin(), m_order.end(), key), m_order.end());
+        return true;
+    }
+    const V& at(const K& key) const { return m_map.at(key); }
+    const std::vector<K>& keys() const { return m_order; }
+};
+
+// Same work as gsc_match_playerGetSetData does for each player, with the previous usage of the map
+template <typename PlayerMap>
+static size_t match_dataBench_legacy(PlayerMap& players, int playerCount, int fieldCount, const std::vector<std::string>& playerKeys, const std::vector<std::string>& fieldKeys) {
+    size_t total = 0;
+    for (int p = 0; p < playerCount; p++) {
+        const char* key = playerKeys[p].c_str();
+        bool isNew = !players.contains(key);
+        players[key]["key"] = key;
+        players[key]["uuid"] = key;
+        if (isNew) players[key]["first_time"] = "2025-01-01T20:00:00.000Z";
+        players[key]["name"] = "Player";
+        players[key]["team"] = "team1";
+        players[key]["team_name"] = "Team 1";
+        players[key].erase("debug");
+        for (int f = 0; f < fieldCount; f++) {
+            players[key][fieldKeys[f].c_str()] = "123";
+            if (players.contains(key) && players[key].contains(fieldKeys[f].c_str()))
+                total += players[key][fieldKeys[f].c_str()].size();
+        }
+    }
+    for (const auto& key : players.keys())
+        for (const auto& field : players.at(key).keys())
+            total += field.size() + players.at(key).at(field).size();
+    return total;
+}
+
+template <typename PlayerMap>
+static size_t match_dataBench_flat(PlayerMap& players, int playerCount, int fieldCount, const std::vector<std::string>& playerKeys, const std::vector<std::string>& fieldKeys) {
+    size_t total = 0;
+    for (int p = 0; p < playerCount; p++) {
+        const char* key = playerKeys[p].c_str();
+        bool isNew = !players.contains(key);
+        auto& player = players[key];
+        player["key"] = key;
+        player["uuid"] = key;
+        if (isNew) player["first_time"] = "2025-01-01T20:00:00.000Z";
+        player["name"] = "Player";
+        player["team"] = "team1";
+        player["team_name"] = "Team 1";
+        player.erase("debug");
+        for (int f = 0; f < fieldCount; f++) {
+            player[fieldKeys[f].c_str()] = "123";
+            const std::string* value = player.find(fieldKeys[f].c_str());
+            if (value) total += value->size();
+        }
+    }
+    for (const auto& player : players)
+        for (const auto& field : player.value)
+            total += field.key.size() + field.value.size();
+    return total;
+}
+
+/**
+ * Compare the speed of the previous and current ordered_map on match progress data.
+ * Each iteration sets and gets all fields of all players like the scripts do and then iterates the data like the upload does.
+ * USAGE: matchDataBench [players] [fields] [iterations]
+ */
+void match_cmd_dataBench() {
+    int players = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 20;
+    int fields = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 30;
+    int iterations = Cmd_Argc() > 3 ? atoi(Cmd_Argv(3)) : 1000;
+    if (players < 1 || fields < 1 || iterations < 1) {
+        Com_Printf("USAGE: matchDataBench [players] [fields] [iterations]\n");
+        return;
+    }
+
+    std::vector<std::string> playerKeys, fieldKeys;
+    for (int p = 0; p < players; p++)
+        playerKeys.push_back("UUID_" + std::to_string(7000000 + p * 7919));
+    const char* names[] = {"kills", "deaths", "assists", "damage", "headshots", "grenade_kills", "knife_kills", "plants", "defuses", "score"};
+    for (int f = 0; f < fields; f++)
+        fieldKeys.push_back(f < 10 ? names[f] : "round_stat_" + std::to_string(f));
+
+    ordered_map_legacy<std::string, ordered_map_legacy<std::string, std::string>> legacy;
+    ordered_map<std::string, ordered_map<std::string, std::string>> flat;
+
+    uint64_t start = ticks_ms();
+    size_t legacyTotal = 0;
+    for (int i = 0; i < iterations; i++)
+        legacyTotal += match_dataBench_legacy(legacy, players, fields, playerKeys, fieldKeys);
+    uint64_t legacyMs = ticks_ms() - start;
+
+    start = ticks_ms();
+    size_t flatTotal = 0;
+    for (int i = 0; i < iterations; i++)
+        flatTotal += match_dataBench_flat(flat, players, fields, playerKeys, fieldKeys);
+    uint64_t flatMs = ticks_ms() - start;
+
+    Com_Printf("matchDataBench: %i players, %i fields, %i iterations%s\n", players, fields, iterations, legacyTotal == flatTotal ? "" : ", RESULTS DIFFER");
+    Com_Printf("  unordered_map + key vector: %8.4f ms per iteration\n", (double)legacyMs / iterations);
+    Com_Printf("  flat ordered_map:           %8.4f ms per iteration\n", (double)flatMs / iterations);
+}
+#endif
+
+
 /**
  * Update match data by downloading it from the server again.
  * This is useful when host-players are added to match while the match is already in progress.
  */
-bool match_redownload() {
+bool match_redownload(std::function<void()> onDone, std::function<void(const std::string&)> onError) {
 
     // Theres nothing to update
     if (!match.activated) {
@@ -317,10 +642,11 @@ bool match_redownload() {
 
     match.httpClient->get(
         match.url,
-        [](const HttpClient::Response& res) {
+        [onDone, onError](const HttpClient::Response& res) {
 
             if (res.status != 200 && res.status != 201) {
                 Com_Printf("Match redownloading error, invalid status of downloading data: %d\n%s\n", res.status, res.body.c_str());
+                if (onError) onError("Invalid status: " + std::to_string(res.status));
                 return;
             }
             //Com_Printf("GET succeeded: %s\n", res.body.c_str());
@@ -331,6 +657,7 @@ bool match_redownload() {
             if (!status) {
                 Com_Printf("Match redownloading error, failed to parse match data:\n%s\n%s\n", res.body.c_str(), matchData.error.c_str());
                 match_upload_error("Failed to parse match data", matchData.error.c_str());
+                if (onError) onError("Failed to parse match data");
                 return;
             }
 
@@ -338,25 +665,31 @@ bool match_redownload() {
             // Validate if match id and maps are the same
             if (strcmp(match.data.match_id, matchData.match_id) != 0) {
                 Com_Printf("Match redownloading error, match id does not match: %s != %s\n", match.data.match_id, matchData.match_id);
+                if (onError) onError("Match data does not match");
                 return;
             }
             if (match.data.maps_count != matchData.maps_count) {
                 Com_Printf("Match redownloading error, number of maps does not match: %d != %d\n", match.data.maps_count, matchData.maps_count);
+                if (onError) onError("Match data does not match");
                 return;
             }
             for (int i = 0; i < match.data.maps_count; i++) {
                 if (strcmp(match.data.maps[i], matchData.maps[i]) != 0) {
                     Com_Printf("Match redownloading error, map %d does not match: %s != %s\n", i, match.data.maps[i], matchData.maps[i]);
+                    if (onError) onError("Match data does not match");
                     return;
                 }
             }
 
             // Update match data with new data
             match.data = matchData;
+            match_data_changed();
 
+            if (onDone) onDone();
         },
-        [](const std::string& error) {
+        [onError](const std::string& error) {
             Com_Printf("Match redownloading error while downloading data: %s\n", error.c_str());
+            if (onError) onError(error);
         }
     );
 
@@ -436,6 +769,7 @@ void match_cmd() {
         // TODO když dám znovu create a skončí to chybou, nastane chyba skriptu
 
         match.data = MatchData{};
+        match_data_changed();
         snprintf(match.url, sizeof(match.url), "%s", endpoint);
         match.downloading = true;
         match.loading = false;
@@ -488,6 +822,7 @@ void match_cmd() {
 
                 match.data = MatchData{};
                 bool status = match_parse_json_match_data(res.body.c_str(), &match.data);
+                match_data_changed();
                 if (!status) {
                     Com_Printf("Match creating error, failed to parse match data:\n%s\n%s\n", res.body.c_str(), match.data.error.c_str());
                     match_upload_error("Failed to parse match data", match.data.error.c_str());
@@ -497,6 +832,13 @@ void match_cmd() {
 
                 Com_Printf("Match data downloaded successfully, loading first map...\n");
 
+                // Restore progress data saved before the server crashed or was killed
+                // Send them to the server right away, scripts might clear the data when the match starts again
+                if (match_journal_open(match.data.match_id, match.url, &match.progressData)) {
+                    Com_Printf("Match progress data restored from journal (%u players)\n", (unsigned)match.progressData.playerData.size());
+                    match_upload_to_outbox(match_create_json_data(), true);
+                }
+
                 // Build sv_maprotation string from match.data.maps
                 std::string maprotation;
                 for (int i = 0; i < match.data.maps_count; ++i) {
@@ -533,7 +875,7 @@ void match_cmd() {
         } else if (!match.activated) {
             Com_Printf("No match is currently active.\n");
         } else {
-            auto progressData = match_create_json_data();
+            const std::string& progressData = match_create_json_data();
 
             Com_Printf("Match is currently active.\n");
             Com_Printf("URL: %s\n", match.url);
@@ -642,15 +984,27 @@ bool match_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdo
         match_upload_error("Server shutdown error", com_last_error);
     }
 
+    // Save the current state to the journal as one snapshot
+    if (match.activated && !match.canceling && !shutdown) {
+        match_journal_compact(match.progressData);
+    }
+
     // Canceling because of finished match, /match cancel or server shutdown
     // GSC script had time to complete the score and upload the final results, so we just cancel
     if (match.canceling || shutdown) {
 
-        if (shutdown && (match.uploading || match.uploadingError)) {
-            // Since server is shutting down, Com_Frame is not called, so we need to poll here to process the pending match data upload
-            for(int i = 0; i < 10 && (match.uploading || match.uploadingError); i++) {
-                match.httpClient->poll(100);
-            }
+        // Journal is kept on shutdown to restore the data after restart
+        match_journal_close(!shutdown);
+
+        if (shutdown) {
+            // Since server is shutting down, Com_Frame is not called and pending uploads would be lost
+            // Dont wait for them, save them to the outbox, they will be sent in the background or after restart
+            if (match.uploading)
+                match_upload_to_outbox(match.uploadingData, true);
+            if (match.uploadingError)
+                match_upload_to_outbox(match.uploadingErrorData, false);
+            match.uploadingData.clear();
+            match.uploadingErrorData.clear();
         }
         
         if (match.canceling)
@@ -699,7 +1053,12 @@ void match_init_client() {
 void match_init() {
     Cmd_AddCommand("match", match_cmd); 
 
+    match_journal_init();
+
     #if DEBUG
+    Cmd_AddCommand("matchParseBench", match_cmd_parseBench);
+    Cmd_AddCommand("matchDataBench", match_cmd_dataBench);
+
     if (dedicated->value.integer > 0) {
         for (int i = 0; i < 20; i++) {
             Com_Printf("                                        \n");
@@ -4,12 +4,12 @@
 #include <map>
 #include <string>
 #include <vector>
-#include <algorithm>
-#include <unordered_map>
 
 #include "cod2_server.h"
 #include "http_client.h"
 #include "server.h"
+#include "ordered_map.h"
+#include "json_writer.h"
 
 #define MAX_TEAM_PLAYERS (MAX_CLIENTS / 2)
 #define MAX_ID_LENGTH 64
@@ -18,52 +18,44 @@
 #define MAX_MAPS 5
 
 
-template <typename K, typename V>
-class ordered_map {
-    std::unordered_map<K, V> m_map;
-    std::vector<K> m_order;
+// Value of match progress data
+// Numbers set from script are kept as numbers, so counters can be incremented without converting them to string and back
+struct MatchValue {
+    enum Type { STRING, INT, FLOAT };
 
-public:
-    // Insert or update
-    V& operator[](const K& key) {
-        auto [it, inserted] = m_map.emplace(key, V{});
-        if (inserted) {
-            m_order.push_back(key); // remember insertion order
-        }
-        return it->second;
-    }
+    Type type = STRING;
+    int intValue = 0;
+    float floatValue = 0;
+    std::string stringValue;
 
-    bool contains(const K& key) const {
-        return m_map.find(key) != m_map.end();
-    }
+    MatchValue& operator=(const char* value) { type = STRING; stringValue = value; return *this; }
+    MatchValue& operator=(const std::string& value) { type = STRING; stringValue = value; return *this; }
+    MatchValue& operator=(int value) { type = INT; intValue = value; stringValue.clear(); return *this; }
+    MatchValue& operator=(float value) { type = FLOAT; floatValue = value; stringValue.clear(); return *this; }
 
-    bool erase(const K& key) {
-        auto it = m_map.find(key);
-        if (it == m_map.end()) return false;
-        m_map.erase(it);
-        m_order.erase(std::remove(m_order.begin(), m_order.end(), key), m_order.end());
-        return true;
+    bool operator==(const MatchValue& other) const {
+        if (type != other.type) return false;
+        if (type == INT)   return intValue == other.intValue;
+        if (type == FLOAT) return floatValue == other.floatValue;
+        return stringValue == other.stringValue;
     }
 
-    V& at(const K& key) { return m_map.at(key); }
-    const V& at(const K& key) const { return m_map.at(key); }
-    const std::vector<K>& keys() const { return m_order; }
-
-    void clear() {
-        m_map.clear();
-        m_order.clear();
+    // Returns value as text, buffer is used for numbers
+    const char* c_str(char* buffer, size_t size) const {
+        if (type == INT)   { snprintf(buffer, size, "%i", intValue); return buffer; }
+        if (type == FLOAT) { snprintf(buffer, size, "%.9g", floatValue); return buffer; }
+        return stringValue.c_str();
     }
 };
 
-
 typedef struct {
     // Key - value of global data
     // It will contain information like "map", "team1_score", etc.
-    ordered_map<std::string, std::string> globalData;
+    ordered_map<std::string, MatchValue> globalData;
 
     // Key - value of players where key is player's UUID, but might be empty
     // It will contain information like "kills", "deaths", etc.
-    ordered_map<std::string, ordered_map<std::string, std::string>> playerData;
+    ordered_map<std::string, ordered_map<std::string, MatchValue>> playerData;
 } MatchProgressData;
 
 
@@ -98,6 +90,16 @@ typedef struct {
     std::string error;
 } MatchData;
 
+// Match identity of a client, resolved from userinfo once and cached until the userinfo or match data changes
+typedef struct {
+    bool valid;
+    unsigned int dataVersion;       // match.dataVersion when resolved
+    int guid;                       // client guid when resolved
+    MatchPlayer* player;            // player with the client's uuid, nullptr if the uuid is not part of any team
+    char uuid[MAX_ID_LENGTH];       // match_login from userinfo
+    char key[MAX_ID_LENGTH + 8];    // key of player in progress data
+} MatchClientIdentity;
+
 typedef struct {
     bool downloading;
     bool loading;
@@ -108,11 +110,15 @@ typedef struct {
     bool allow_map_change; // allow map change for once
     char url[256]; // URL to the match server
     HttpClient* httpClient;
+    std::string uploadingData; // JSON being uploaded, saved to the outbox if the upload fails
+    std::string uploadingErrorData;
     uint64_t start_time; // Time when the match data download started
     uint64_t start_tick; // Tick when the match data download started
 
     // Data from server
     MatchData data;
+    unsigned int dataVersion;                       // increased every time the data changes
+    ordered_map<std::string, MatchPlayer*> players; // players of both teams by uuid
 
     // Match progress data
     MatchProgressData progressData;
@@ -121,9 +127,14 @@ typedef struct {
 
 extern Match match;
 
+void match_json_value(JsonWriter& json, const MatchValue& value);
 bool match_upload_match_data(std::function<void()> onDone = nullptr, std::function<void(const std::string&)> onError = nullptr);
+bool match_parse_json_match_data(const char* json_str, MatchData* match_data);
 MatchPlayer* match_find_player_by_uuid(const char* uuid);
-bool match_redownload();
+void match_data_changed();
+MatchClientIdentity* match_get_client_identity(int clientNum);
+void match_client_changed(int clientNum);
+bool match_redownload(std::function<void()> onDone = nullptr, std::function<void(const std::string&)> onError = nullptr);
 bool match_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
 void match_onStartGameType();
 void match_frame();
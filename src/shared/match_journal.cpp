@@ -0,0 +1,511 @@
+#include "match_journal.h"
+
+#include <string>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "shared.h"
+#if COD2X_WIN32
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#include "cod2_common.h"
+#include "cod2_dvars.h"
+#include "logger.h"
+
+// Crash-safe journal of match progress data.
+// Every change of match.progressData is appended to fs_homepath/match_<matchId>.journal as small binary record.
+// Records are collected in memory and written + fsync'd by a worker thread in batches, so the game thread never waits for the disk.
+// If the server crashes or is killed, the data are replayed when the same match is created again.
+// On map change the journal is compacted into a snapshot of the current data.
+//
+// File format:
+//   header:  "CXJ1" <string matchId> <string url>
+//   record:  <varint payloadLength> <payload> <uint16 crc16 of payload>
+//   payload: <uint8 op> ...
+//              JOURNAL_SET_GLOBAL   <string key> <value>
+//              JOURNAL_SET_PLAYER   <string playerKey> <string key> <value>
+//              JOURNAL_ERASE_PLAYER <string playerKey> <string key>
+//              JOURNAL_CLEAR
+//   string:  <varint length> <bytes>
+//   value:   <uint8 type> <string> | <int32> | <float32>
+// Replay stops on the first incomplete or damaged record, which can happen if the process was killed while writing.
+
+#define JOURNAL_MAGIC           "CXJ1"
+#define JOURNAL_FLUSH_MS        250
+
+enum {
+    JOURNAL_SET_GLOBAL = 1,
+    JOURNAL_SET_PLAYER = 2,
+    JOURNAL_ERASE_PLAYER = 3,
+    JOURNAL_CLEAR = 4,
+};
+
+static struct {
+    bool initialized;
+    bool active;                    // journal is open for current match
+    std::string path;
+    std::string header;             // encoded header, written again on compaction
+    std::string pending;            // records waiting to be written
+    std::string snapshot;           // compacted journal waiting to replace the file
+    bool compact;
+    bool worker;                    // worker thread is running, otherwise records are written right away
+    FILE* file;                     // used only with io lock held
+    std::atomic<int> generation;    // worker runs while its generation is current
+    #if COD2X_WIN32
+        CRITICAL_SECTION cs;        // protects the buffers
+        CRITICAL_SECTION io;        // protects the file
+    #else
+        pthread_mutex_t cs;
+        pthread_mutex_t io;
+    #endif
+} journal;
+
+
+#if COD2X_WIN32
+static void match_journal_lock(CRITICAL_SECTION* cs) { EnterCriticalSection(cs); }
+static void match_journal_unlock(CRITICAL_SECTION* cs) { LeaveCriticalSection(cs); }
+#else
+static void match_journal_lock(pthread_mutex_t* cs) { pthread_mutex_lock(cs); }
+static void match_journal_unlock(pthread_mutex_t* cs) { pthread_mutex_unlock(cs); }
+#endif
+
+static void match_journal_sync(FILE* f) {
+    fflush(f);
+    #if COD2X_WIN32
+        _commit(_fileno(f));
+    #else
+        fsync(fileno(f));
+    #endif
+}
+
+
+
+static void match_journal_writeVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static void match_journal_writeString(std::string& out, const char* s, size_t len) {
+    match_journal_writeVarint(out, (uint32_t)len);
+    out.append(s, len);
+}
+static void match_journal_writeString(std::string& out, const std::string& s) { match_journal_writeString(out, s.data(), s.size()); }
+static void match_journal_writeString(std::string& out, const char* s) { match_journal_writeString(out, s, strlen(s)); }
+
+static void match_journal_writeValue(std::string& out, const MatchValue& value) {
+    out.push_back((char)value.type);
+    if (value.type == MatchValue::INT)
+        out.append((const char*)&value.intValue, 4);
+    else if (value.type == MatchValue::FLOAT)
+        out.append((const char*)&value.floatValue, 4);
+    else
+        match_journal_writeString(out, value.stringValue);
+}
+
+// Frame the payload as a record and append it to out
+static void match_journal_writeRecord(std::string& out, const std::string& payload) {
+    match_journal_writeVarint(out, (uint32_t)payload.size());
+    out.append(payload);
+    uint16_t crc = crc16_ccitt((const uint8_t*)payload.data(), payload.size());
+    out.append((const char*)&crc, 2);
+}
+
+
+// Reader over the journal data, all reads fail once the end is reached
+struct JournalReader {
+    const char* data;
+    size_t size;
+    size_t pos;
+
+    bool readVarint(uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (pos >= size) return false;
+            uint8_t b = (uint8_t)data[pos++];
+            value |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+    bool readBytes(void* out, size_t len) {
+        if (size - pos < len) return false;
+        memcpy(out, data + pos, len);
+        pos += len;
+        return true;
+    }
+    bool readString(std::string& s) {
+        uint32_t len;
+        if (!readVarint(len) || size - pos < len) return false;
+        s.assign(data + pos, len);
+        pos += len;
+        return true;
+    }
+    bool readValue(MatchValue& value) {
+        uint8_t type;
+        if (!readBytes(&type, 1)) return false;
+        if (type == MatchValue::INT) {
+            int i;
+            if (!readBytes(&i, 4)) return false;
+            value = i;
+        } else if (type == MatchValue::FLOAT) {
+            float f;
+            if (!readBytes(&f, 4)) return false;
+            value = f;
+        } else if (type == MatchValue::STRING) {
+            std::string s;
+            if (!readString(s)) return false;
+            value = s;
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// Apply one record payload to the data. Returns false if the payload is invalid.
+static bool match_journal_apply(JournalReader& r, MatchProgressData* data) {
+    uint8_t op;
+    std::string playerKey, key;
+    MatchValue value;
+    if (!r.readBytes(&op, 1)) return false;
+
+    switch (op) {
+        case JOURNAL_SET_GLOBAL:
+            if (!r.readString(key) || !r.readValue(value)) return false;
+            data->globalData[key] = value;
+            return true;
+        case JOURNAL_SET_PLAYER:
+            if (!r.readString(playerKey) || !r.readString(key) || !r.readValue(value)) return false;
+            data->playerData[playerKey][key] = value;
+            return true;
+        case JOURNAL_ERASE_PLAYER:
+            if (!r.readString(playerKey) || !r.readString(key)) return false;
+            if (auto* player = data->playerData.find(playerKey))
+                player->erase(key);
+            return true;
+        case JOURNAL_CLEAR:
+            data->globalData.clear();
+            data->playerData.clear();
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Read the journal file and replay it into data. Returns number of replayed records, -1 if file does not belong to the match.
+static int match_journal_replay(const char* matchId, MatchProgressData* data) {
+    FILE* f = fopen(journal.path.c_str(), "rb");
+    if (!f) return 0;
+    std::string content;
+    char buf[16 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        content.append(buf, n);
+    fclose(f);
+
+    JournalReader r = { content.data(), content.size(), 0 };
+    char magic[4];
+    std::string fileMatchId, url;
+    if (!r.readBytes(magic, 4) || memcmp(magic, JOURNAL_MAGIC, 4) != 0 || !r.readString(fileMatchId) || !r.readString(url) || fileMatchId != matchId)
+        return -1;
+
+    int records = 0;
+    uint32_t len;
+    while (r.readVarint(len) && len + 2 <= r.size - r.pos) {
+        uint16_t crc;
+        memcpy(&crc, r.data + r.pos + len, 2);
+        if (crc != crc16_ccitt((const uint8_t*)r.data + r.pos, len))
+            break;
+        JournalReader payload = { r.data + r.pos, len, 0 };
+        if (!match_journal_apply(payload, data))
+            break;
+        r.pos += len + 2;
+        records++;
+    }
+    return records;
+}
+
+// Encode current data as list of records
+static void match_journal_writeSnapshot(std::string& out, const MatchProgressData& data) {
+    std::string payload;
+    for (const auto& item : data.globalData) {
+        payload.clear();
+        payload.push_back(JOURNAL_SET_GLOBAL);
+        match_journal_writeString(payload, item.key);
+        match_journal_writeValue(payload, item.value);
+        match_journal_writeRecord(out, payload);
+    }
+    for (const auto& player : data.playerData) {
+        for (const auto& field : player.value) {
+            payload.clear();
+            payload.push_back(JOURNAL_SET_PLAYER);
+            match_journal_writeString(payload, player.key);
+            match_journal_writeString(payload, field.key);
+            match_journal_writeValue(payload, field.value);
+            match_journal_writeRecord(out, payload);
+        }
+    }
+}
+
+
+// Write pending records to the file
+static void match_journal_flush() {
+    match_journal_lock(&journal.io);
+
+    match_journal_lock(&journal.cs);
+    std::string data;
+    data.swap(journal.pending);
+    std::string snapshot;
+    bool compact = journal.compact;
+    if (compact) {
+        snapshot.swap(journal.snapshot);
+        journal.compact = false;
+    }
+    match_journal_unlock(&journal.cs);
+
+    if (journal.file) {
+        // Replace the file with the snapshot, the old file is kept until the new one is complete
+        if (compact) {
+            std::string tmp = journal.path + ".tmp";
+            FILE* f = fopen(tmp.c_str(), "wb");
+            if (f) {
+                bool ok = fwrite(snapshot.data(), 1, snapshot.size(), f) == snapshot.size();
+                match_journal_sync(f);
+                fclose(f);
+                if (ok) {
+                    // Atomic replace, there is always either the old or the new complete journal
+                    fclose(journal.file);
+                    #if COD2X_WIN32
+                        ok = MoveFileExA(tmp.c_str(), journal.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+                    #else
+                        ok = rename(tmp.c_str(), journal.path.c_str()) == 0;
+                    #endif
+                    if (!ok) remove(tmp.c_str());
+                    journal.file = fopen(journal.path.c_str(), "ab");
+                } else {
+                    remove(tmp.c_str());
+                }
+            }
+        }
+
+        if (journal.file && !data.empty()) {
+            fwrite(data.data(), 1, data.size(), journal.file);
+            match_journal_sync(journal.file);
+        }
+    }
+
+    match_journal_unlock(&journal.io);
+}
+
+static void match_journal_worker(int generation) {
+    while (journal.generation == generation) {
+        #if COD2X_WIN32
+            Sleep(JOURNAL_FLUSH_MS);
+        #else
+            usleep(JOURNAL_FLUSH_MS * 1000);
+        #endif
+        if (journal.generation != generation)
+            break;
+        match_journal_flush();
+    }
+}
+
+#if COD2X_WIN32
+static DWORD WINAPI match_journal_workerThread(LPVOID arg) {
+    match_journal_worker((int)(intptr_t)arg);
+    return 0;
+}
+#else
+static void* match_journal_workerThread(void* arg) {
+    match_journal_worker((int)(intptr_t)arg);
+    return NULL;
+}
+#endif
+
+// Append encoded record to pending data, it will be written by the worker
+static void match_journal_append(const std::string& payload) {
+    match_journal_lock(&journal.cs);
+    if (journal.active)
+        match_journal_writeRecord(journal.pending, payload);
+    match_journal_unlock(&journal.cs);
+
+    // Worker thread could not be created, pending data must not grow
+    if (!journal.worker)
+        match_journal_flush();
+}
+
+
+/**
+ * Open the journal for the match. If journal of the same match exists from previous run, it is replayed into data.
+ * Returns true if some data were restored.
+ */
+bool match_journal_open(const char* matchId, const char* url, MatchProgressData* data) {
+    if (!journal.initialized)
+        return false;
+
+    match_journal_close(false);
+
+    // Match id is used in the file name, keep only safe characters
+    std::string name = "match_";
+    for (const char* c = matchId; *c; c++) {
+        bool safe = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '-' || *c == '_';
+        name += safe ? *c : '_';
+    }
+    std::string path = std::string(Dvar_GetString("fs_homepath")) + WL("\\", "/") + name + ".journal";
+
+    match_journal_lock(&journal.io);
+    match_journal_lock(&journal.cs);
+
+    journal.path = path;
+    journal.header.clear();
+    journal.header.append(JOURNAL_MAGIC, 4);
+    match_journal_writeString(journal.header, matchId);
+    match_journal_writeString(journal.header, url);
+
+    int records = match_journal_replay(matchId, data);
+    if (records < 0) {
+        Com_Printf("Match journal %s belongs to another match, it will be overwritten\n", path.c_str());
+        records = 0;
+    }
+
+    // Start with compacted file
+    std::string content = journal.header;
+    match_journal_writeSnapshot(content, *data);
+    journal.file = fopen(path.c_str(), "wb");
+    if (journal.file) {
+        fwrite(content.data(), 1, content.size(), journal.file);
+        match_journal_sync(journal.file);
+    } else {
+        Com_Printf("Match journal %s could not be opened, match progress will not be saved\n", path.c_str());
+    }
+    journal.pending.clear();
+    journal.snapshot.clear();
+    journal.compact = false;
+    journal.active = journal.file != NULL;
+
+    int generation = ++journal.generation;
+
+    match_journal_unlock(&journal.cs);
+    match_journal_unlock(&journal.io);
+
+    journal.worker = false;
+    if (journal.active) {
+        #if COD2X_WIN32
+            HANDLE thread = CreateThread(NULL, 0, match_journal_workerThread, (LPVOID)(intptr_t)generation, 0, NULL);
+            if (thread) CloseHandle(thread);
+            journal.worker = thread != NULL;
+        #else
+            pthread_t thread;
+            journal.worker = pthread_create(&thread, NULL, match_journal_workerThread, (void*)(intptr_t)generation) == 0;
+            if (journal.worker) pthread_detach(thread);
+        #endif
+        if (!journal.worker)
+            Com_Printf("Match journal worker could not be started, records will be written synchronously\n");
+    }
+
+    if (records > 0)
+        logger_add("Match journal: %i records replayed from %s", records, path.c_str());
+
+    return records > 0;
+}
+
+/** Record change of the value. playerKey is nullptr for global data. */
+void match_journal_set(const char* playerKey, const char* key, const MatchValue& value) {
+    if (!journal.active) return;
+    static std::string payload; // reused to avoid allocations
+    payload.clear();
+    if (playerKey) {
+        payload.push_back(JOURNAL_SET_PLAYER);
+        match_journal_writeString(payload, playerKey);
+    } else {
+        payload.push_back(JOURNAL_SET_GLOBAL);
+    }
+    match_journal_writeString(payload, key);
+    match_journal_writeValue(payload, value);
+    match_journal_append(payload);
+}
+
+/** Record removal of player's value. */
+void match_journal_erase(const char* playerKey, const char* key) {
+    if (!journal.active) return;
+    static std::string payload;
+    payload.clear();
+    payload.push_back(JOURNAL_ERASE_PLAYER);
+    match_journal_writeString(payload, playerKey);
+    match_journal_writeString(payload, key);
+    match_journal_append(payload);
+}
+
+/** Record removal of all data. */
+void match_journal_clear() {
+    if (!journal.active) return;
+    match_journal_append(std::string(1, (char)JOURNAL_CLEAR));
+}
+
+/** Replace the journal with snapshot of current data. The file is replaced by the worker thread. */
+void match_journal_compact(const MatchProgressData& data) {
+    if (!journal.active) return;
+
+    std::string snapshot = journal.header;
+    match_journal_writeSnapshot(snapshot, data);
+
+    match_journal_lock(&journal.cs);
+    journal.snapshot.swap(snapshot);
+    journal.compact = true;
+    journal.pending.clear(); // already part of the snapshot
+    match_journal_unlock(&journal.cs);
+
+    if (!journal.worker)
+        match_journal_flush();
+}
+
+/**
+ * Stop the journal. Pending records are written before the file is closed.
+ * @param remove true to delete the file, when the match ended and the data will not be needed anymore.
+ */
+void match_journal_close(bool remove) {
+    if (!journal.initialized || !journal.active)
+        return;
+
+    journal.generation++; // stop the worker
+
+    if (!remove)
+        match_journal_flush();
+
+    match_journal_lock(&journal.io);
+    match_journal_lock(&journal.cs);
+    if (journal.file) {
+        fclose(journal.file);
+        journal.file = NULL;
+    }
+    if (remove)
+        ::remove(journal.path.c_str());
+    journal.active = false;
+    journal.pending.clear();
+    journal.snapshot.clear();
+    journal.compact = false;
+    match_journal_unlock(&journal.cs);
+    match_journal_unlock(&journal.io);
+}
+
+
+/** Called only once on game start after common inicialization. */
+void match_journal_init() {
+    #if COD2X_WIN32
+        InitializeCriticalSection(&journal.cs);
+        InitializeCriticalSection(&journal.io);
+    #else
+        pthread_mutex_init(&journal.cs, NULL);
+        pthread_mutex_init(&journal.io, NULL);
+    #endif
+    journal.initialized = true;
+}
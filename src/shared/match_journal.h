@@ -0,0 +1,14 @@
+#ifndef MATCH_JOURNAL_H
+#define MATCH_JOURNAL_H
+
+#include "match.h"
+
+bool match_journal_open(const char* matchId, const char* url, MatchProgressData* data);
+void match_journal_set(const char* playerKey, const char* key, const MatchValue& value);
+void match_journal_erase(const char* playerKey, const char* key);
+void match_journal_clear();
+void match_journal_compact(const MatchProgressData& data);
+void match_journal_close(bool remove);
+void match_journal_init();
+
+#endif
@@ -0,0 +1,374 @@
+#include "netbench.h"
+
+#if DEBUG
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "shared.h"
+#if COD2X_WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#include "cod2_common.h"
+#include "cod2_cmd.h"
+#include "cod2_shared.h"
+#include "http_client.h"
+#include "websocket.h"
+#include "match.h"
+#include "gsc_http.h"
+#include "outbox.h"
+
+// Local stand-in server and throughput benchmark for the networking code (debug builds only).
+// The stand-in server runs in its own thread and provides:
+//   GET  /api/match/<id>  - match data like the match API returns
+//   POST /api/match/<id>  - accepts uploaded match data
+//   *    /echo            - returns the request body
+//   WS   /ws              - websocket echo
+// The real code paths are run against it from the main thread, like in the game:
+//   match_redownload / match_upload_match_data with a temporary match, http_fetch through gsc_http_request,
+//   plain HttpClient requests and WebSocketClient.
+
+#define NETBENCH_MATCH_JSON \
+    "{\"matchId\":\"1234\",\"format\":\"BO1\",\"maps\":[\"mp_toujane\"]," \
+    "\"team1\":{\"id\":\"t1\",\"name\":\"Team 1\",\"tag\":\"T1\",\"players\":[" \
+        "{\"uuid\":\"p1\",\"name\":\"Player 1\"},{\"uuid\":\"p2\",\"name\":\"Player 2\"},{\"uuid\":\"p3\",\"name\":\"Player 3\"}," \
+        "{\"uuid\":\"p4\",\"name\":\"Player 4\"},{\"uuid\":\"p5\",\"name\":\"Player 5\"}]}," \
+    "\"team2\":{\"id\":\"t2\",\"name\":\"Team 2\",\"tag\":\"T2\",\"players\":[" \
+        "{\"uuid\":\"p6\",\"name\":\"Player 6\"},{\"uuid\":\"p7\",\"name\":\"Player 7\"},{\"uuid\":\"p8\",\"name\":\"Player 8\"}," \
+        "{\"uuid\":\"p9\",\"name\":\"Player 9\"},{\"uuid\":\"p10\",\"name\":\"Player 10\"}]}}"
+
+static struct {
+    std::atomic<bool> running;
+    std::atomic<bool> ready;
+    std::atomic<int> port;
+    std::atomic<size_t> peakConnections;
+    std::atomic<size_t> peakBytes;         // memory used by connections when the count was at peak
+} netbench_server;
+
+
+static void netbench_server_handler(mg_connection* c, int ev, void* ev_data) {
+    if (ev == MG_EV_HTTP_MSG) {
+        auto* hm = (mg_http_message*)ev_data;
+        if (mg_match(hm->uri, mg_str("/ws"), NULL)) {
+            mg_ws_upgrade(c, hm, NULL);
+        } else if (mg_match(hm->uri, mg_str("/echo"), NULL)) {
+            mg_http_reply(c, 200, "Content-Type: application/octet-stream\r\n", "%.*s", (int)hm->body.len, hm->body.buf);
+        } else if (mg_match(hm->uri, mg_str("/api/match/*"), NULL)) {
+            if (mg_strcmp(hm->method, mg_str("GET")) == 0)
+                mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", NETBENCH_MATCH_JSON);
+            else
+                mg_http_reply(c, 200, "Content-Type: application/json\r\n", "{\"ok\":true}");
+        } else {
+            mg_http_reply(c, 404, "", "Not found\n");
+        }
+    } else if (ev == MG_EV_WS_MSG) {
+        auto* wm = (mg_ws_message*)ev_data;
+        mg_ws_send(c, wm->data.buf, wm->data.len, WEBSOCKET_OP_TEXT);
+    }
+}
+
+static void netbench_server_run() {
+    mg_mgr mgr;
+    mg_log_set(MG_LL_NONE);
+    mg_mgr_init(&mgr);
+
+    mg_connection* listener = mg_http_listen(&mgr, "http://127.0.0.1:0", netbench_server_handler, NULL);
+    netbench_server.port = listener ? mg_ntohs(listener->loc.port) : 0;
+    netbench_server.ready = true;
+
+    while (listener && netbench_server.running) {
+        mg_mgr_poll(&mgr, 1);
+
+        // Measure memory used by the connections (struct + IO buffers)
+        size_t count = 0, bytes = 0;
+        for (mg_connection* c = mgr.conns; c != NULL; c = c->next) {
+            if (c == listener) continue;
+            count++;
+            bytes += sizeof(*c) + c->recv.size + c->send.size;
+        }
+        if (count > netbench_server.peakConnections) {
+            netbench_server.peakConnections = count;
+            netbench_server.peakBytes = bytes;
+        }
+    }
+
+    mg_mgr_free(&mgr);
+    netbench_server.ready = false;
+}
+
+#if COD2X_WIN32
+static DWORD WINAPI netbench_serverThread(LPVOID) { netbench_server_run(); return 0; }
+#else
+static void* netbench_serverThread(void*) { netbench_server_run(); return NULL; }
+#endif
+
+static bool netbench_server_start() {
+    netbench_server.running = true;
+    netbench_server.ready = false;
+    netbench_server.port = 0;
+    netbench_server.peakConnections = 0;
+    netbench_server.peakBytes = 0;
+
+    #if COD2X_WIN32
+        HANDLE thread = CreateThread(NULL, 0, netbench_serverThread, NULL, 0, NULL);
+        if (!thread) return false;
+        CloseHandle(thread);
+    #else
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, netbench_serverThread, NULL) != 0) return false;
+        pthread_detach(thread);
+    #endif
+
+    while (!netbench_server.ready) {
+        #if COD2X_WIN32
+            Sleep(1);
+        #else
+            usleep(1000);
+        #endif
+    }
+    return netbench_server.port != 0;
+}
+
+static void netbench_server_stop() {
+    netbench_server.running = false;
+    while (netbench_server.ready) {
+        #if COD2X_WIN32
+            Sleep(1);
+        #else
+            usleep(1000);
+        #endif
+    }
+}
+
+
+static int64_t netbench_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Collected results of one benchmark
+struct NetbenchStats {
+    std::vector<int64_t> latencies;    // us
+    int64_t totalUs = 0;
+    int errors = 0;
+    int64_t pollCount = 0;
+    int64_t pollUs = 0;
+    int64_t pollMaxUs = 0;
+
+    void poll(const std::function<void()>& fn) {
+        int64_t start = netbench_us();
+        fn();
+        int64_t elapsed = netbench_us() - start;
+        pollCount++;
+        pollUs += elapsed;
+        if (elapsed > pollMaxUs) pollMaxUs = elapsed;
+    }
+
+    void print(const char* name) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) -> double {
+            if (latencies.empty()) return 0;
+            size_t i = (size_t)(p * (latencies.size() - 1));
+            return latencies[i] / 1000.0;
+        };
+        double seconds = totalUs / 1000000.0;
+        Com_Printf("%-22s %6u ok %4i err  %9.1f req/s  p50 %7.2f ms  p99 %7.2f ms  poll avg %6.1f us  max %7.1f us\n",
+            name, (unsigned)latencies.size(), errors, seconds > 0 ? latencies.size() / seconds : 0.0,
+            percentile(0.5), percentile(0.99), pollCount ? (double)pollUs / pollCount : 0.0, (double)pollMaxUs);
+    }
+};
+
+
+// Run 'total' operations with max 'concurrency' operations in flight
+// start() begins one operation and calls the done callback with the result, poll() processes the network events
+static void netbench_run(const char* name, int total, int concurrency, const std::function<void(std::function<void(bool)>)>& start, const std::function<void()>& poll) {
+    NetbenchStats stats;
+    int started = 0, finished = 0;
+
+    int64_t begin = netbench_us();
+    while (finished < total) {
+        while (started < total && started - finished < concurrency) {
+            int64_t requestStart = netbench_us();
+            started++;
+            start([&stats, &finished, requestStart](bool ok) {
+                finished++;
+                if (!ok) stats.errors++;
+                else stats.latencies.push_back(netbench_us() - requestStart);
+            });
+        }
+        stats.poll(poll);
+    }
+    stats.totalUs = netbench_us() - begin;
+    stats.print(name);
+}
+
+// Send 'total' HTTP requests with max 'concurrency' requests in flight
+static void netbench_http(const char* name, const char* method, const std::string& url, const std::string& body, int total, int concurrency) {
+    HttpClient client;
+    netbench_run(name, total, concurrency,
+        [&](std::function<void(bool)> done) {
+            client.request(method, url.c_str(), body.c_str(), "",
+                [done](const HttpClient::Response& res) { done(res.status == 200); },
+                [done](const std::string&) { done(false); },
+                5000);
+        },
+        [&]() { client.poll(0); });
+}
+
+// Send requests through the same path as the http_fetch script function
+static void netbench_httpFetch(const char* name, const char* method, const std::string& url, const std::string& body, int total, int concurrency) {
+    netbench_run(name, total, concurrency,
+        [&](std::function<void(bool)> done) {
+            gsc_http_request(method, url.c_str(), body.c_str(), "", 5000,
+                [done](const HttpClient::Response& res) { done(res.status == 200); },
+                [done](const std::string&) { done(false); });
+        },
+        [&]() { gsc_http_frame(); });
+}
+
+// Download and upload match data through the match code with a temporary match pointing to the stand-in server
+static void netbench_match(const std::string& url, int total, int concurrency) {
+    if (match.activated || match.downloading || match.loading) {
+        Com_Printf("%-22s skipped, match is active\n", "match");
+        return;
+    }
+
+    // Failed uploads would be saved to the outbox with the URL of the stand-in server that exists only during the benchmark
+    outbox_suspend(true);
+
+    snprintf(match.url, sizeof(match.url), "%s", url.c_str());
+    match.httpClient = new HttpClient();
+    match.data = MatchData{};
+    match_parse_json_match_data(NETBENCH_MATCH_JSON, &match.data);
+    match_data_changed();
+    match.activated = true;
+
+    // Progress data of a full match
+    for (int i = 0; i < 10; i++) {
+        auto& player = match.progressData.playerData[va("p%i", i + 1)];
+        for (int j = 0; j < 20; j++)
+            player[va("stat%i", j)] = i * 100 + j;
+        player["name"] = va("Player %i", i + 1);
+    }
+    match.progressData.globalData["team1_score"] = 7;
+    match.progressData.globalData["team2_score"] = 5;
+
+    netbench_run("match redownload", total, concurrency,
+        [](std::function<void(bool)> done) {
+            match_redownload([done]() { done(true); }, [done](const std::string&) { done(false); });
+        },
+        []() { match_frame(); });
+
+    // Only one upload can be in progress
+    netbench_run("match upload", total, 1,
+        [](std::function<void(bool)> done) {
+            if (!match_upload_match_data([done]() { done(true); }, [done](const std::string&) { done(false); }))
+                done(false);
+        },
+        []() { match_frame(); });
+
+    delete match.httpClient;
+    match.httpClient = nullptr;
+    match.activated = false;
+    match.url[0] = '\0';
+    match.data = MatchData{};
+    match_data_changed();
+    match.progressData.globalData.clear();
+    match.progressData.playerData.clear();
+
+    outbox_suspend(false);
+}
+
+// Send 'total' websocket messages with max 'concurrency' messages in flight
+static void netbench_websocket(const std::string& url, int total, int concurrency, size_t size) {
+    WebSocketClient client("", 2000, 0);
+    NetbenchStats stats;
+    std::vector<int64_t> sentAt;
+    int sent = 0, received = 0;
+    std::string payload(size, 'x');
+
+    client.onMessage([&](const std::string&) {
+        if (received < (int)sentAt.size())
+            stats.latencies.push_back(netbench_us() - sentAt[received]);
+        received++;
+    });
+    client.onError([&](const std::string&) { stats.errors++; });
+    client.connect(url);
+
+    int64_t deadline = netbench_us() + 5000000;
+    while (!client.isConnected() && netbench_us() < deadline)
+        client.poll(1);
+    if (!client.isConnected()) {
+        Com_Printf("%-22s failed to connect\n", "websocket echo");
+        return;
+    }
+
+    int64_t start = netbench_us();
+    while (received < total && netbench_us() < deadline + 60000000) {
+        while (sent < total && sent - received < concurrency) {
+            sentAt.push_back(netbench_us());
+            client.sendText(payload);
+            sent++;
+        }
+        stats.poll([&]() { client.poll(0); });
+    }
+    stats.totalUs = netbench_us() - start;
+    stats.errors += total - received;
+    client.close();
+    stats.print(va("websocket echo %ub", (unsigned)size));
+}
+
+
+/**
+ * Run the networking benchmark against local stand-in server.
+ * USAGE: netbench [requests] [concurrency]
+ */
+void netbench_cmd() {
+    int total = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 1000;
+    int concurrency = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 16;
+    if (total <= 0 || concurrency <= 0) {
+        Com_Printf("USAGE: netbench [requests] [concurrency]\n");
+        return;
+    }
+
+    if (!netbench_server_start()) {
+        Com_Printf("netbench: failed to start the stand-in server\n");
+        netbench_server_stop();
+        return;
+    }
+
+    std::string base = "http://127.0.0.1:" + std::to_string(netbench_server.port);
+    std::string upload(16 * 1024, 'x');
+    Com_Printf("netbench: %i requests, concurrency %i, server %s\n", total, concurrency, base.c_str());
+
+    netbench_http("http get match", "GET", base + "/api/match/1234", "", total, concurrency);
+    netbench_http("http post match", "POST", base + "/api/match/1234", upload, total, concurrency);
+    netbench_http("http echo 1KB", "POST", base + "/echo", std::string(1024, 'x'), total, concurrency);
+    netbench_httpFetch("http_fetch get", "GET", base + "/api/match/1234", "", total, concurrency);
+    netbench_httpFetch("http_fetch post 1KB", "POST", base + "/echo", std::string(1024, 'x'), total, concurrency);
+    netbench_match(base + "/api/match/1234", total, concurrency);
+    netbench_websocket("ws://127.0.0.1:" + std::to_string(netbench_server.port) + "/ws", total * 10, concurrency, 64);
+    netbench_websocket("ws://127.0.0.1:" + std::to_string(netbench_server.port) + "/ws", total, concurrency, 16 * 1024);
+
+    size_t peak = netbench_server.peakConnections;
+    Com_Printf("server connections peak: %u, memory per connection: %u bytes\n",
+        (unsigned)peak, peak ? (unsigned)(netbench_server.peakBytes / peak) : 0);
+
+    netbench_server_stop();
+}
+
+#endif
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void netbench_init() {
+    #if DEBUG
+        Cmd_AddCommand("netbench", netbench_cmd);
+    #endif
+}
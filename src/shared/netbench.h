@@ -0,0 +1,6 @@
+#ifndef NETBENCH_H
+#define NETBENCH_H
+
+void netbench_init();
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef ORDERED_MAP_H
+#define ORDERED_MAP_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+/**
+ * Hash map that remembers the insertion order of keys.
+ *
+ * Entries are stored in one vector in insertion order, each key is stored only once together with its hash.
+ * Lookup uses open addressing table with linear probing that holds indexes into the entry vector.
+ * Erased entries are only marked as erased and act as tombstones in the table until the next rebuild,
+ * so erase is O(1) and the order of remaining entries does not change. Erased key inserted again is added to the end.
+ *
+ * String keys can be looked up by const char* without creating temporary std::string.
+ * Short keys (up to 15 chars) are stored inline in std::string, so typical field names dont allocate memory.
+ *
+ * References to values are invalidated when a new key is inserted or when entries are erased.
+ *
+ * Example:
+ *   ordered_map<std::string, int> map;
+ *   map["kills"] = 5;
+ *   for (const auto& e : map)
+ *       printf("%s=%i\n", e.key.c_str(), e.value);
+ */
+template <typename K, typename V>
+class ordered_map {
+public:
+    struct Entry {
+        K key;
+        V value;
+        size_t hash;
+        bool erased;
+    };
+
+    // Iterator over entries in insertion order, erased entries are skipped
+    template <typename E>
+    class Iterator {
+    public:
+        Iterator(E* it, E* end) : m_it(it), m_end(end) { skip(); }
+        E& operator*() const { return *m_it; }
+        E* operator->() const { return m_it; }
+        Iterator& operator++() { ++m_it; skip(); return *this; }
+        bool operator==(const Iterator& other) const { return m_it == other.m_it; }
+        bool operator!=(const Iterator& other) const { return m_it != other.m_it; }
+    private:
+        void skip() { while (m_it != m_end && m_it->erased) ++m_it; }
+        E* m_it;
+        E* m_end;
+    };
+
+    typedef Iterator<Entry> iterator;
+    typedef Iterator<const Entry> const_iterator;
+
+    // Insert or update
+    V& operator[](const K& key) { return insert(key, hash_key(key)); }
+    template <typename T = K, typename = typename std::enable_if<std::is_same<T, std::string>::value>::type>
+    V& operator[](const char* key) {
+        size_t hash = hash_key(key);
+        uint32_t slot = find_slot(key, hash);
+        if (slot != NOT_FOUND) return m_entries[m_slots[slot]].value;
+        return insert_new(K(key), hash);
+    }
+
+    // Returns pointer to the value or nullptr if key does not exist
+    template <typename KeyLike>
+    V* find(const KeyLike& key) {
+        uint32_t slot = find_slot(key, hash_key(key));
+        return slot == NOT_FOUND ? nullptr : &m_entries[m_slots[slot]].value;
+    }
+    template <typename KeyLike>
+    const V* find(const KeyLike& key) const {
+        uint32_t slot = find_slot(key, hash_key(key));
+        return slot == NOT_FOUND ? nullptr : &m_entries[m_slots[slot]].value;
+    }
+
+    template <typename KeyLike>
+    bool contains(const KeyLike& key) const { return find(key) != nullptr; }
+
+    template <typename KeyLike>
+    V& at(const KeyLike& key) {
+        V* value = find(key);
+        if (value == nullptr) throw std::out_of_range("ordered_map::at");
+        return *value;
+    }
+    template <typename KeyLike>
+    const V& at(const KeyLike& key) const {
+        const V* value = find(key);
+        if (value == nullptr) throw std::out_of_range("ordered_map::at");
+        return *value;
+    }
+
+    template <typename KeyLike>
+    bool erase(const KeyLike& key) {
+        uint32_t slot = find_slot(key, hash_key(key));
+        if (slot == NOT_FOUND) return false;
+
+        // Keep the entry as tombstone, just free its data
+        Entry& e = m_entries[m_slots[slot]];
+        e.erased = true;
+        e.key = K{};
+        e.value = V{};
+        m_size--;
+
+        if (m_size == 0)
+            clear();
+        else if (m_entries.size() - m_size > m_size && m_entries.size() > 16)
+            rebuild(m_slots.size()); // more tombstones than entries
+        return true;
+    }
+
+    void clear() {
+        m_entries.clear();
+        m_slots.clear();
+        m_size = 0;
+    }
+
+    void reserve(size_t count) {
+        m_entries.reserve(count);
+        if (count * 4 > m_slots.size() * 3)
+            rebuild(table_size_for(count));
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    iterator begin() { return iterator(m_entries.data(), m_entries.data() + m_entries.size()); }
+    iterator end() { return iterator(m_entries.data() + m_entries.size(), m_entries.data() + m_entries.size()); }
+    const_iterator begin() const { return const_iterator(m_entries.data(), m_entries.data() + m_entries.size()); }
+    const_iterator end() const { return const_iterator(m_entries.data() + m_entries.size(), m_entries.data() + m_entries.size()); }
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+    static constexpr uint32_t NOT_FOUND = 0xFFFFFFFF;
+
+    std::vector<Entry> m_entries;   // entries in insertion order, including erased ones
+    std::vector<uint32_t> m_slots;  // indexes into m_entries, size is power of 2
+    size_t m_size = 0;              // number of entries that are not erased
+
+    // FNV-1a
+    static size_t hash_key(const char* s) {
+        uint32_t h = 2166136261u;
+        for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+        return h;
+    }
+    static size_t hash_key(const std::string& s) {
+        uint32_t h = 2166136261u;
+        for (unsigned char c : s) h = (h ^ c) * 16777619u;
+        return h;
+    }
+    template <typename T>
+    static size_t hash_key(const T& key) { return std::hash<T>{}(key); }
+
+    static size_t table_size_for(size_t count) {
+        size_t size = 8;
+        while (size * 3 < count * 4) size *= 2;
+        return size;
+    }
+
+    // Returns slot of the key or NOT_FOUND
+    template <typename KeyLike>
+    uint32_t find_slot(const KeyLike& key, size_t hash) const {
+        if (m_slots.empty()) return NOT_FOUND;
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            uint32_t index = m_slots[i];
+            if (index == EMPTY) return NOT_FOUND;
+            const Entry& e = m_entries[index];
+            if (e.hash == hash && !e.erased && e.key == key) return (uint32_t)i;
+        }
+    }
+
+    V& insert(const K& key, size_t hash) {
+        uint32_t slot = find_slot(key, hash);
+        if (slot != NOT_FOUND) return m_entries[m_slots[slot]].value;
+        return insert_new(key, hash);
+    }
+
+    V& insert_new(K&& key, size_t hash) {
+        reserve_one();
+        m_entries.push_back(Entry{std::move(key), V{}, hash, false});
+        place((uint32_t)(m_entries.size() - 1));
+        m_size++;
+        return m_entries.back().value;
+    }
+    V& insert_new(const K& key, size_t hash) { return insert_new(K(key), hash); }
+
+    // Make sure there is space for one more entry, tombstones are counted as used slots
+    void reserve_one() {
+        if ((m_entries.size() + 1) * 4 <= m_slots.size() * 3) return;
+        rebuild(table_size_for((m_size + 1) * 2)); // erased entries are removed, so the table might not grow
+    }
+
+    // Put entry index to the first empty slot
+    void place(uint32_t index) {
+        size_t mask = m_slots.size() - 1;
+        size_t i = m_entries[index].hash & mask;
+        while (m_slots[i] != EMPTY) i = (i + 1) & mask;
+        m_slots[i] = index;
+    }
+
+    // Remove erased entries and rebuild the table with given size
+    void rebuild(size_t tableSize) {
+        if (m_entries.size() != m_size) {
+            size_t j = 0;
+            for (size_t i = 0; i < m_entries.size(); i++) {
+                if (m_entries[i].erased) continue;
+                if (i != j) m_entries[j] = std::move(m_entries[i]);
+                j++;
+            }
+            m_entries.resize(j);
+        }
+        m_slots.assign(tableSize, EMPTY);
+        for (uint32_t i = 0; i < m_entries.size(); i++)
+            place(i);
+    }
+};
+
+#endif
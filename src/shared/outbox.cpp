@@ -0,0 +1,465 @@
+#include "outbox.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "shared.h"
+#if COD2X_WIN32
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#include "cod2_common.h"
+#include "cod2_dvars.h"
+#include "cod2_cmd.h"
+#include "http_client.h"
+#include "logger.h"
+
+// Durable outbox for HTTP requests that must reach the server (match uploads).
+// Requests are stored in append-only file fs_homepath/outbox.dat and sent by a worker thread
+// with exponential backoff, so they survive map changes, shutdowns and server restarts.
+//
+// File records:
+//   "A <id>\n" method, url, headers, body, key   - request added (strings are "<len>\n<data>\n")
+//   "D <id>\n"                                    - request delivered or dropped
+
+#define OUTBOX_FILE                 "outbox.dat"
+#define OUTBOX_TIMEOUT_MS           10000
+#define OUTBOX_BACKOFF_MIN_MS       1000
+#define OUTBOX_BACKOFF_MAX_MS       (5 * 60 * 1000)
+#define OUTBOX_IDLE_MS              200
+
+struct OutboxEntry {
+    uint64_t id;
+    std::string method;
+    std::string url;
+    std::string headers;
+    std::string body;
+    std::string key;        // newer request with the same key replaces the older one
+    int attempts = 0;
+    uint64_t nextAttempt = 0;
+    bool sending = false;
+};
+
+static struct {
+    std::vector<OutboxEntry> entries;
+    std::string path;
+    uint64_t lastId;
+    uint64_t delivered;
+    uint64_t dropped;
+    std::atomic<int> generation; // worker runs while its generation is current
+    bool running;
+    bool initialized;
+    bool suspended;         // new requests are not saved, used while the network benchmark runs
+    #if COD2X_WIN32
+        CRITICAL_SECTION cs;
+    #else
+        pthread_mutex_t cs;
+    #endif
+} outbox;
+
+
+static void outbox_lock() {
+    #if COD2X_WIN32
+        EnterCriticalSection(&outbox.cs);
+    #else
+        pthread_mutex_lock(&outbox.cs);
+    #endif
+}
+
+static void outbox_unlock() {
+    #if COD2X_WIN32
+        LeaveCriticalSection(&outbox.cs);
+    #else
+        pthread_mutex_unlock(&outbox.cs);
+    #endif
+}
+
+static void outbox_sleep(int ms) {
+    #if COD2X_WIN32
+        Sleep(ms);
+    #else
+        usleep(ms * 1000);
+    #endif
+}
+
+
+static void outbox_writeString(FILE* f, const std::string& s) {
+    fprintf(f, "%u\n", (unsigned)s.size());
+    fwrite(s.data(), 1, s.size(), f);
+    fputc('\n', f);
+}
+
+static bool outbox_readString(FILE* f, std::string& s) {
+    unsigned int len = 0;
+    if (fscanf(f, "%u", &len) != 1 || fgetc(f) != '\n' || len > 64 * 1024 * 1024)
+        return false;
+    s.resize(len);
+    if (len > 0 && fread(&s[0], 1, len, f) != len)
+        return false;
+    return fgetc(f) == '\n';
+}
+
+static void outbox_writeEntry(FILE* f, const OutboxEntry& e) {
+    fprintf(f, "A %llu\n", (unsigned long long)e.id);
+    outbox_writeString(f, e.method);
+    outbox_writeString(f, e.url);
+    outbox_writeString(f, e.headers);
+    outbox_writeString(f, e.body);
+    outbox_writeString(f, e.key);
+}
+
+// Write buffered data of the file to the disk. Returns false on error.
+static bool outbox_sync(FILE* f) {
+    bool ok = fflush(f) == 0 && ferror(f) == 0;
+    #if COD2X_WIN32
+        ok = ok && _commit(_fileno(f)) == 0;
+    #else
+        ok = ok && fsync(fileno(f)) == 0;
+    #endif
+    return ok;
+}
+
+// Append a record to the file, it is on the disk when the function returns. Must be called with the lock held.
+static void outbox_appendEntry(const OutboxEntry& e) {
+    FILE* f = fopen(outbox.path.c_str(), "ab");
+    if (!f) return;
+    outbox_writeEntry(f, e);
+    if (!outbox_sync(f))
+        Com_Printf("Outbox: request %llu could not be written to %s\n", (unsigned long long)e.id, outbox.path.c_str());
+    fclose(f);
+}
+
+// Mark the request as done. Must be called with the lock held.
+static void outbox_appendDone(uint64_t id) {
+    // Nothing left, start with clean file
+    if (outbox.entries.empty()) {
+        remove(outbox.path.c_str());
+        return;
+    }
+    FILE* f = fopen(outbox.path.c_str(), "ab");
+    if (!f) return;
+    fprintf(f, "D %llu\n", (unsigned long long)id);
+    fclose(f);
+}
+
+// Load pending requests from the file and rewrite it without delivered ones
+static void outbox_load() {
+    FILE* f = fopen(outbox.path.c_str(), "rb");
+    if (!f) return;
+
+    char type;
+    unsigned long long id;
+    // Stops on the first incomplete record, which can happen if the process was killed while writing
+    while (fscanf(f, "%c %llu", &type, &id) == 2 && fgetc(f) == '\n') {
+        if (type == 'A') {
+            OutboxEntry e;
+            e.id = id;
+            if (!outbox_readString(f, e.method) || !outbox_readString(f, e.url) || !outbox_readString(f, e.headers) ||
+                !outbox_readString(f, e.body) || !outbox_readString(f, e.key))
+                break;
+            outbox.entries.push_back(std::move(e));
+        } else if (type == 'D') {
+            for (auto it = outbox.entries.begin(); it != outbox.entries.end(); ++it) {
+                if (it->id == id) { outbox.entries.erase(it); break; }
+            }
+        } else {
+            break;
+        }
+        if (id > outbox.lastId) outbox.lastId = id;
+    }
+    fclose(f);
+
+    // Nothing left, start with clean file
+    if (outbox.entries.empty()) {
+        remove(outbox.path.c_str());
+        return;
+    }
+
+    // Compact the file, the old file is replaced atomically only when the new one is written to the disk
+    std::string tmp = outbox.path + ".tmp";
+    f = fopen(tmp.c_str(), "wb");
+    if (!f) return;
+    for (const auto& e : outbox.entries)
+        outbox_writeEntry(f, e);
+    bool ok = outbox_sync(f);
+    ok = fclose(f) == 0 && ok;
+
+    #if COD2X_WIN32
+        ok = ok && MoveFileExA(tmp.c_str(), outbox.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    #else
+        ok = ok && rename(tmp.c_str(), outbox.path.c_str()) == 0;
+    #endif
+    if (!ok)
+        remove(tmp.c_str());
+}
+
+
+// Send the request and wait for the result. Returns HTTP status, 0 on network error, -1 if the worker is stopping.
+static int outbox_send(HttpClient& client, const OutboxEntry& e, int generation, std::string& error) {
+    struct Result { bool done = false; int status = 0; std::string error; };
+    auto result = std::make_shared<Result>();
+
+    // Server can use the id to ignore duplicates, the request may be delivered, but the response lost
+    std::string headers = e.headers;
+    if (!headers.empty()) headers += "\r\n";
+    headers += "X-CoD2x-Outbox-Id: " + std::to_string(e.id);
+
+    client.request(e.method.c_str(), e.url.c_str(), e.body.c_str(), headers.c_str(),
+        [result](const HttpClient::Response& res) {
+            result->done = true;
+            result->status = res.status;
+            if (res.status < 200 || res.status >= 300)
+                result->error = "Invalid status " + std::to_string(res.status);
+        },
+        [result](const std::string& err) {
+            result->done = true;
+            result->error = err;
+        },
+        OUTBOX_TIMEOUT_MS);
+
+    while (!result->done) {
+        if (outbox.generation != generation)
+            return -1;
+        client.poll(50);
+    }
+    error = result->error;
+    return result->status;
+}
+
+static void outbox_worker(int generation) {
+    HttpClient client;
+
+    while (outbox.generation == generation) {
+
+        // Find the oldest request that is ready to be sent
+        OutboxEntry entry;
+        bool found = false;
+        outbox_lock();
+        uint64_t now = ticks_ms();
+        for (auto& e : outbox.entries) {
+            if (!e.sending && e.nextAttempt <= now) {
+                e.sending = true;
+                entry = e;
+                found = true;
+                break;
+            }
+        }
+        bool finished = !found && outbox.entries.empty() && outbox.generation == generation;
+        if (finished)
+            outbox.running = false; // nothing to do, outbox_add will start new worker
+        outbox_unlock();
+
+        if (!found) {
+            if (finished) break;
+            outbox_sleep(OUTBOX_IDLE_MS);
+            continue;
+        }
+
+        std::string error;
+        int status = outbox_send(client, entry, generation, error);
+
+        outbox_lock();
+        for (auto it = outbox.entries.begin(); it != outbox.entries.end(); ++it) {
+            if (it->id != entry.id) continue; // might be replaced by newer request meanwhile
+
+            it->sending = false;
+            if (status < 0)
+                break; // stopping, will be sent next time
+
+            // Delivered, or rejected by server and repeating would not help
+            bool delivered = status >= 200 && status < 300;
+            bool rejected = status >= 400 && status < 500 && status != 408 && status != 429;
+            if (delivered || rejected) {
+                if (delivered) outbox.delivered++;
+                else           outbox.dropped++;
+                logger_add("Outbox: request %llu to %s %s (%s)", (unsigned long long)entry.id, entry.url.c_str(),
+                    delivered ? "delivered" : "dropped", delivered ? "ok" : error.c_str());
+                outbox.entries.erase(it);
+                outbox_appendDone(entry.id);
+            } else {
+                it->attempts++;
+                uint64_t backoff = OUTBOX_BACKOFF_MIN_MS;
+                for (int i = 1; i < it->attempts && backoff < OUTBOX_BACKOFF_MAX_MS; i++)
+                    backoff *= 2;
+                if (backoff > OUTBOX_BACKOFF_MAX_MS) backoff = OUTBOX_BACKOFF_MAX_MS;
+                it->nextAttempt = ticks_ms() + backoff;
+            }
+            break;
+        }
+        outbox_unlock();
+    }
+}
+
+#if COD2X_WIN32
+static DWORD WINAPI outbox_workerThread(LPVOID arg) {
+    outbox_worker((int)(intptr_t)arg);
+    return 0;
+}
+#else
+static void* outbox_workerThread(void* arg) {
+    outbox_worker((int)(intptr_t)arg);
+    return NULL;
+}
+#endif
+
+// Remove pending requests with the key. Must be called with the lock held.
+static void outbox_removeKey(const char* key) {
+    for (auto it = outbox.entries.begin(); it != outbox.entries.end(); ) {
+        if (it->key == key) {
+            uint64_t id = it->id;
+            it = outbox.entries.erase(it);
+            outbox_appendDone(id);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Start the worker thread if not running. Must be called with the lock held.
+static void outbox_startWorker() {
+    if (outbox.running || outbox.entries.empty())
+        return;
+
+    int generation = ++outbox.generation;
+    outbox.running = true;
+
+    #if COD2X_WIN32
+        HANDLE thread = CreateThread(NULL, 0, outbox_workerThread, (LPVOID)(intptr_t)generation, 0, NULL);
+        if (thread) CloseHandle(thread);
+        else outbox.running = false;
+    #else
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, outbox_workerThread, (void*)(intptr_t)generation) == 0) pthread_detach(thread);
+        else outbox.running = false;
+    #endif
+}
+
+
+/**
+ * Add a request to the outbox. The request is saved to the disk and sent by the worker thread.
+ * @param method  HTTP method, for example "POST".
+ * @param url     URL to send the request to.
+ * @param headers Headers separated by \r\n, without the trailing \r\n.
+ * @param body    Request body.
+ * @param key     Optional key, pending request with the same key is replaced (for example full match data snapshot).
+ */
+void outbox_add(const char* method, const char* url, const std::string& headers, const std::string& body, const char* key) {
+    if (!outbox.initialized || outbox.suspended)
+        return;
+
+    outbox_lock();
+
+    if (key && key[0]) {
+        outbox_removeKey(key);
+    }
+
+    OutboxEntry e;
+    e.id = ++outbox.lastId;
+    e.method = method;
+    e.url = url;
+    e.headers = headers;
+    while (!e.headers.empty() && (e.headers.back() == '\n' || e.headers.back() == '\r'))
+        e.headers.pop_back();
+    e.body = body;
+    e.key = key ? key : "";
+    outbox_appendEntry(e);
+    outbox.entries.push_back(std::move(e));
+
+    outbox_startWorker();
+
+    outbox_unlock();
+}
+
+/** Remove pending requests with the key, for example when newer data was uploaded directly. */
+void outbox_remove(const char* key) {
+    if (!outbox.initialized || !key || !key[0])
+        return;
+
+    outbox_lock();
+    outbox_removeKey(key);
+    outbox_unlock();
+}
+
+/**
+ * Stop saving new requests, pending ones are still sent.
+ * Used by the network benchmark, so failed uploads to the temporary local server are not retried forever.
+ */
+void outbox_suspend(bool suspend) {
+    outbox.suspended = suspend;
+}
+
+/** Returns number of requests waiting to be delivered. */
+int outbox_count() {
+    if (!outbox.initialized)
+        return 0;
+    outbox_lock();
+    int count = (int)outbox.entries.size();
+    outbox_unlock();
+    return count;
+}
+
+
+void outbox_cmd_status() {
+    outbox_lock();
+    Com_Printf("Outbox: %i pending, %llu delivered, %llu dropped, worker %s\n", (int)outbox.entries.size(),
+        (unsigned long long)outbox.delivered, (unsigned long long)outbox.dropped, outbox.running ? "running" : "stopped");
+    uint64_t now = ticks_ms();
+    for (const auto& e : outbox.entries) {
+        Com_Printf("  #%llu %s %s (%u bytes, attempts: %i, next in %llds)\n", (unsigned long long)e.id, e.method.c_str(), e.url.c_str(),
+            (unsigned)e.body.size(), e.attempts, e.nextAttempt > now ? (long long)((e.nextAttempt - now) / 1000) : 0LL);
+    }
+    outbox_unlock();
+}
+
+
+/**
+ * Called before a map change, restart or shutdown that can be triggered from a script or a command.
+ * Returns true to proceed, false to cancel the operation. Return value is ignored when shutdown is true.
+ * @param fromScript true if map change was triggered from a script, false if from a command.
+ * @param bComplete true if map change or restart is complete, false if it's a round restart so persistent variables are kept.
+ * @param shutdown true if the server is shutting down, false otherwise.
+ * @param source the source of the map change or restart.
+ */
+bool outbox_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source) {
+
+    // Dont wait for the worker, pending requests are saved on the disk and sent after restart
+    if (shutdown && outbox.initialized) {
+        outbox_lock();
+        outbox.generation++;
+        outbox.running = false;
+        outbox_unlock();
+    }
+
+    return true;
+}
+
+
+/** Called only once on game start after common inicialization. Used to initialize variables, cvars, etc. */
+void outbox_init() {
+    #if COD2X_WIN32
+        InitializeCriticalSection(&outbox.cs);
+    #else
+        pthread_mutex_init(&outbox.cs, NULL);
+    #endif
+
+    outbox.path = std::string(Dvar_GetString("fs_homepath")) + WL("\\", "/") + OUTBOX_FILE;
+    outbox.lastId = time_utc_ms(); // unique across restarts
+    outbox.initialized = true;
+
+    outbox_lock();
+    outbox_load();
+    if (!outbox.entries.empty())
+        Com_Printf("Outbox: %i pending requests from previous run\n", (int)outbox.entries.size());
+    outbox_startWorker();
+    outbox_unlock();
+
+    Cmd_AddCommand("outboxStatus", outbox_cmd_status);
+}
@@ -0,0 +1,15 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <string>
+
+#include "server.h"
+
+void outbox_add(const char* method, const char* url, const std::string& headers, const std::string& body, const char* key = nullptr);
+void outbox_remove(const char* key);
+void outbox_suspend(bool suspend);
+int outbox_count();
+bool outbox_beforeMapChangeOrRestart(bool fromScript, bool bComplete, bool shutdown, sv_map_change_source_e source);
+void outbox_init();
+
+#endif
@@ -15,7 +15,14 @@
 #include "gsc_match.h"
 #include "gsc_http.h"
 #include "gsc_websocket.h"
+#include "gsc_file.h"
 #include "match.h"
+#include "event_server.h"
+#include "outbox.h"
+#include "log_writer.h"
+#include "event_log.h"
+#include "spatial.h"
+#include "entity_index.h"
 #if COD2X_WIN32
 #include "../mss32/updater.h"
 #endif
@@ -151,6 +158,10 @@ void SV_UserinfoChanged( client_t *cl )
 	// wwwdl command
 	val = Info_ValueForKey (cl->userinfo, "cl_wwwDownload");
 	cl->wwwOk = atoi(val) > 0;
+
+	// CoD2x: match identity will be resolved again from the new userinfo
+	match_client_changed(cl - svs_clients);
+	// CoD2x: end
 }
 
 void SV_UserinfoChanged_Win32() {
@@ -878,6 +889,17 @@ void SV_ClientBegin_Linux(int clientNum) {
 }
 
 
+// Function called when a player is spawned or respawned, including spectators
+void ClientSpawn(gentity_t* ent, float* origin, float* angles) {
+    // Call the original function
+    ASM_CALL(RETURN_VOID, ADDR(0x004fe4b0, 0x080f910e), 3, PUSH(ent), PUSH(origin), PUSH(angles));
+
+    // Classname is changed to "player" and the player is moved to the spawn point
+    entity_index_update(ent->s.number);
+    spatial_invalidate();
+}
+
+
 
 
 /**
@@ -902,8 +924,13 @@ bool server_beforeMapChangeOrRestart(bool isShutdown, sv_map_change_source_e sou
 	if (!gsc_match_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false; // must be called first, because it can block the map change/restart
 	if (!gsc_http_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
 	if (!gsc_websocket_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
+	if (!gsc_file_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
 	if (!gsc_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;	
 	if (!match_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
+	if (!event_server_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
+	if (!event_log_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
+	if (!outbox_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
+	if (!log_writer_beforeMapChangeOrRestart(fromScript, bComplete, isShutdown, source)) return false;
 
 	return true;
 }
@@ -1000,33 +1027,25 @@ void G_RunFrame(int time) {
 
 	server_ignoreMapChangeThisFrame = false;
 
-	if (sv_playerBroadcastLimit->value.integer > 0) {
+	// Update spatial index of players, used by script queries in the next frame and by the broadcast below
+	spatial_rebuild();
 
-		// Count number of players
-		int numPlayers = 0;
-		for (int i = 0; i < MAX_GENTITIES; i++)
-		{
-			gentity_t* ent = &g_entities[i];
-			if (ent->client && ent->r.inuse && ent->s.eType == ET_PLAYER)
-			{
-				numPlayers++;
-			}
-		}
+	if (sv_playerBroadcastLimit->value.integer > 0) {
 
 		// If there are less than 15 players, send all players to all clients
 		// This is to prevent sending too many players to clients when there are many players, which can cause performance issues
-		if (numPlayers <= sv_playerBroadcastLimit->value.integer)
+		if (spatial_players.count <= sv_playerBroadcastLimit->value.integer)
 		{
-			// Loop all gentities and set broadcastTime that will force to send info about all clients to all players
+			// Loop all players and set broadcastTime that will force to send info about all clients to all players
 			// The game by default sends only "visible" (related to portaling / PVS) entities to the clients.
 			// It make sense to not send data about players if the player is not visible, but that is causing issues with sounds - player's sounds (shooting, footsteps, etc.) are not heard by other players if they are not visible.
 			// The game internally uses broadcastTime to determine if the entity should be sent to the client, we will use it to force sending all players to all clients.
-			for (int i = 0; i < MAX_GENTITIES; i++)
+			for (int i = 0; i < spatial_players.count; i++)
 			{
-				gentity_t* ent = &g_entities[i];
-				if (ent->client && ent->r.inuse && ent->s.eType == ET_PLAYER && ent->health > 0)
+				const SpatialEntry& e = spatial_players.entries[i];
+				if (e.alive)
 				{
-					ent->r.broadcastTime = svs_time + 1; // if we keep broadcastTime bigger then svs.time, the client will be sent to all other clients
+					g_entities[e.entnum].r.broadcastTime = svs_time + 1; // if we keep broadcastTime bigger then svs.time, the client will be sent to all other clients
 				}
 			}
 		}
@@ -1115,6 +1134,12 @@ void server_patch()
     // Hook the SV_ClientBegin function
     patch_call(ADDR(0x00454d12, 0x0808f6ee), (unsigned int)ADDR(SV_ClientBegin_Win32, SV_ClientBegin_Linux));
 
+    // Hook the ClientSpawn function
+    patch_call(ADDR(0x0050104c, 0x080f7633), (unsigned int)ClientSpawn); // respawn / spectator
+    patch_call(ADDR(0x0052cc33, 0x080fcbbe), (unsigned int)ClientSpawn); // script method spawn()
+
+    spatial_patch();
+
 
 	// Hook the G_RunFrame function
     patch_call(ADDR(0x0045c1ff, 0x08096765), (unsigned int)ADDR(G_RunFrame_Win32, G_RunFrame)); // SV_RunFrame
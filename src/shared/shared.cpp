@@ -2,6 +2,7 @@
 
 #include <cstdio>
 #include <cctype>
+#include <emmintrin.h>
 
 #if defined(_WIN32)
   #include <windows.h>
@@ -9,6 +10,8 @@
   #include <time.h>
 #endif
 
+bool cpu_sse2 = (__builtin_cpu_init(), __builtin_cpu_supports("sse2"));
+
 /*
  * Compares two version strings.
  * Versions are expected in the format: "1.4.4.2" or "1.4.4.2-test.1".
@@ -124,7 +127,8 @@ int version_compare(const char *v1, const char *v2, bool* firstIsPrerelease, boo
 }
 
 
-void escape_string(char* buffer, size_t bufferSize, const void* data, size_t length) {
+// Scalar version of escape_string, used when SSE2 is not available
+void escape_string_scalar(char* buffer, size_t bufferSize, const void* data, size_t length) {
     // Loop through the data char by char and escape invisible characters into buffer
     size_t buffer_index = 0;
     for (size_t i = 0; i < length && buffer_index < (size_t)(bufferSize - 5); i++) { // Reserve 5 bytes for worst-case scenario
@@ -159,6 +163,74 @@ void escape_string(char* buffer, size_t bufferSize, const void* data, size_t len
     buffer[buffer_index] = '\0'; // Ensure null termination
 }
 
+// Returns number of printable characters (32-126) from the start of data. Checks 16 characters at once.
+__attribute__((target("sse2")))
+static size_t escape_string_scan_sse2(const unsigned char* data, size_t length) {
+    const __m128i offset = _mm_set1_epi8(32);
+    const __m128i range = _mm_set1_epi8(126 - 32);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(data + i)), offset);
+        int printable = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, range), v)); // c - 32 <= 94
+        if (printable != 0xFFFF)
+            return i + __builtin_ctz(~printable);
+    }
+    while (i < length && data[i] >= 32 && data[i] <= 126)
+        i++;
+    return i;
+}
+
+// SSE2 version of escape_string
+// Runs of printable characters are found 16 bytes at once and copied in bulk
+__attribute__((target("sse2")))
+void escape_string_sse2(char* buffer, size_t bufferSize, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    const size_t limit = bufferSize - 5; // Reserve 5 bytes for worst-case scenario
+    size_t buffer_index = 0;
+    size_t i = 0;
+    while (i < length && buffer_index < limit) {
+        size_t run = escape_string_scan_sse2(bytes + i, length - i);
+        if (run > 0) {
+            if (run > limit - buffer_index)
+                run = limit - buffer_index;
+            memcpy(&buffer[buffer_index], bytes + i, run);
+            buffer_index += run;
+            i += run;
+            continue;
+        }
+
+        unsigned char c = bytes[i++];
+        switch (c) {
+            case '\n':
+                buffer[buffer_index++] = '\\';
+                buffer[buffer_index++] = 'n';
+                break;
+            case '\r':
+                buffer[buffer_index++] = '\\';
+                buffer[buffer_index++] = 'r';
+                break;
+            case '\t':
+                buffer[buffer_index++] = '\\';
+                buffer[buffer_index++] = 't';
+                break;
+            default:
+                snprintf(&buffer[buffer_index], 5, "\\x%02X", c);
+                buffer_index += 4;
+                break;
+        }
+    }
+    buffer[buffer_index] = '\0'; // Ensure null termination
+}
+
+// Escape invisible characters in data into buffer, result is always null-terminated and truncated if buffer is too small
+void escape_string(char* buffer, size_t bufferSize, const void* data, size_t length) {
+    if (cpu_sse2)
+        escape_string_sse2(buffer, bufferSize, data, length);
+    else
+        escape_string_scalar(buffer, bufferSize, data, length);
+}
+
 // CRC16-CCITT (poly 0x1021, initial value 0xFFFF)
 uint16_t crc16_ccitt(const uint8_t* data, size_t length)
 {
@@ -80,8 +80,12 @@
 #include "assembly.h"
 #include "logger.h"
 
+extern bool cpu_sse2; // CPU supports SSE2, used to choose faster code paths
+
 int version_compare(const char *v1, const char *v2, bool* firstIsPrerelease = nullptr, bool* secondIsPrerelease = nullptr);
 void escape_string(char* buffer, size_t bufferSize, const void* data, size_t length);
+void escape_string_scalar(char* buffer, size_t bufferSize, const void* data, size_t length);
+void escape_string_sse2(char* buffer, size_t bufferSize, const void* data, size_t length);
 uint16_t crc16_ccitt(const uint8_t* data, size_t length);
 int base64_encode(const uint8_t* input, size_t len, char* output, size_t out_size);
 int base64_decode(const char* input, uint8_t* output, size_t out_size);
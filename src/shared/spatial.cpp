@@ -0,0 +1,195 @@
+#include "spatial.h"
+
+#include <cmath>
+
+#include "shared.h"
+#include "cod2_entity.h"
+
+// Spatial index of players.
+// The grid is rebuilt once per server frame after G_RunFrame, so scripts in the next frame see positions
+// that were sent to the clients. Players that walk are covered by SPATIAL_MARGIN, but spawn or teleport
+// (ClientSpawn, setOrigin, origin field) can move the player anywhere, so the grid is marked as dirty and rebuilt
+// by the next query. Queries check the current entity state, the grid is only used to skip far players.
+
+SpatialGrid spatial_players;
+
+
+static inline int spatial_cell(float value) {
+	return (int)floorf(value / SPATIAL_CELL_SIZE);
+}
+
+static inline int spatial_bucket(int cx, int cy) {
+	return (int)(((unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u) & (SPATIAL_BUCKETS - 1));
+}
+
+// Returns true if the entity is a player that can be returned by queries
+static inline bool spatial_is_alive_player(gentity_t* ent) {
+	return ent->client && ent->r.inuse && ent->s.eType == ET_PLAYER && ent->health > 0;
+}
+
+/** Rebuild the grid from current player entities. Called once per server frame. */
+void spatial_rebuild() {
+	SpatialGrid& grid = spatial_players;
+	grid.count = 0;
+	grid.aliveCount = 0;
+	grid.dirty = false;
+	for (int i = 0; i < SPATIAL_BUCKETS; i++)
+		grid.buckets[i] = -1;
+
+	// Players are always the first MAX_CLIENTS entities
+	for (int i = 0; i < MAX_CLIENTS; i++) {
+		gentity_t* ent = &g_entities[i];
+		if (!ent->client || !ent->r.inuse || ent->s.eType != ET_PLAYER)
+			continue;
+
+		int index = grid.count++;
+		SpatialEntry& e = grid.entries[index];
+		e.entnum = i;
+		e.alive = ent->health > 0;
+		VectorCopy(ent->r.currentOrigin, e.origin);
+		e.visited = 0;
+
+		int bucket = spatial_bucket(spatial_cell(e.origin[0]), spatial_cell(e.origin[1]));
+		e.next = grid.buckets[bucket];
+		grid.buckets[bucket] = index;
+
+		if (e.alive) grid.aliveCount++;
+	}
+}
+
+/** Mark the grid as outdated, player was moved to a new position. The next query rebuilds the grid. */
+void spatial_invalidate() {
+	spatial_players.dirty = true;
+}
+
+static inline void spatial_sync() {
+	if (spatial_players.dirty)
+		spatial_rebuild();
+}
+
+// Call fn(entnum, distanceSquared) for each alive player within the radius
+template <typename Fn>
+static void spatial_query(const vec3_t origin, float radius, int ignoreEntnum, Fn fn) {
+	if (!(radius > 0))
+		return; // NaN or non-positive radius
+
+	spatial_sync();
+	SpatialGrid& grid = spatial_players;
+	if (grid.count == 0)
+		return;
+
+	float radiusSq = radius * radius;
+	unsigned int stamp = ++grid.stamp;
+
+	auto check = [&](SpatialEntry& e) {
+		if (e.visited == stamp) return;
+		e.visited = stamp;
+		if (e.entnum == ignoreEntnum) return;
+
+		// Player might be killed or respawned since the grid was built
+		gentity_t* ent = &g_entities[e.entnum];
+		if (!spatial_is_alive_player(ent)) return;
+
+		vec3_t diff;
+		VectorSubtract(ent->r.currentOrigin, origin, diff);
+		float distSq = VectorLengthSquared(diff);
+		if (distSq <= radiusSq)
+			fn(e.entnum, distSq);
+	};
+
+	// Cells are computed in double, huge radius or origin does not fit into int
+	double search = (double)radius + SPATIAL_MARGIN;
+	double minX = floor((origin[0] - search) / SPATIAL_CELL_SIZE), maxX = floor((origin[0] + search) / SPATIAL_CELL_SIZE);
+	double minY = floor((origin[1] - search) / SPATIAL_CELL_SIZE), maxY = floor((origin[1] + search) / SPATIAL_CELL_SIZE);
+
+	// Large radius covers more cells than there are buckets, check all players directly (also for NaN origin)
+	bool inRange = fabs(minX) < 1e9 && fabs(maxX) < 1e9 && fabs(minY) < 1e9 && fabs(maxY) < 1e9;
+	if (!inRange || (maxX - minX + 1) * (maxY - minY + 1) >= SPATIAL_BUCKETS) {
+		for (int i = 0; i < grid.count; i++)
+			check(grid.entries[i]);
+		return;
+	}
+
+	for (int cx = (int)minX; cx <= (int)maxX; cx++) {
+		for (int cy = (int)minY; cy <= (int)maxY; cy++) {
+			for (int i = grid.buckets[spatial_bucket(cx, cy)]; i != -1; i = grid.entries[i].next)
+				check(grid.entries[i]);
+		}
+	}
+}
+
+/**
+ * Find alive players within the radius, sorted from the nearest.
+ * Returns number of entity numbers written to result.
+ */
+int spatial_players_in_radius(const vec3_t origin, float radius, int ignoreEntnum, int* result, int maxResults) {
+	float distances[MAX_CLIENTS];
+	int count = 0;
+
+	spatial_query(origin, radius, ignoreEntnum, [&](int entnum, float distSq) {
+		if (count >= maxResults || count >= MAX_CLIENTS) return;
+		// Insertion sort, there are max 64 players
+		int i = count++;
+		while (i > 0 && distances[i - 1] > distSq) {
+			distances[i] = distances[i - 1];
+			result[i] = result[i - 1];
+			i--;
+		}
+		distances[i] = distSq;
+		result[i] = entnum;
+	});
+
+	return count;
+}
+
+/**
+ * Find the nearest alive player within maxRadius, if maxRadius is 0 or less the distance is not limited.
+ * Returns entity number or -1 if there is no such player.
+ */
+int spatial_nearest_player(const vec3_t origin, float maxRadius, int ignoreEntnum) {
+	int nearest = -1;
+	float nearestSq = 0;
+
+	// Without limit, all players are checked
+	if (maxRadius <= 0) {
+		spatial_sync();
+		SpatialGrid& grid = spatial_players;
+		for (int i = 0; i < grid.count; i++) {
+			const SpatialEntry& e = grid.entries[i];
+			gentity_t* ent = &g_entities[e.entnum];
+			if (e.entnum == ignoreEntnum || !spatial_is_alive_player(ent)) continue;
+			vec3_t diff;
+			VectorSubtract(ent->r.currentOrigin, origin, diff);
+			float distSq = VectorLengthSquared(diff);
+			if (nearest == -1 || distSq < nearestSq) {
+				nearest = e.entnum;
+				nearestSq = distSq;
+			}
+		}
+		return nearest;
+	}
+
+	spatial_query(origin, maxRadius, ignoreEntnum, [&](int entnum, float distSq) {
+		if (nearest == -1 || distSq < nearestSq) {
+			nearest = entnum;
+			nearestSq = distSq;
+		}
+	});
+	return nearest;
+}
+
+
+
+// Setter of the origin field of entities, e.g. player.origin = (0, 0, 0)
+static void spatial_setOriginField(gentity_t* ent, int index) {
+	ASM_CALL(RETURN_VOID, ADDR(0x0050d3e0, 0x08117e62), 2, PUSH(ent), PUSH(index));
+
+	if (ent->client)
+		spatial_invalidate();
+}
+
+/** Called before the entry point is called. Used to patch the memory. */
+void spatial_patch() {
+	// Setter in the entity field table, entry "origin"
+	patch_int32(ADDR(0x005a13b4, 0x0815e83c), (int32_t)spatial_setOriginField);
+}
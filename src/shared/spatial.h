@@ -0,0 +1,38 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "cod2_math.h"
+#include "cod2_server.h"
+
+#define SPATIAL_CELL_SIZE	512		// size of one grid cell in units
+#define SPATIAL_BUCKETS		256		// number of hash buckets, power of 2
+#define SPATIAL_MARGIN		64		// extra distance searched around the query, players might walk after the grid was built
+
+// Player stored in the grid
+struct SpatialEntry {
+	int entnum;
+	bool alive;
+	vec3_t origin;				// origin when the grid was built
+	int next;					// next entry in the same bucket or -1
+	unsigned int visited;		// query stamp, so entry is not checked twice when more cells share a bucket
+};
+
+// Uniform grid over X/Y plane, cells are hashed into buckets so the grid does not depend on the map size
+struct SpatialGrid {
+	int count;						// number of players in the grid (including dead)
+	int aliveCount;
+	bool dirty;						// player was spawned or teleported since the grid was built
+	SpatialEntry entries[MAX_CLIENTS];
+	int buckets[SPATIAL_BUCKETS];	// first entry in the bucket or -1
+	unsigned int stamp;
+};
+
+extern SpatialGrid spatial_players;
+
+void spatial_rebuild();
+void spatial_invalidate();
+int spatial_players_in_radius(const vec3_t origin, float radius, int ignoreEntnum, int* result, int maxResults);
+int spatial_nearest_player(const vec3_t origin, float maxRadius, int ignoreEntnum);
+void spatial_patch();
+
+#endif
@@ -0,0 +1,257 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <memory>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include "mongoose/mongoose.h"
+#undef poll
+
+
+// Wrapper around a Mongoose WebSocket SERVER used for pushing messages to subscribers
+// - Clients connect via ws://host:port/<path>
+// - Messages are serialized once and shared between subscribers (no per-subscriber copies)
+// - Every subscriber has its own queue and drop policy for slow consumers
+// - Poll-driven: call poll(ms) regularly
+
+class WebSocketServer {
+  public:
+    // Message shared by all subscribers
+    using Message = std::shared_ptr<const std::string>;
+
+    // What to do when subscriber's queue is full
+    enum DropPolicy {
+        DROP_OLDEST,  // remove the oldest queued message to make space for the new one
+        DROP_NEWEST,  // ignore the new message
+        DISCONNECT,   // close the connection of the slow subscriber
+    };
+
+    struct Subscriber {
+        mg_connection* conn = nullptr;
+        std::string remote;
+        std::deque<Message> queue;
+        DropPolicy policy = DROP_OLDEST;
+        size_t queueLimit = 0;
+        uint64_t sent = 0;
+        uint64_t dropped = 0;
+    };
+
+    using OnSubscribe = std::function<void(const Subscriber&)>;
+    using OnUnsubscribe = std::function<void(const Subscriber&)>;
+
+
+    /**
+     * Constructs a WebSocketServer instance.
+     * @param path URI path clients needs to connect to, for example "/events".
+     * @param token Optional token that clients must provide via ?token=... query, empty to disable.
+     * @param queue_limit Default max number of queued messages per subscriber, can be lowered by the client via ?queue=...
+     * @param send_watermark Max bytes waiting in socket send buffer before messages are kept in the queue.
+     */
+    WebSocketServer(std::string path = "/", std::string token = "", size_t queue_limit = 256, size_t send_watermark = 64 * 1024) {
+        m_path = std::move(path);
+        m_token = std::move(token);
+        m_queueLimit = queue_limit > 0 ? queue_limit : 1;
+        m_sendWatermark = send_watermark;
+
+        mg_log_set(MG_LL_NONE);
+        mg_mgr_init(&m_mgr);
+    }
+
+    ~WebSocketServer() {
+        close();
+        mg_mgr_free(&m_mgr);
+    }
+
+    // Start listening on URL, for example "http://0.0.0.0:8090"
+    bool listen(const std::string& url) {
+        close();
+        m_listener = mg_http_listen(&m_mgr, url.c_str(), &WebSocketServer::s_ev, this);
+        return m_listener != nullptr;
+    }
+
+    // Stop listening and disconnect all subscribers
+    void close() {
+        if (m_listener) {
+            m_listener->is_closing = 1;
+            m_listener = nullptr;
+        }
+        for (auto& it : m_subs) {
+            mg_ws_send(it.second.conn, "", 0, WEBSOCKET_OP_CLOSE);
+            it.second.conn->is_draining = 1;
+        }
+    }
+
+    // Drive networking. Call this from your main loop.
+    void poll(int ms = 0) {
+        mg_mgr_poll(&m_mgr, ms);
+    }
+
+    // Queue message for all subscribers. The message is not copied per subscriber.
+    void broadcast(const Message& msg) {
+        if (!msg) return;
+        for (auto& it : m_subs) {
+            Subscriber& sub = it.second;
+            if (sub.conn->is_closing || sub.conn->is_draining)
+                continue;
+
+            if (sub.queue.size() >= sub.queueLimit) {
+                sub.dropped++;
+                if (sub.policy == DROP_NEWEST) {
+                    continue;
+                } else if (sub.policy == DISCONNECT) {
+                    sub.queue.clear();
+                    mg_ws_send(sub.conn, "", 0, WEBSOCKET_OP_CLOSE);
+                    sub.conn->is_draining = 1;
+                    continue;
+                }
+                sub.queue.pop_front(); // DROP_OLDEST
+            }
+            sub.queue.push_back(msg);
+            flush(sub);
+        }
+    }
+
+    // Callbacks
+    void onSubscribe(OnSubscribe cb) { m_onSubscribe = std::move(cb); }
+    void onUnsubscribe(OnUnsubscribe cb) { m_onUnsubscribe = std::move(cb); }
+
+    // State
+    bool isListening() const { return m_listener != nullptr; }
+    size_t subscriberCount() const { return m_subs.size(); }
+    const std::unordered_map<unsigned long, Subscriber>& subscribers() const { return m_subs; }
+
+    static const char* policyToString(DropPolicy policy) {
+        switch (policy) {
+            case DROP_OLDEST: return "drop_oldest";
+            case DROP_NEWEST: return "drop_newest";
+            case DISCONNECT:  return "disconnect";
+            default:          return "unknown";
+        }
+    }
+
+  private:
+    // Write queued messages into the socket while the send buffer is below the watermark
+    void flush(Subscriber& sub) {
+        while (!sub.queue.empty() && sub.conn->send.len < m_sendWatermark) {
+            const Message& msg = sub.queue.front();
+            mg_ws_send(sub.conn, msg->data(), msg->size(), WEBSOCKET_OP_TEXT);
+            sub.queue.pop_front();
+            sub.sent++;
+        }
+    }
+
+    // Static event handler
+    static void s_ev(mg_connection* c, int ev, void* ev_data) {
+        auto* self = static_cast<WebSocketServer*>(c->fn_data);
+        if (self)
+            self->handle_event(c, ev, ev_data);
+    }
+
+    // Instance event handler
+    void handle_event(mg_connection* c, int ev, void* ev_data) {
+        switch (ev) {
+        case MG_EV_HTTP_MSG: {
+            auto* hm = static_cast<mg_http_message*>(ev_data);
+
+            if (mg_strcmp(hm->uri, mg_str(m_path.c_str())) != 0) {
+                mg_http_reply(c, 404, "", "Not found\n");
+                break;
+            }
+
+            char buf[64];
+            if (!m_token.empty()) {
+                if (mg_http_get_var(&hm->query, "token", buf, sizeof(buf)) <= 0 || m_token != buf) {
+                    mg_http_reply(c, 403, "", "Forbidden\n");
+                    break;
+                }
+            }
+
+            // Subscriber options are parsed before the upgrade, because the HTTP message is not available later
+            Subscriber sub;
+            sub.conn = c;
+            sub.policy = DROP_OLDEST;
+            sub.queueLimit = m_queueLimit;
+            if (mg_http_get_var(&hm->query, "policy", buf, sizeof(buf)) > 0) {
+                if (strcmp(buf, "drop_newest") == 0)     sub.policy = DROP_NEWEST;
+                else if (strcmp(buf, "disconnect") == 0) sub.policy = DISCONNECT;
+            }
+            if (mg_http_get_var(&hm->query, "queue", buf, sizeof(buf)) > 0) {
+                long limit = atol(buf);
+                if (limit > 0 && (size_t)limit < m_queueLimit)
+                    sub.queueLimit = (size_t)limit;
+            }
+            char addr[64];
+            mg_snprintf(addr, sizeof(addr), "%M", mg_print_ip_port, &c->rem);
+            sub.remote = addr;
+
+            m_pending[c->id] = std::move(sub);
+            mg_ws_upgrade(c, hm, NULL);
+            break;
+        }
+
+        case MG_EV_WS_OPEN: {
+            auto it = m_pending.find(c->id);
+            if (it == m_pending.end())
+                break;
+            Subscriber& sub = m_subs[c->id];
+            sub = std::move(it->second);
+            m_pending.erase(it);
+            if (m_onSubscribe)
+                m_onSubscribe(sub);
+            break;
+        }
+
+        case MG_EV_WS_CTL: {
+            // Close received from remote: reply and close connection
+            auto* wm = static_cast<mg_ws_message*>(ev_data);
+            if ((wm->flags & 0x0F) == WEBSOCKET_OP_CLOSE) {
+                mg_ws_send(c, wm->data.buf, wm->data.len, WEBSOCKET_OP_CLOSE);
+                c->is_draining = 1;
+            }
+            break;
+        }
+
+        // Every poll - send the rest of the queue if the socket is writable again
+        case MG_EV_POLL: {
+            auto it = m_subs.find(c->id);
+            if (it != m_subs.end())
+                flush(it->second);
+            break;
+        }
+
+        case MG_EV_CLOSE: {
+            m_pending.erase(c->id);
+            auto it = m_subs.find(c->id);
+            if (it != m_subs.end()) {
+                if (m_onUnsubscribe)
+                    m_onUnsubscribe(it->second);
+                m_subs.erase(it);
+            }
+            if (c == m_listener)
+                m_listener = nullptr;
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    // State
+    mg_mgr m_mgr{};
+    mg_connection* m_listener{nullptr};
+    std::unordered_map<unsigned long, Subscriber> m_pending;
+    std::unordered_map<unsigned long, Subscriber> m_subs;
+
+    // Config
+    std::string m_path;
+    std::string m_token;
+    size_t m_queueLimit;
+    size_t m_sendWatermark;
+
+    // Callbacks
+    OnSubscribe m_onSubscribe;
+    OnUnsubscribe m_onUnsubscribe;
+};
@@ -0,0 +1,138 @@
+// Check that the SSE2 versions of json_escape_append and escape_string produce the same output as the scalar versions
+// and compare their speed. Runs outside of the game, the functions are called directly.
+// Build:  g++ -O2 -std=c++17 -I../../src/shared -o escape_check escape_check.cpp ../../src/shared/shared.cpp
+// Usage:  escape_check [iterations]
+// Returns 0 if all outputs are identical.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+
+#include "json.h"
+
+static int failures = 0;
+
+static std::string printable(const std::string& s) {
+    std::string out;
+    for (unsigned char c : s) {
+        char buf[8];
+        if (c >= 32 && c <= 126) out += (char)c;
+        else { snprintf(buf, sizeof(buf), "<%02X>", c); out += buf; }
+    }
+    return out;
+}
+
+static void check(const std::string& data) {
+    std::string scalar, sse2;
+    json_escape_append_scalar(scalar, data.data(), data.size());
+    json_escape_append_sse2(sse2, data.data(), data.size());
+    if (scalar != sse2) {
+        if (failures++ < 10)
+            printf("json_escape_append differs for \"%s\"\n  scalar: %s\n  sse2:   %s\n", printable(data).c_str(), scalar.c_str(), sse2.c_str());
+    }
+
+    // Buffer sizes around the 16 byte blocks and the reserved space for "\xNN"
+    static char bufScalar[1024], bufSse2[1024];
+    const size_t sizes[] = {5, 6, 7, 8, 9, 15, 16, 17, 20, 21, 22, 31, 32, 33, 37, 48, 64, 1024};
+    for (size_t size : sizes) {
+        memset(bufScalar, 0x55, sizeof(bufScalar));
+        memset(bufSse2, 0x55, sizeof(bufSse2));
+        escape_string_scalar(bufScalar, size, data.data(), data.size());
+        escape_string_sse2(bufSse2, size, data.data(), data.size());
+        if (strcmp(bufScalar, bufSse2) != 0 || memcmp(bufScalar, bufSse2, size) != 0) {
+            if (failures++ < 10)
+                printf("escape_string(size %u) differs for \"%s\"\n  scalar: %s\n  sse2:   %s\n", (unsigned)size, printable(data).c_str(), bufScalar, bufSse2);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+
+    // Every special character at every position of strings around the 16 byte blocks
+    const char specials[] = {'"', '\\', '\n', '\r', '\t', '\x01', '\x1f', ' ', '~', '\x7f', '\x80', '\xe9', '\xff', '\0'};
+    int checks = 0;
+    for (size_t len = 0; len <= 66; len++) {
+        std::string base(len, 'a');
+        check(base);
+        checks++;
+        for (size_t pos = 0; pos < len; pos++) {
+            for (char c : specials) {
+                std::string data = base;
+                data[pos] = c;
+                check(data);
+                // Second special character at the end of the block
+                if (pos + 1 < len) {
+                    data[len - 1] = '\n';
+                    check(data);
+                    checks++;
+                }
+                checks++;
+            }
+        }
+        // Only special characters
+        for (char c : specials) {
+            check(std::string(len, c));
+            checks++;
+        }
+    }
+
+    // Random strings with all kind of characters
+    srand(1234);
+    for (int i = 0; i < 20000; i++) {
+        std::string data(rand() % 100, '\0');
+        int kind = rand() % 3;
+        for (char& c : data) {
+            if (kind == 0)      c = (char)(rand() % 256);                               // binary
+            else if (kind == 1) c = rand() % 8 == 0 ? "\"\\\n\r\t\x01\x7f\xe9"[rand() % 8] : 'a' + rand() % 26; // mostly text
+            else                c = (char)(32 + rand() % 95);                           // printable
+        }
+        check(data);
+        checks++;
+    }
+
+    printf("escape_check: %d inputs, %s\n", checks, failures == 0 ? "outputs are identical" : "OUTPUTS DIFFER");
+
+    // Speed on data similar to the match upload
+    std::string payload = "{\n  \"type\": \"data\",\n  \"start_time\": \"2025-01-01T20:00:00.000Z\",\n  \"players\": [\n";
+    for (int p = 0; p < 10; p++) {
+        if (p > 0) payload += ",\n";
+        payload += "    {\n      \"uuid\": \"" + std::to_string(100000 + p) + "\",\n      \"name\": \"^1Player ^7\\\"" + std::to_string(p) + "\\\"\"";
+        const char* stats[] = {"kills", "deaths", "assists", "damage", "headshots", "grenades", "plants", "defuses", "score", "team"};
+        for (const char* stat : stats)
+            payload += std::string(",\n      \"") + stat + "\": " + std::to_string(rand() % 1000);
+        payload += "\n    }";
+    }
+    payload += "\n  ]\n}\n";
+
+    auto ms = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::string out;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) { out.clear(); json_escape_append_scalar(out, payload.data(), payload.size()); }
+    double jsonScalar = ms(start);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) { out.clear(); json_escape_append_sse2(out, payload.data(), payload.size()); }
+    double jsonSse2 = ms(start);
+
+    static char buffer[1024];
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        for (size_t pos = 0; pos < payload.size(); pos += 1000)
+            escape_string_scalar(buffer, sizeof(buffer), payload.data() + pos, std::min<size_t>(1000, payload.size() - pos));
+    double traceScalar = ms(start);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        for (size_t pos = 0; pos < payload.size(); pos += 1000)
+            escape_string_sse2(buffer, sizeof(buffer), payload.data() + pos, std::min<size_t>(1000, payload.size() - pos));
+    double traceSse2 = ms(start);
+
+    printf("  %u bytes payload, %d iterations\n", (unsigned)payload.size(), iterations);
+    printf("  json_escape_append scalar: %8.4f ms, sse2: %8.4f ms\n", jsonScalar / iterations, jsonSse2 / iterations);
+    printf("  escape_string      scalar: %8.4f ms, sse2: %8.4f ms\n", traceScalar / iterations, traceSse2 / iterations);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+#ifndef COD2X_EVENTLOG_H
+#define COD2X_EVENTLOG_H
+
+// Reader of CoD2x binary event log files (fs_homepath/eventlog/events_<unix time ms>.cev).
+// Header-only, no dependencies. The format is described in src/shared/event_log.cpp.
+//
+// Example:
+//   eventlog::Reader reader;
+//   if (!reader.open("events_1760000000000.cev")) { ... reader.error() ... }
+//   eventlog::Event e;
+//   while (reader.next(e)) {
+//       if (e.type == eventlog::KILL) printf("%s killed %s\n", e.attacker.name.c_str(), e.victim.name.c_str());
+//   }
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace eventlog {
+
+static const char     MAGIC[8] = {'C', 'o', 'D', '2', 'x', 'E', 'V', 'L'};
+static const uint16_t VERSION = 1;
+
+enum Type {
+    MAP_START = 1,
+    MAP_END = 2,
+    KILL = 3,
+    DAMAGE = 4,
+    JOIN = 5,
+    QUIT = 6,
+    WIN = 7,
+    LOSS = 8,
+    ACTION = 9,
+};
+
+inline const char* typeName(int type) {
+    switch (type) {
+        case MAP_START: return "map_start";
+        case MAP_END:   return "map_end";
+        case KILL:      return "kill";
+        case DAMAGE:    return "damage";
+        case JOIN:      return "join";
+        case QUIT:      return "quit";
+        case WIN:       return "win";
+        case LOSS:      return "loss";
+        case ACTION:    return "action";
+        default:        return "unknown";
+    }
+}
+
+struct Player {
+    int32_t guid = 0;
+    int32_t clientNum = 0;
+    std::string team;
+    std::string name;
+};
+
+// Decoded record, only fields of the record type are set
+struct Event {
+    int type = 0;
+    int64_t time = 0;                   // unix time in ms
+
+    // MAP_START
+    std::string map;
+    std::string gametype;
+    // MAP_END
+    int endKind = 0;                    // 0 = round restart, 1 = map change, 2 = shutdown
+    std::string source;
+    // KILL, DAMAGE (victim and attacker), JOIN, QUIT (player without team), ACTION (player)
+    Player victim;
+    Player attacker;
+    Player player;
+    std::string weapon;
+    int32_t damage = 0;
+    std::string mod;
+    std::string hitloc;
+    // WIN, LOSS
+    std::string team;
+    std::vector<Player> players;        // guid and name only
+    // ACTION
+    std::string action;
+};
+
+class Reader {
+public:
+    ~Reader() { close(); }
+
+    // Open the file and check the header. Returns false on error, see error().
+    bool open(const char* path) {
+        close();
+        file_ = fopen(path, "rb");
+        if (!file_) return fail("cannot open file");
+
+        unsigned char h[32];
+        if (fread(h, 1, sizeof(h), file_) != sizeof(h)) return fail("file is too short");
+        if (memcmp(h, MAGIC, 8) != 0) return fail("not an event log file");
+        memcpy(&version_, h + 8, 2);
+        uint16_t headerSize;
+        memcpy(&headerSize, h + 10, 2);
+        memcpy(&created_, h + 16, 8);
+        if (version_ != VERSION) return fail("unsupported version");
+        if (headerSize < sizeof(h) || fseek(file_, headerSize, SEEK_SET) != 0) return fail("invalid header");
+        return true;
+    }
+
+    void close() {
+        if (file_) fclose(file_);
+        file_ = NULL;
+    }
+
+    // Read next record. Returns false at the end of data or on error (error() is not empty then).
+    // Records of unknown type are returned with only type and time set.
+    bool next(Event& e) {
+        if (!file_) return false;
+
+        unsigned char h[12];
+        size_t n = fread(h, 1, sizeof(h), file_);
+        if (n == 0) return false;                           // end of file
+        uint16_t size;
+        memcpy(&size, h, 2);
+        if (n >= 2 && size == 0) return false;              // end of data in file that was not closed
+        if (n < sizeof(h) || size < sizeof(h)) return fail("truncated record");
+
+        buf_.resize(size - sizeof(h));
+        if (!buf_.empty() && fread(&buf_[0], 1, buf_.size(), file_) != buf_.size()) return fail("truncated record");
+
+        e = Event();
+        e.type = h[2];
+        memcpy(&e.time, h + 4, 8);
+        pos_ = 0;
+        bad_ = false;
+
+        switch (e.type) {
+            case MAP_START:
+                e.map = str();
+                e.gametype = str();
+                break;
+            case MAP_END:
+                e.endKind = u8();
+                e.source = str();
+                break;
+            case KILL:
+            case DAMAGE:
+                e.victim = player();
+                e.attacker = player();
+                e.weapon = str();
+                e.damage = i32();
+                e.mod = str();
+                e.hitloc = str();
+                break;
+            case JOIN:
+            case QUIT:
+                e.player.guid = i32();
+                e.player.clientNum = i32();
+                e.player.name = str();
+                break;
+            case WIN:
+            case LOSS: {
+                e.team = str();
+                int count = u8();
+                for (int i = 0; i < count && !bad_; i++) {
+                    Player p;
+                    p.guid = i32();
+                    p.name = str();
+                    e.players.push_back(p);
+                }
+                break;
+            }
+            case ACTION:
+                e.player = player();
+                e.action = str();
+                break;
+            default:
+                break; // unknown type, skipped by its size
+        }
+        if (bad_) return fail("invalid record fields");
+        return true;
+    }
+
+    const std::string& error() const { return error_; }
+    int64_t created() const { return created_; }
+
+private:
+    FILE* file_ = NULL;
+    uint16_t version_ = 0;
+    int64_t created_ = 0;
+    std::string error_;
+    std::vector<unsigned char> buf_;
+    size_t pos_ = 0;
+    bool bad_ = false;
+
+    bool fail(const char* error) {
+        error_ = error;
+        close();
+        return false;
+    }
+
+    int u8() {
+        if (pos_ + 1 > buf_.size()) { bad_ = true; return 0; }
+        return buf_[pos_++];
+    }
+    int32_t i32() {
+        int32_t v = 0;
+        if (pos_ + 4 > buf_.size()) { bad_ = true; return 0; }
+        memcpy(&v, &buf_[pos_], 4);
+        pos_ += 4;
+        return v;
+    }
+    std::string str() {
+        size_t len = (size_t)u8();
+        if (bad_ || pos_ + len > buf_.size()) { bad_ = true; return std::string(); }
+        std::string s((const char*)buf_.data() + pos_, len);
+        pos_ += len;
+        return s;
+    }
+    Player player() {
+        Player p;
+        p.guid = i32();
+        p.clientNum = i32();
+        p.team = str();
+        p.name = str();
+        return p;
+    }
+};
+
+} // namespace eventlog
+
+#endif
@@ -0,0 +1,99 @@
+// Convert CoD2x binary event log files into JSON lines, one event per line.
+// Build:  g++ -O2 -o eventlog2json eventlog2json.cpp
+// Usage:  eventlog2json events_1760000000000.cev [more files...] > events.jsonl
+
+#include <stdio.h>
+#include <string>
+
+#include "eventlog.h"
+
+static std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += (char)c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+static std::string json_player(const eventlog::Player& p, bool team) {
+    std::string out = "{\"guid\":" + std::to_string(p.guid) + ",\"num\":" + std::to_string(p.clientNum);
+    if (team) out += ",\"team\":" + json_string(p.team);
+    return out + ",\"name\":" + json_string(p.name) + "}";
+}
+
+static std::string json_event(const eventlog::Event& e) {
+    std::string out = "{\"type\":\"" + std::string(eventlog::typeName(e.type)) + "\",\"time\":" + std::to_string(e.time);
+    switch (e.type) {
+        case eventlog::MAP_START:
+            out += ",\"map\":" + json_string(e.map) + ",\"gametype\":" + json_string(e.gametype);
+            break;
+        case eventlog::MAP_END:
+            out += std::string(",\"kind\":\"") + (e.endKind == 2 ? "shutdown" : e.endKind == 1 ? "map_change" : "round_restart") + "\"";
+            out += ",\"source\":" + json_string(e.source);
+            break;
+        case eventlog::KILL:
+        case eventlog::DAMAGE:
+            out += ",\"victim\":" + json_player(e.victim, true) + ",\"attacker\":" + json_player(e.attacker, true);
+            out += ",\"weapon\":" + json_string(e.weapon) + ",\"damage\":" + std::to_string(e.damage);
+            out += ",\"mod\":" + json_string(e.mod) + ",\"hitloc\":" + json_string(e.hitloc);
+            break;
+        case eventlog::JOIN:
+        case eventlog::QUIT:
+            out += ",\"player\":" + json_player(e.player, false);
+            break;
+        case eventlog::WIN:
+        case eventlog::LOSS:
+            out += ",\"team\":" + json_string(e.team) + ",\"players\":[";
+            for (size_t i = 0; i < e.players.size(); i++) {
+                if (i > 0) out += ",";
+                out += "{\"guid\":" + std::to_string(e.players[i].guid) + ",\"name\":" + json_string(e.players[i].name) + "}";
+            }
+            out += "]";
+            break;
+        case eventlog::ACTION:
+            out += ",\"player\":" + json_player(e.player, true) + ",\"action\":" + json_string(e.action);
+            break;
+        default:
+            out += ",\"typeId\":" + std::to_string(e.type);
+    }
+    return out + "}";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file.cev> [more files...]\n", argv[0]);
+        return 2;
+    }
+
+    int result = 0;
+    for (int i = 1; i < argc; i++) {
+        eventlog::Reader reader;
+        if (!reader.open(argv[i])) {
+            fprintf(stderr, "%s: %s\n", argv[i], reader.error().c_str());
+            result = 1;
+            continue;
+        }
+        eventlog::Event e;
+        while (reader.next(e))
+            printf("%s\n", json_event(e).c_str());
+        if (!reader.error().empty()) {
+            fprintf(stderr, "%s: %s\n", argv[i], reader.error().c_str());
+            result = 1;
+        }
+    }
+    return result;
+}